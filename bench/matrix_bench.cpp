@@ -0,0 +1,324 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+#include "matrix_cholesky.hpp"
+#include "matrix_modular.hpp"
+
+using namespace Matrix;
+
+namespace
+{
+// floating point matrices go through Gauss / LU, integer ones through Bareiss
+template<typename T>
+using MatrixT = MatrixArithmetic<T, std::is_floating_point_v<T>>;
+
+// random elements in [-8, 8], diagonal is shifted by size, so determinant and inverse are well conditioned
+template<typename T, bool IsDivArithm = std::is_floating_point_v<T>>
+MatrixArithmetic<T, IsDivArithm> random_matrix(std::size_t sz, std::uint64_t seed = 42)
+{
+    std::mt19937_64 gen {seed};
+    std::vector<T> data (sz * sz);
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        std::uniform_real_distribution<T> dist {-8, 8};
+        for (auto& elem: data)
+            elem = dist(gen);
+    }
+    else
+    {
+        std::uniform_int_distribution<T> dist {-8, 8};
+        for (auto& elem: data)
+            elem = dist(gen);
+    }
+    for (std::size_t i = 0; i < sz; i++)
+        data[i * sz + i] += static_cast<T>(sz);
+    return MatrixArithmetic<T, IsDivArithm>::square(sz, data.begin(), data.end());
+}
+
+std::size_t side(const benchmark::State& state) {return static_cast<std::size_t>(state.range(0));}
+
+// FLOP/s and bytes/s of one iteration
+void set_rates(benchmark::State& state, double flops, double bytes)
+{
+    if (flops > 0)
+        state.counters["FLOP/s"] = benchmark::Counter(flops, benchmark::Counter::kIsIterationInvariantRate);
+    if (bytes > 0)
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes) * state.iterations());
+}
+
+template<typename T>
+double matrix_bytes(std::size_t sz) {return static_cast<double>(sz * sz * sizeof(T));}
+
+template<typename T>
+double cube(std::size_t sz) {return static_cast<double>(sz) * static_cast<double>(sz) * static_cast<double>(sz);}
+} // namespace
+
+//--------------------------------=| Memory start |=----------------------------------------------------
+template<typename T>
+void construct(benchmark::State& state)
+{
+    auto sz = side(state);
+    for (auto _: state)
+    {
+        MatrixT<T> mat (sz, sz, T{1});
+        benchmark::DoNotOptimize(mat[0].data());
+    }
+    set_rates(state, 0, matrix_bytes<T>(sz));
+}
+
+template<typename T>
+void copy(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto src = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        MatrixT<T> dst (src);
+        benchmark::DoNotOptimize(dst[0].data());
+    }
+    set_rates(state, 0, 2 * matrix_bytes<T>(sz));
+}
+
+// pair of moves puts matrix back, so every iteration starts with the same state
+template<typename T>
+void move(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        MatrixT<T> tmp (std::move(mat));
+        mat = std::move(tmp);
+        benchmark::DoNotOptimize(mat[0].data());
+    }
+}
+//--------------------------------=| Memory end |=------------------------------------------------------
+
+//--------------------------------=| Access start |=----------------------------------------------------
+template<typename T>
+void to(benchmark::State& state)
+{
+    auto sz = side(state);
+    const auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        T sum {};
+        for (std::size_t i = 0; i < sz; i++)
+            for (std::size_t j = 0; j < sz; j++)
+                sum += mat.to(i, j);
+        benchmark::DoNotOptimize(sum);
+    }
+    set_rates(state, static_cast<double>(sz * sz), matrix_bytes<T>(sz));
+}
+
+template<typename T>
+void swap_row(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        for (std::size_t i = 0; i < sz; i++)
+            mat.swap_row(i, sz - 1 - i);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(sz) * state.iterations());
+}
+
+template<typename T>
+void swap_col(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        for (std::size_t j = 0; j < sz; j++)
+            mat.swap_col(j, sz - 1 - j);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(sz) * state.iterations());
+    set_rates(state, 0, 2 * matrix_bytes<T>(sz));
+}
+//--------------------------------=| Access end |=------------------------------------------------------
+
+//--------------------------------=| Element-wise start |=----------------------------------------------
+// lhs + rhs * 2 in one pass to preallocated result
+template<typename T>
+void elementwise(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto lhs = random_matrix<T>(sz, 1), rhs = random_matrix<T>(sz, 2);
+    MatrixT<T> res (sz, sz);
+    for (auto _: state)
+    {
+        res = lhs + rhs * T{2};
+        benchmark::DoNotOptimize(res[0].data());
+    }
+    set_rates(state, 2.0 * static_cast<double>(sz * sz), 3 * matrix_bytes<T>(sz));
+}
+
+template<typename T>
+void transpos(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        auto res = mat.transpos();
+        benchmark::DoNotOptimize(res[0].data());
+    }
+    set_rates(state, 0, 2 * matrix_bytes<T>(sz));
+}
+
+// square matrix, so every iteration swaps elements without allocation
+template<typename T>
+void transpose_inplace(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        mat.transpose_inplace();
+        benchmark::DoNotOptimize(mat[0].data());
+    }
+    set_rates(state, 0, 2 * matrix_bytes<T>(sz));
+}
+//--------------------------------=| Element-wise end |=------------------------------------------------
+
+//--------------------------------=| Algorithms start |=------------------------------------------------
+template<typename T>
+void product(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto lhs = random_matrix<T>(sz, 1), rhs = random_matrix<T>(sz, 2);
+    for (auto _: state)
+    {
+        auto res = product(lhs, rhs);
+        benchmark::DoNotOptimize(res[0].data());
+    }
+    set_rates(state, 2 * cube<T>(sz), 3 * matrix_bytes<T>(sz));
+}
+
+// 8 = 2^3 takes three squarings
+template<typename T>
+void power(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        auto res = power(mat, 8);
+        benchmark::DoNotOptimize(res[0].data());
+    }
+    set_rates(state, 3 * 2 * cube<T>(sz), 0);
+}
+
+// Gauss elimination / blocked LU for floating point, Bareiss for integers
+template<typename T>
+void determinant(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+        benchmark::DoNotOptimize(mat.determinant());
+    // Bareiss makes two products and one division per element instead of one multiply-add
+    set_rates(state, (std::is_floating_point_v<T> ? 2.0 : 4.0) / 3.0 * cube<T>(sz), 0);
+}
+
+// Bareiss on floating point values, same arithmetic as for integers without overflow
+template<typename T>
+void determinant_bareiss(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T, false>(sz);
+    for (auto _: state)
+        benchmark::DoNotOptimize(mat.determinant());
+    set_rates(state, 4.0 / 3.0 * cube<T>(sz), 0);
+}
+
+// LU and n right sides: 2/3 n^3 + 2 n^3
+template<typename T>
+void inverse(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (auto _: state)
+    {
+        auto res = mat.inverse();
+        benchmark::DoNotOptimize(res[0].data());
+    }
+    set_rates(state, 8.0 / 3.0 * cube<T>(sz), 0);
+}
+
+// lower triangle with dominant diagonal is positive definite, upper one isnt read: 1/3 n^3
+template<typename T>
+void cholesky(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    for (std::size_t i = 0; i < sz; i++)
+        mat.to(i, i) += static_cast<T>(8 * sz);
+    for (auto _: state)
+    {
+        CholeskyDecomposition chol {mat};
+        benchmark::DoNotOptimize(chol.log_determinant());
+    }
+    set_rates(state, cube<T>(sz) / 3.0, 0);
+}
+
+// exact determinant of int matrix: elimination modulo every prime the Hadamard bound asks for
+template<typename T>
+void modular_determinant(benchmark::State& state)
+{
+    auto sz = side(state);
+    auto mat = random_matrix<T>(sz);
+    std::size_t primes = 0;
+    for (auto _: state)
+    {
+        auto det = modular_determinant(mat);
+        primes = det.primes();
+        benchmark::DoNotOptimize(det);
+    }
+    state.counters["primes"] = static_cast<double>(primes);
+    set_rates(state, static_cast<double>(primes) * 2.0 / 3.0 * cube<T>(sz), 0);
+}
+//--------------------------------=| Algorithms end |=--------------------------------------------------
+
+// cheap operations go up to 2048, cubic ones up to 1024; integer Bareiss stops at 8 x 8: products of minors
+// of 12 x 12 random_matrix overflow long long, and int is left out of power: A^8 of it overflows int
+#define MATRIX_BENCH_TYPES(func, lo, hi)                                                                    \
+    BENCHMARK_TEMPLATE(func, int)->RangeMultiplier(4)->Range(lo, hi)->Unit(benchmark::kMicrosecond);       \
+    BENCHMARK_TEMPLATE(func, float)->RangeMultiplier(4)->Range(lo, hi)->Unit(benchmark::kMicrosecond);     \
+    BENCHMARK_TEMPLATE(func, double)->RangeMultiplier(4)->Range(lo, hi)->Unit(benchmark::kMicrosecond)
+
+MATRIX_BENCH_TYPES(construct, 16, 2048);
+MATRIX_BENCH_TYPES(copy, 16, 2048);
+MATRIX_BENCH_TYPES(move, 16, 2048);
+MATRIX_BENCH_TYPES(to, 16, 2048);
+MATRIX_BENCH_TYPES(swap_row, 16, 2048);
+MATRIX_BENCH_TYPES(swap_col, 16, 2048);
+MATRIX_BENCH_TYPES(elementwise, 16, 2048);
+MATRIX_BENCH_TYPES(transpos, 16, 2048);
+MATRIX_BENCH_TYPES(transpose_inplace, 16, 2048);
+MATRIX_BENCH_TYPES(product, 16, 1024);
+BENCHMARK_TEMPLATE(power, float)->RangeMultiplier(4)->Range(16, 256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(power, double)->RangeMultiplier(4)->Range(16, 256)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_TEMPLATE(determinant, long long)->DenseRange(4, 8, 4)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(determinant, float)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(determinant, double)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(determinant_bareiss, double)->RangeMultiplier(4)->Range(16, 256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(inverse, float)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(inverse, double)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(cholesky, float)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(cholesky, double)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(modular_determinant, int)->RangeMultiplier(4)->Range(16, 256)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
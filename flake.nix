@@ -40,6 +40,7 @@
               gdb
               valgrind
               gtest
+              gbenchmark
               Vector
             ];
             buildInputs = [ ];
@@ -1,5 +1,12 @@
 #pragma once
 #include "matrix_container.hpp"
+#include "matrix_gemm.hpp"
+#include "matrix_simd.hpp"
+#include "matrix_lu.hpp"
+#include "matrix_fraction_free.hpp"
+#include "matrix_expression.hpp"
+#include "matrix_view.hpp"
+#include "matrix_thread_pool.hpp"
 
 namespace Matrix
 {
@@ -62,6 +69,10 @@ public:
     :base(h, w, val)
     {}
 
+    MatrixArithmetic(detail::uninitialized_t tag, size_type h, size_type w) requires std::is_trivially_default_constructible_v<T>
+    :base(tag, h, w)
+    {}
+
     template<std::input_iterator InpIt>
     MatrixArithmetic(size_type h, size_type w, InpIt begin, InpIt end)
     :base(h, w, begin, end)
@@ -78,6 +89,43 @@ public:
     MatrixArithmetic(std::initializer_list<std::initializer_list<value_type>> twodim_list)
     :base(twodim_list)
     {}
+
+    // evaluates lazy expression like A + B - C * 2 in one pass
+    template<detail::is_matrix_expression E>
+    MatrixArithmetic(const E& expr) requires std::same_as<typename E::matrix_type, MatrixArithmetic>
+    :base(expr.height(), expr.width())
+    {
+        detail::assign_expression(*this, expr);
+    }
+
+    // rvalue matrix inside expression gives its buffer to result, no allocation
+    template<detail::is_matrix_expression E>
+    MatrixArithmetic(E&& expr) requires (!std::is_lvalue_reference_v<E>) && std::same_as<typename E::matrix_type, MatrixArithmetic>
+    {
+        if (!expr.donate(*this))
+            base::operator=(base(expr.height(), expr.width()));
+        detail::assign_expression(*this, expr);
+    }
+
+    template<detail::is_matrix_expression E>
+    MatrixArithmetic& operator=(const E& expr) requires std::same_as<typename E::matrix_type, MatrixArithmetic>
+    {
+        if (this->height() != expr.height() || this->width() != expr.width())
+            return *this = MatrixArithmetic(expr);
+
+        detail::assign_expression(*this, expr);
+        return *this;
+    }
+
+    template<detail::is_matrix_expression E>
+    MatrixArithmetic& operator=(E&& expr) requires (!std::is_lvalue_reference_v<E>) && std::same_as<typename E::matrix_type, MatrixArithmetic>
+    {
+        if (this->height() != expr.height() || this->width() != expr.width())
+            return *this = MatrixArithmetic(std::move(expr));
+
+        detail::assign_expression(*this, expr);
+        return *this;
+    }
 //--------------------------------=| Ctors end |=-------------------------------------------------------
 
 //--------------------------------=| Algorithm fucntions start |=---------------------------------------
@@ -173,6 +221,16 @@ protected:
             res *= this->to(i, i);
         return res;
     }
+
+    // singular upper triangular matrix, product of diagonal may underflow to zero without it
+    bool has_null_on_diagonal(size_type side_of_square) const
+    {
+        value_type null_obj {};
+        for (size_type i = 0; i < side_of_square; i++)
+            if (cmp(this->to(i, i), null_obj))
+                return true;
+        return false;
+    }
 //--------------------------------=| Algorithm fucntions end |=-----------------------------------------
 
 //--------------------------------=| Public methods start |=--------------------------------------------
@@ -182,16 +240,36 @@ public:
         if (!this->is_square())
             throw std::invalid_argument{"try to get determinant() of no square matrix"};
 
+        if constexpr (detail::is_blocked_lu_available<value_type>)
+            if (this->height() >= detail::blocked_lu_threshold)
+                return determinant(default_pool());
+
+        detail::OperationScope scope {Operation::determinant, this->height(), detail::lu_flops(this->height())};
         MatrixArithmetic cpy (*this);
         value_type sign = cpy.make_upper_triangular_square(this->height());
         return sign * cpy.determinant_for_upper_triangular(this->height());
     }
 
+    // blocked LU on threads of pool, for big floating point matrices
+    value_type determinant(ThreadPool& pool) const requires is_div_arithmetical && detail::is_blocked_lu_available<value_type>
+    {
+        if (!this->is_square())
+            throw std::invalid_argument{"try to get determinant() of no square matrix"};
+
+        detail::OperationScope scope {Operation::determinant, this->height(), detail::lu_flops(this->height())};
+        MatrixArithmetic cpy (*this);
+        std::vector<size_type> pivots;
+        value_type sign = detail::blocked_lu(cpy, pivots, abs, cmp, pool);
+        return sign * cpy.determinant_for_upper_triangular(this->height());
+    }
+
     value_type determinant() const
     {
         if (!this->is_square())
             throw std::invalid_argument{"try to get determinant() of no square matrix"};
 
+        // Bareiss makes two products and one division per element
+        detail::OperationScope scope {Operation::determinant, this->height(), 2 * detail::lu_flops(this->height())};
         MatrixArithmetic cpy (*this);
         return cpy.make_upper_triangular_square(this->height());
     }
@@ -201,27 +279,54 @@ public:
         if (!this->is_square())
             throw std::invalid_argument{"try to get inverse matrix of no square matrix"};
 
-        MatrixArithmetic extended_mat (this->height(), 2 * this->height());
-        for (size_type i = 0; i < this->height(); i++)
-            for (size_type j = 0; j < this->height(); j++)
+        auto n = this->height();
+        if constexpr (detail::is_blocked_lu_available<value_type>)
+            if (n >= detail::blocked_lu_threshold)
+                return inverse_pair(default_pool());
+
+        detail::OperationScope scope {Operation::inverse, n, detail::lu_flops(n) + detail::lu_solve_flops(n, n)};
+        MatrixArithmetic extended_mat (n, 2 * n);
+        for (size_type i = 0; i < n; i++)
+            for (size_type j = 0; j < n; j++)
                 extended_mat.to(i, j) = this->to(i, j);
-        
-        for (size_type i = 0; i < this->height(); i++)
-            extended_mat.to(i, i + this->height()) = value_type{1};
+        detail::note_copied(n * n * sizeof(value_type));
+
+        for (size_type i = 0; i < n; i++)
+            extended_mat.to(i, i + n) = value_type{1};
 
-        extended_mat.make_upper_triangular_square(extended_mat.height());
+        extended_mat.make_upper_triangular_square(n);
 
-        if (extended_mat.determinant_for_upper_triangular(extended_mat.height()) == value_type{})
+        if (extended_mat.has_null_on_diagonal(n))
             return {false, MatrixArithmetic{value_type{0}}};
 
-        extended_mat.make_eye_square_from_upper_triangular_square(extended_mat.height());
-        
-        MatrixArithmetic res (this->height(), this->height());
-        for (size_type i = 0; i < this->height(); i++)
-            for (size_type j = 0; j < this->height(); j++)
-                res.to(i, j) = extended_mat.to(i, j + this->height());
-        
-        return {true, res};
+        extended_mat.make_eye_square_from_upper_triangular_square(n);
+
+        MatrixArithmetic res (n, n);
+        for (size_type i = 0; i < n; i++)
+            for (size_type j = 0; j < n; j++)
+                res.to(i, j) = extended_mat.to(i, j + n);
+
+        return {true, std::move(res)};
+    }
+
+    // LU on threads of pool factors once and solves A * X = E, no N x 2N Gauss-Jordan
+    std::pair<bool, MatrixArithmetic> inverse_pair(ThreadPool& pool) const requires is_div_arithmetical
+    {
+        if (!this->is_square())
+            throw std::invalid_argument{"try to get inverse matrix of no square matrix"};
+
+        auto n = this->height();
+        detail::OperationScope scope {Operation::inverse, n, detail::lu_flops(n) + detail::lu_solve_flops(n, n)};
+        MatrixArithmetic lu (*this);
+        std::vector<size_type> pivots;
+        detail::blocked_lu(lu, pivots, abs, cmp, pool);
+
+        if (lu.has_null_on_diagonal(n))
+            return {false, MatrixArithmetic{value_type{0}}};
+
+        MatrixArithmetic res = eye(n);
+        detail::lu_solve(lu, pivots, res, pool);
+        return {true, std::move(res)};
     }
 
     MatrixArithmetic inverse() const requires is_div_arithmetical
@@ -230,19 +335,101 @@ public:
         if (!res_pair.first)
             throw std::invalid_argument{"try to get inverse matrix for matrix with determinant equal to zero"};
 
-        return res_pair.second;
+        return std::move(res_pair.second);
     }
 
-    MatrixArithmetic transpos() const
+    // X: (*this) * X = rhs for any number of columns in rhs, no inverse matrix is made
+    MatrixArithmetic solve(const MatrixArithmetic& rhs) const requires is_div_arithmetical
+    {
+        return MatrixArithmetic{*this}.solve_inplace(rhs);
+    }
+
+    MatrixArithmetic solve(const MatrixArithmetic& rhs, ThreadPool& pool) const requires is_div_arithmetical
+    {
+        return MatrixArithmetic{*this}.solve_inplace(rhs, pool);
+    }
+
+    // same, but LU factors are made in place of (*this); small systems stay on calling thread
+    MatrixArithmetic solve_inplace(const MatrixArithmetic& rhs) requires is_div_arithmetical
+    {
+        if constexpr (detail::is_blocked_lu_available<value_type>)
+            if (this->height() >= detail::blocked_lu_threshold)
+                return solve_inplace(rhs, default_pool());
+
+        return solve_inplace(rhs, detail::calling_thread_pool());
+    }
+
+    MatrixArithmetic solve_inplace(const MatrixArithmetic& rhs, ThreadPool& pool) requires is_div_arithmetical
     {
-        MatrixArithmetic res (this->width(), this->height());
+        if (!this->is_square())
+            throw std::invalid_argument{"try to solve system with no square matrix"};
+        if (this->height() != rhs.height())
+            throw std::invalid_argument{"in solve: rhs.height() != lhs.height()"};
+
+        auto n = this->height();
+        detail::OperationScope scope {Operation::solve, n, detail::lu_flops(n) + detail::lu_solve_flops(n, rhs.width())};
+        std::vector<size_type> pivots;
+        detail::blocked_lu(*this, pivots, abs, cmp, pool);
         for (size_type i = 0; i < this->height(); i++)
-            for (size_type j = 0; j < this->width(); j++)
-                res.to(j, i) = this->to(i, j);
+            if (cmp(this->to(i, i), value_type{}))
+                throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+
+        MatrixArithmetic res (rhs);
+        detail::lu_solve(*this, pivots, res, pool);
+        return res;
+    }
+
+    /*
+     * Exact solve for types without arithmetical division (f.e. integers) by Bareiss elimination.
+     * Returns {N, d}: X = N / d, d = |det| for ordered types.
+     */
+    std::pair<MatrixArithmetic, value_type> solve_fraction_free(const MatrixArithmetic& rhs) const
+    {
+        MatrixArithmetic cpy (*this);
+        MatrixArithmetic res (rhs);
+        value_type denom = detail::bareiss_solve<value_type>(cpy, res, abs, cmp);
+        return {std::move(res), denom};
+    }
+
+    MatrixArithmetic transpos() const
+    {
+        detail::OperationScope scope {Operation::transpos, std::max(this->height(), this->width())};
+        // kernel writes every element, only padding of rows is left to fill
+        auto res = [this]
+        {
+            if constexpr (std::is_trivially_default_constructible_v<value_type>)
+                return MatrixArithmetic(detail::uninitialized, this->width(), this->height());
+            else
+                return MatrixArithmetic(this->width(), this->height());
+        }();
+        detail::transpose_to<value_type>(this->height(), this->width(),
+                                         [this](size_type i) {return (*this)[i].data();},
+                                         [&res](size_type j) {return res[j].data();});
+        if constexpr (std::is_trivially_default_constructible_v<value_type>)
+            for (size_type j = 0; j < res.height(); j++)
+                std::fill(res[j].data() + res.width(), res[j].data() + res.ld(), value_type{});
         return res;
     }
 //--------------------------------=| Public methods end |=----------------------------------------------
 
+//--------------------------------=| Views start |=-----------------------------------------------------
+    MatrixView<MatrixArithmetic> view() {return MatrixView<MatrixArithmetic>{*this};}
+    ConstMatrixView<MatrixArithmetic> view() const {return ConstMatrixView<MatrixArithmetic>{*this};}
+
+    // h x w block from element (i, j), no copy
+    MatrixView<MatrixArithmetic> submatrix(size_type i, size_type j, size_type h, size_type w)
+    {
+        return view().submatrix(i, j, h, w);
+    }
+
+    ConstMatrixView<MatrixArithmetic> submatrix(size_type i, size_type j, size_type h, size_type w) const
+    {
+        return view().submatrix(i, j, h, w);
+    }
+
+    ConstMatrixView<MatrixArithmetic> transposed_view() const {return view().transposed();}
+//--------------------------------=| Views end |=-------------------------------------------------------
+
 //--------------------------------=| Compare start |=---------------------------------------------------
     bool equal_to(const MatrixArithmetic& rhs) const
     {
@@ -263,9 +450,13 @@ public:
         if (this->height() != rhs.height() || this->width() != rhs.width())
             throw std::invalid_argument{"Try to add matrixes with different height() * width()"};
 
-        for (size_type i = 0; i < this->height(); i++)
-            for (size_type j = 0; j < this->width(); j++)
-                this->to(i, j) += rhs.to(i, j);
+        if constexpr (detail::is_simd_available<value_type>)
+            for (size_type i = 0; i < this->height(); i++)
+                detail::elementwise<detail::ElementwiseOp::add>((*this)[i].data(), rhs[i].data(), value_type{}, this->width());
+        else
+            for (size_type i = 0; i < this->height(); i++)
+                for (size_type j = 0; j < this->width(); j++)
+                    this->to(i, j) += rhs.to(i, j);
 
         return *this;
     }
@@ -275,37 +466,72 @@ public:
         if (this->height() != rhs.height() || this->width() != rhs.width())
             throw std::invalid_argument{"Try to sub matrixes with different height() * width()"};
 
-        for (size_type i = 0; i < this->height(); i++)
-            for (size_type j = 0; j < this->width(); j++)
-                this->to(i, j) -= rhs.to(i, j);
+        if constexpr (detail::is_simd_available<value_type>)
+            for (size_type i = 0; i < this->height(); i++)
+                detail::elementwise<detail::ElementwiseOp::sub>((*this)[i].data(), rhs[i].data(), value_type{}, this->width());
+        else
+            for (size_type i = 0; i < this->height(); i++)
+                for (size_type j = 0; j < this->width(); j++)
+                    this->to(i, j) -= rhs.to(i, j);
 
         return *this;
     }
 
-    MatrixArithmetic operator-() const
+    // this += alpha * rhs without temporary matrix for alpha * rhs
+    MatrixArithmetic& axpy(const_reference alpha, const MatrixArithmetic& rhs)
     {
-        MatrixArithmetic res (this->height(), this->width());
+        if (this->height() != rhs.height() || this->width() != rhs.width())
+            throw std::invalid_argument{"Try to axpy matrixes with different height() * width()"};
 
-        for (size_type i = 0; i < this->height(); i++)
-            for (size_type j = 0; j < this->width(); j++)
-                res.to(i, j) = -this->to(i, j);
+        if constexpr (detail::is_simd_available<value_type>)
+            for (size_type i = 0; i < this->height(); i++)
+                detail::elementwise<detail::ElementwiseOp::axpy>((*this)[i].data(), rhs[i].data(), alpha, this->width());
+        else
+            for (size_type i = 0; i < this->height(); i++)
+                for (size_type j = 0; j < this->width(); j++)
+                    this->to(i, j) += alpha * rhs.to(i, j);
 
-        return res;
+        return *this;
+    }
+
+    // fused: this += expr in one pass, no matrix for expr is made
+    template<detail::is_matrix_expression E>
+    MatrixArithmetic& operator+=(const E& expr) requires std::same_as<typename E::matrix_type, MatrixArithmetic>
+    {
+        using Leaf = detail::ExprLeaf<MatrixArithmetic, false>;
+        detail::assign_expression(*this, detail::ExprBinary<detail::ElementwiseOp::add, Leaf, E>{Leaf{*this}, expr});
+        return *this;
+    }
+
+    template<detail::is_matrix_expression E>
+    MatrixArithmetic& operator-=(const E& expr) requires std::same_as<typename E::matrix_type, MatrixArithmetic>
+    {
+        using Leaf = detail::ExprLeaf<MatrixArithmetic, false>;
+        detail::assign_expression(*this, detail::ExprBinary<detail::ElementwiseOp::sub, Leaf, E>{Leaf{*this}, expr});
+        return *this;
     }
 
     MatrixArithmetic& operator*=(const_reference rhs)
     {
-        for (auto& row: *this)
-            for (auto& elem: row)
-                elem *= rhs;
+        if constexpr (detail::is_simd_available<value_type>)
+            for (auto& row: *this)
+                detail::elementwise<detail::ElementwiseOp::mul>(row.data(), row.data(), rhs, row.size());
+        else
+            for (auto& row: *this)
+                for (auto& elem: row)
+                    elem *= rhs;
         return *this;
     }
 
     MatrixArithmetic& operator/=(const_reference rhs)
     {
-        for (auto& row: *this)
-            for (auto& elem: row)
-                elem /= rhs;
+        if constexpr (detail::is_simd_available<value_type>)
+            for (auto& row: *this)
+                detail::elementwise<detail::ElementwiseOp::div>(row.data(), row.data(), rhs, row.size());
+        else
+            for (auto& row: *this)
+                for (auto& elem: row)
+                    elem /= rhs;
         return *this;
     }
 //--------------------------------=| Basic arithmetic end |=--------------------------------------------
@@ -360,6 +586,80 @@ public:
 //--------------------------------=| Specific static ctors end |=---------------------------------------
 }; // class MatrixArithmetic
 
+namespace detail
+{
+template<typename M>
+struct is_matrix_arithmetic : std::false_type {};
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+struct is_matrix_arithmetic<MatrixArithmetic<T, IsDivArithm, Cmp, Abs>> : std::true_type
+{
+    static constexpr bool is_div_arithmetical = IsDivArithm;
+    using cmp_type = Cmp;
+    using abs_type = Abs;
+};
+
+// only declared: deduces MatrixArithmetic base of class derived from it
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> matrix_arithmetic_base(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&);
+
+template<typename X>
+concept is_matrix_arithmetic_based = requires (const std::remove_cvref_t<X>& x) {matrix_arithmetic_base(x);};
+
+// matrix, class derived from it or lazy expression of matrices
+template<typename X>
+concept is_matrix_operand = is_matrix_arithmetic_based<X> || is_matrix_expression<X>;
+
+template<typename X>
+struct operand_matrix {using type = std::remove_cvref_t<X>;};
+
+// operators work with MatrixArithmetic base of derived classes, so result is base too
+template<is_matrix_arithmetic_based X>
+struct operand_matrix<X> {using type = decltype(matrix_arithmetic_base(std::declval<const std::remove_cvref_t<X>&>()));};
+
+template<is_matrix_expression X>
+struct operand_matrix<X> {using type = typename std::remove_cvref_t<X>::matrix_type;};
+
+template<typename X>
+using operand_matrix_t = typename operand_matrix<X>::type;
+
+template<typename L, typename R>
+concept are_same_matrix_operands = is_matrix_operand<L> && is_matrix_operand<R> &&
+                                   std::same_as<operand_matrix_t<L>, operand_matrix_t<R>>;
+
+// expressions are copied, lvalue matrices are referenced, rvalue matrices are moved into leaf
+template<is_matrix_operand X>
+auto as_expression(X&& x)
+{
+    using Plain = std::remove_cvref_t<X>;
+    if constexpr (is_matrix_expression<Plain>)
+        return Plain(std::forward<X>(x));
+    else if constexpr (std::is_lvalue_reference_v<X>)
+        return ExprLeaf<operand_matrix_t<X>, false>{x};
+    else
+        return ExprLeaf<operand_matrix_t<X>, true>{std::forward<X>(x)};
+}
+
+template<typename X>
+using expression_t = decltype(as_expression(std::declval<X>()));
+
+// matrix itself or result of expression, for functions that need whole matrix
+template<is_matrix_operand X>
+decltype(auto) evaluated(const X& x)
+{
+    if constexpr (is_matrix_expression<X>)
+        return x.eval();
+    else
+        return x;
+}
+} // namespace detail
+
+template<detail::is_matrix_expression E>
+MatrixArithmetic(const E&) -> MatrixArithmetic<typename E::value_type,
+                                                detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                                typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                                typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
 //--------------------------------=| Cast to scalar start |=--------------------------------------------
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
 T scalar_cast(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat)
@@ -368,6 +668,12 @@ T scalar_cast(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat)
         throw std::invalid_argument{"Try to cast MatrixArithmetic in value_type, but matrix isnt scalar"};
     return mat.to(0, 0);
 }
+
+template<detail::is_matrix_expression E>
+typename E::value_type scalar_cast(const E& expr)
+{
+    return scalar_cast(expr.eval());
+}
 //--------------------------------=| Cast to scalar end |=----------------------------------------------
 
 //--------------------------------=| Wrappers arounf methods start |=-----------------------------------
@@ -389,117 +695,425 @@ MatrixArithmetic<T, IsDivArithm, Cmp, Abs> inverse(const MatrixArithmetic<T, IsD
     return mat.inverse();
 }
 
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> solve(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs.solve(rhs);
+}
+
+// lhs is not needed after solve, so it is factorized in place
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> solve(MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs.solve_inplace(rhs);
+}
+
+// views and expressions: lhs is evaluated straight into matrix factorized in place
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R> &&
+                                          (detail::is_matrix_expression<L> || detail::is_matrix_expression<R>)
+detail::operand_matrix_t<L> solve(const L& lhs, const R& rhs)
+{
+    detail::operand_matrix_t<L> lhs_cpy (lhs);
+    return lhs_cpy.solve_inplace(detail::evaluated(rhs));
+}
+
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+std::pair<MatrixArithmetic<T, IsDivArithm, Cmp, Abs>, T> solve_fraction_free(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs.solve_fraction_free(rhs);
+}
+
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& axpy(MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const T& alpha, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs.axpy(alpha, rhs);
+}
+
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
 MatrixArithmetic<T, IsDivArithm, Cmp, Abs> transpos(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat)
 {
     return mat.transpos();
 }
+
+// result of lazy expression as matrix
+template<detail::is_matrix_expression E>
+typename E::matrix_type eval(const E& expr)
+{
+    return expr.eval();
+}
+
+// expressions given to functions that need whole matrix are evaluated first
+template<detail::is_matrix_expression E>
+typename E::value_type determinant(const E& expr)
+{
+    return expr.eval().determinant();
+}
+
+template<detail::is_matrix_expression E>
+typename E::matrix_type inverse(const E& expr)
+{
+    return expr.eval().inverse();
+}
+
+template<detail::is_matrix_expression E>
+typename E::matrix_type transpos(const E& expr)
+{
+    return expr.eval().transpos();
+}
 //--------------------------------=| Wrappers arounf methods end |=-------------------------------------
 
 //--------------------------------=| Arrithmetical operators start |=-----------------------------------
-template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+namespace detail
 {
-    if (lhs.is_scalar())
+template<typename X>
+concept is_row_accessible = is_matrix_arithmetic_based<X> ||
+                            std::is_same_v<X, BasicMatrixView<typename X::matrix_type, true>> ||
+                            std::is_same_v<X, BasicMatrixView<typename X::matrix_type, false>>;
+
+// pointer to row i of matrix or of view with is_rowwise()
+template<is_row_accessible X>
+auto row_data(const X& x, std::size_t i)
+{
+    if constexpr (is_matrix_arithmetic_based<X>)
+        return x[i].data();
+    else
+        return static_cast<const typename X::value_type*>(x.row_data(i));
+}
+
+// products with less multiply-adds than this run on calling thread only
+inline constexpr std::size_t parallel_product_threshold = 128 * 128 * 128;
+
+// edge of output tile: largest of 512, 256, 128, 64 that gives at least 4 tiles per thread to steal
+inline std::size_t product_tile(std::size_t height, std::size_t width, std::size_t threads)
+{
+    std::size_t tile = 512;
+    while (tile > 64 && ((height + tile - 1) / tile) * ((width + tile - 1) / tile) < 4 * threads)
+        tile /= 2;
+    return tile;
+}
+
+/*
+ * c[i0:i1, j0:j1] = a[i0:i1, :] * b[:, j0:j1], where a_row, b_row and c_row give rows of m x k a, k x n b
+ * and m x n c. Tile with last column zeroes rows of c up to fill_end (padding of matrix rows).
+ */
+template<typename T, typename ARows, typename BRows, typename CRows>
+void product_tile_to(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1, std::size_t fill_end, std::size_t k,
+                     ARows a_row, BRows b_row, CRows c_row)
+{
+    using size_type = std::size_t;
+
+    for (size_type i = i0; i < i1; i++)
+        std::fill(c_row(i) + j0, c_row(i) + fill_end, T{});
+
+    if constexpr (is_gemm_available<T>)
+        if ((i1 - i0) * (j1 - j0) * k >= gemm_threshold)
+        {
+            gemm<T>(i1 - i0, j1 - j0, k,
+                    [&a_row, i0](size_type i) {return a_row(i0 + i);},
+                    [&b_row, j0](size_type i) {return b_row(i) + j0;},
+                    [&c_row, i0, j0](size_type i) {return c_row(i0 + i) + j0;});
+            return;
+        }
+
+    // i-k-j order walks rows of b and c, not columns of b
+    for (size_type i = i0; i < i1; i++)
     {
-        MatrixArithmetic res (rhs);
-        const auto& scalar = scalar_cast(lhs);
-        for (auto& row: res)
-            for (auto& elem: row)
-                elem *= scalar;
-        return res;
+        T* c_elems = c_row(i);
+        const T* a_elems = a_row(i);
+        for (size_type p = 0; p < k; p++)
+        {
+            const auto& a_elem = a_elems[p];
+            const T* b_elems = b_row(p);
+            for (size_type j = j0; j < j1; j++)
+                c_elems[j] += a_elem * b_elems[j];
+        }
     }
-    if (rhs.is_scalar())
+}
+
+/*
+ * c = a * b for row functions like in product_tile_to, c may be uninitialized: output is cut to tiles of
+ * tile x tile (0 - chosen by product_tile), pool runs them by work stealing and every tile is zeroed by
+ * thread which computes it, so pages of result are first touched on NUMA node of this thread.
+ * Without pool big products go to default_pool(), small ones dont start it.
+ */
+template<typename T, typename ARows, typename BRows, typename CRows>
+void tiled_product(std::size_t m, std::size_t n, std::size_t k, ARows a_row, BRows b_row, CRows c_row, std::size_t fill_width,
+                   ThreadPool* pool = nullptr, std::size_t tile = 0)
+{
+    using size_type = std::size_t;
+
+    auto fill_end = [n, fill_width](size_type j1) {return j1 == n ? fill_width : j1;};
+    if (m * n * k < parallel_product_threshold || (pool && pool->num_threads() == 1))
     {
-        MatrixArithmetic res (lhs);
-        const auto& scalar = scalar_cast(rhs);
-        for (auto& row: res)
-            for (auto& elem: row)
-                elem *= scalar;
-        return res;
+        product_tile_to<T>(0, m, 0, n, fill_width, k, a_row, b_row, c_row);
+        return;
     }
-    if (lhs.width() != rhs.height())
-        throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
 
-    MatrixArithmetic<T, IsDivArithm, Cmp, Abs> res (lhs.height(), rhs.width());
+    auto& workers = pool ? *pool : default_pool();
+    if (tile == 0)
+        tile = product_tile(m, n, workers.num_threads());
+    auto tile_height = tile, tile_width = tile;
+    // micro kernel of gemm works on mr x nr pieces, tiles made of whole pieces have no ragged edges inside
+    if constexpr (is_gemm_available<T>)
+    {
+        constexpr auto mr = GemmBlocking<T>::mr, nr = GemmBlocking<T>::nr;
+        tile_height = (tile + mr - 1) / mr * mr;
+        tile_width  = (tile + nr - 1) / nr * nr;
+    }
 
-    using size_type = typename MatrixArithmetic<T, IsDivArithm, Cmp, Abs>::size_type;
+    auto row_tiles = (m + tile_height - 1) / tile_height;
+    auto col_tiles = (n + tile_width - 1) / tile_width;
+    // tiles of one row of tiles are neighbours, thread with run of them reuses rows of a
+    workers.parallel_for_stealing(0, row_tiles * col_tiles, 1, [&](size_type lo, size_type hi)
+    {
+        for (auto t = lo; t < hi; t++)
+        {
+            auto i0 = t / col_tiles * tile_height, j0 = t % col_tiles * tile_width;
+            auto i1 = std::min(i0 + tile_height, m), j1 = std::min(j0 + tile_width, n);
+            product_tile_to<T>(i0, i1, j0, j1, fill_end(j1), k, a_row, b_row, c_row);
+        }
+    });
+}
 
-    for (size_type i = 0; i < lhs.height(); i++)
-        for (size_type j = 0; j < rhs.width(); j++)
-            for (size_type k = 0; k < lhs.width(); k++)
-                res[i][j] += lhs[i][k] * rhs[k][j];
+// res = lhs * rhs without allocation, res must be lhs.height() x rhs.width() and differ from lhs and rhs,
+// views must be rowwise, res may be uninitialized (see tiled_product)
+template<typename M, is_row_accessible L, is_row_accessible R>
+void product_to(M& res, const L& lhs, const R& rhs, ThreadPool* pool = nullptr, std::size_t tile = 0)
+{
+    using size_type = typename M::size_type;
+    using T = typename M::value_type;
+
+    tiled_product<T>(lhs.height(), rhs.width(), lhs.width(),
+                     [&lhs](size_type i) {return row_data(lhs, i);},
+                     [&rhs](size_type i) {return row_data(rhs, i);},
+                     [&res](size_type i) {return res[i].data();},
+                     res.ld(), pool, tile);
+}
 
-    return res; 
+// matrix for product_to, elements of trivial type are left for product_to to write
+template<typename M>
+M product_result(std::size_t height, std::size_t width)
+{
+    if constexpr (std::is_trivially_default_constructible_v<typename M::value_type>)
+        return M(uninitialized, height, width);
+    else
+        return M(height, width);
 }
 
-template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> power(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat, long long pow)
+// rowwise views go to kernel as they are, other views and expressions are evaluated first
+template<typename L, typename R>
+operand_matrix_t<L> product_with(const L& lhs, const R& rhs, ThreadPool* pool, std::size_t tile)
+{
+    if constexpr (!is_row_accessible<L>)
+        return product_with(lhs.eval(), rhs, pool, tile);
+    else if constexpr (!is_row_accessible<R>)
+        return product_with(lhs, rhs.eval(), pool, tile);
+    else
     {
-        if (!mat.is_square())
-            throw std::invalid_argument{"Try to make matrix in some power but this matrix is not square"};
-
-        if (pow == 0)
-            return MatrixArithmetic<T, IsDivArithm, Cmp, Abs>::eye(mat.height());
-
-        MatrixArithmetic<T, IsDivArithm, Cmp, Abs> res (mat);
-
-        if (pow < 0)
+        // product with 1 x 1 matrix is multiplication by scalar
+        if (lhs.is_scalar())
         {
-            res = res.inverse();
-            pow = -pow;
+            operand_matrix_t<L> res (evaluated(rhs));
+            return std::move(res *= scalar_cast(evaluated(lhs)));
         }
-        
-        for (long long i = 1; i < pow; i++)
-            res = product(mat, res);
-        
+        if (rhs.is_scalar())
+        {
+            operand_matrix_t<L> res (evaluated(lhs));
+            return std::move(res *= scalar_cast(evaluated(rhs)));
+        }
+        if constexpr (is_matrix_expression<L>)
+            if (!lhs.is_rowwise())
+                return product_with(lhs.eval(), rhs, pool, tile);
+        if constexpr (is_matrix_expression<R>)
+            if (!rhs.is_rowwise())
+                return product_with(lhs, rhs.eval(), pool, tile);
+
+        if (lhs.width() != rhs.height())
+            throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+
+        OperationScope scope {Operation::product, std::max({lhs.height(), lhs.width(), rhs.width()}),
+                              product_flops(lhs.height(), rhs.width(), lhs.width())};
+        auto res = product_result<operand_matrix_t<L>>(lhs.height(), rhs.width());
+        product_to(res, lhs, rhs, pool, tile);
         return res;
     }
+}
+} // namespace detail
 
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-bool operator==(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
 {
-    return lhs.equal_to(rhs);
+    return detail::product_with(lhs, rhs, nullptr, 0);
 }
 
+/*
+ * Product on threads of pool: calls from tasks of this pool share its threads instead of starting new ones.
+ * tile - edge of output tiles scheduled on pool, 0 chooses it by sizes and number of threads.
+ */
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-bool operator!=(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs,
+                                                   ThreadPool& pool, std::size_t tile = 0)
 {
-    return !lhs.equal_to(rhs);
+    return detail::product_with(lhs, rhs, &pool, tile);
 }
 
+// product with 1 x 1 matrix reuses buffer of rvalue matrix
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> operator+(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
 {
-    MatrixArithmetic<T, IsDivArithm, Cmp, Abs> lhs_cpy (lhs);
-    return (lhs_cpy += rhs);
+    if (rhs.is_scalar() && !lhs.is_scalar())
+        return std::move(lhs *= scalar_cast(rhs));
+    return product(static_cast<const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&>(lhs), rhs);
 }
 
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> operator-(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&& rhs)
 {
-    MatrixArithmetic<T, IsDivArithm, Cmp, Abs> lhs_cpy (lhs);
-    return (lhs_cpy -= rhs);
+    if (lhs.is_scalar())
+        return std::move(rhs *= scalar_cast(lhs));
+    return product(lhs, static_cast<const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&>(rhs));
 }
 
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> operator*(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const T& rhs)
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&& lhs, MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&& rhs)
 {
-    MatrixArithmetic<T, IsDivArithm, Cmp, Abs> lhs_cpy (lhs);
-    return (lhs_cpy *= rhs);
+    if (lhs.is_scalar())
+        return product(static_cast<const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&>(lhs), std::move(rhs));
+    return product(std::move(lhs), static_cast<const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&>(rhs));
 }
 
-template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> operator*(const T& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs)
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R> &&
+                                          (detail::is_matrix_expression<L> || detail::is_matrix_expression<R>)
+detail::operand_matrix_t<L> product(const L& lhs, const R& rhs)
 {
-    return rhs * lhs;
+    return detail::product_with(lhs, rhs, nullptr, 0);
 }
 
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R> &&
+                                          (detail::is_matrix_expression<L> || detail::is_matrix_expression<R>)
+detail::operand_matrix_t<L> product(const L& lhs, const R& rhs, ThreadPool& pool, std::size_t tile = 0)
+{
+    return detail::product_with(lhs, rhs, &pool, tile);
+}
+
+template<detail::is_matrix_expression E>
+typename E::matrix_type power(const E& expr, long long pow)
+{
+    return power(expr.eval(), pow);
+}
+
+// binary exponentiation: O(log pow) products, three buffers are swapped between steps
 template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
-MatrixArithmetic<T, IsDivArithm, Cmp, Abs> operator/(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const T& rhs)
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> power(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat, long long pow)
+{
+    using MatrixT = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+
+    if (!mat.is_square())
+        throw std::invalid_argument{"Try to make matrix in some power but this matrix is not square"};
+
+    if (pow == 0)
+        return MatrixT::eye(mat.height());
+
+    // -pow overflows for LLONG_MIN
+    auto exp = pow < 0 ? 0ull - static_cast<unsigned long long>(pow) : static_cast<unsigned long long>(pow);
+
+    // products inside are counted here, not as separate calls of product
+    auto products = static_cast<std::uint64_t>(std::bit_width(exp) + std::popcount(exp) - 2);
+    detail::OperationScope scope {Operation::power, mat.height(), products * detail::product_flops(mat.height(), mat.height(), mat.height())};
+
+    MatrixT base;
+    if (pow < 0)
+    {
+        if constexpr (IsDivArithm)
+            base = mat.inverse();
+        else
+            throw std::invalid_argument{"Try to make matrix in negative power but division is not arithmetical correct"};
+    }
+    else
+        base = mat;
+
+    MatrixT tmp (mat.height(), mat.width());
+    auto square_base = [&base, &tmp]
+    {
+        detail::product_to(tmp, base, base);
+        std::swap(base, tmp);
+    };
+
+    // lowest set bit: res starts as copy of base, no multiplication by eye
+    for (; !(exp & 1); exp >>= 1)
+        square_base();
+    MatrixT res (base);
+
+    for (exp >>= 1; exp; exp >>= 1)
+    {
+        square_base();
+        if (exp & 1)
+        {
+            detail::product_to(tmp, res, base);
+            std::swap(res, tmp);
+        }
+    }
+    return res;
+}
+
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R>
+bool operator==(const L& lhs, const R& rhs)
+{
+    return detail::evaluated(lhs).equal_to(detail::evaluated(rhs));
+}
+
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R>
+bool operator!=(const L& lhs, const R& rhs)
+{
+    return !(lhs == rhs);
+}
+
+// element-wise operators dont compute anything, they return lazy expression evaluated on assignment
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R>
+auto operator+(L&& lhs, R&& rhs)
+{
+    return detail::ExprBinary<detail::ElementwiseOp::add, detail::expression_t<L>, detail::expression_t<R>>
+           {detail::as_expression(std::forward<L>(lhs)), detail::as_expression(std::forward<R>(rhs))};
+}
+
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R>
+auto operator-(L&& lhs, R&& rhs)
+{
+    return detail::ExprBinary<detail::ElementwiseOp::sub, detail::expression_t<L>, detail::expression_t<R>>
+           {detail::as_expression(std::forward<L>(lhs)), detail::as_expression(std::forward<R>(rhs))};
+}
+
+template<detail::is_matrix_operand E>
+auto operator-(E&& arg)
+{
+    return detail::ExprUnary<detail::ElementwiseOp::neg, detail::expression_t<E>>
+           {detail::as_expression(std::forward<E>(arg))};
+}
+
+template<detail::is_matrix_operand E>
+auto operator*(E&& lhs, const typename detail::operand_matrix_t<E>::value_type& rhs)
+{
+    return detail::ExprUnary<detail::ElementwiseOp::mul, detail::expression_t<E>>
+           {detail::as_expression(std::forward<E>(lhs)), rhs};
+}
+
+template<detail::is_matrix_operand E>
+auto operator*(const typename detail::operand_matrix_t<E>::value_type& lhs, E&& rhs)
+{
+    return std::forward<E>(rhs) * lhs;
+}
+
+template<detail::is_matrix_operand E>
+auto operator/(E&& lhs, const typename detail::operand_matrix_t<E>::value_type& rhs)
+{
+    return detail::ExprUnary<detail::ElementwiseOp::div, detail::expression_t<E>>
+           {detail::as_expression(std::forward<E>(lhs)), rhs};
+}
+
+template<detail::is_matrix_expression E>
+std::ostream& operator<<(std::ostream& os, const E& expr)
 {
-    MatrixArithmetic<T, IsDivArithm, Cmp, Abs> lhs_cpy (lhs);
-    return (lhs_cpy /= rhs);
+    return os << expr.eval();
 }
 //--------------------------------=| Arrithmetical operators end |=-------------------------------------
 } // namespace Matrix
\ No newline at end of file
@@ -0,0 +1,439 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Many small matrices of the same size for batched determinant, inverse,       |
+ * product and solve. Matrices are stored by blocks of lanes (8 doubles or 16  |
+ * floats, one cache line): inside block element (i, j) of all its matrices   |
+ * goes one after another, so one vector holds element (i, j) of lanes         |
+ * matrices and elimination of whole block is the scalar algorithm written    |
+ * with vectors. Pivots are chosen in every matrix separately.                 |
+ *                                                                              |
+ * Blocks are shared between threads of pool, kernels are compiled for         |
+ * AVX-512, AVX2 and SSE2 and picked at runtime like element-wise ones.        |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<std::floating_point T>
+class MatrixBatch
+{
+public:
+    using size_type       = std::size_t;
+    using value_type      = T;
+    using reference       = T&;
+    using const_reference = const T&;
+    using matrix_type     = MatrixArithmetic<T, true>;
+
+    static constexpr size_type lanes = 64 / sizeof(T);
+
+private:
+    size_type size_ = 0, height_ = 0, width_ = 0;
+    detail::AlignedBuffer<value_type> data_;
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    MatrixBatch() = default;
+
+    // count zero matrices, lanes of last block after count are unit matrices, so they are never singular
+    MatrixBatch(size_type count, size_type h, size_type w)
+    :size_ {count}, height_ {h}, width_ {w}, data_ (blocks() * block_size())
+    {
+        if (h != w || count == 0)
+            return;
+        auto last = block_data(blocks() - 1);
+        for (size_type lane = size_ - (blocks() - 1) * lanes; lane < lanes; lane++)
+            for (size_type i = 0; i < h; i++)
+                last[(i * w + i) * lanes + lane] = value_type{1};
+    }
+
+    // matrices of range must have the same sizes
+    template<std::forward_iterator It>
+    MatrixBatch(It begin, It end)
+    :MatrixBatch(static_cast<size_type>(std::distance(begin, end)),
+                 begin == end ? 0 : begin->height(), begin == end ? 0 : begin->width())
+    {
+        for (size_type b = 0; begin != end; ++begin)
+            set(b++, *begin);
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Acces start |=-----------------------------------------------------
+    size_type size()   const {return size_;}
+    size_type height() const {return height_;}
+    size_type width()  const {return width_;}
+
+    bool is_empty()  const {return size_ == 0;}
+    bool is_square() const {return height_ == width_;}
+
+    size_type blocks()     const {return (size_ + lanes - 1) / lanes;}
+    size_type block_size() const {return height_ * width_ * lanes;}
+
+    // element (i, j) of matrix b of block is block_data(k)[(i * width() + j) * lanes + b]
+    value_type*       block_data(size_type k)       {return data_.data() + k * block_size();}
+    const value_type* block_data(size_type k) const {return data_.data() + k * block_size();}
+
+    reference to(size_type b, size_type i, size_type j) noexcept
+    {
+        return block_data(b / lanes)[(i * width_ + j) * lanes + b % lanes];
+    }
+
+    const_reference to(size_type b, size_type i, size_type j) const noexcept
+    {
+        return block_data(b / lanes)[(i * width_ + j) * lanes + b % lanes];
+    }
+
+    reference at(size_type b, size_type i, size_type j)
+    {
+        if (b >= size_ || i >= height_ || j >= width_)
+            throw std::out_of_range{"try to get element of batch with index out of range"};
+        return to(b, i, j);
+    }
+
+    const_reference at(size_type b, size_type i, size_type j) const
+    {
+        if (b >= size_ || i >= height_ || j >= width_)
+            throw std::out_of_range{"try to get element of batch with index out of range"};
+        return to(b, i, j);
+    }
+
+    void set(size_type b, const MatrixContainer<value_type>& mat)
+    {
+        if (b >= size_)
+            throw std::out_of_range{"try to set matrix of batch with index out of range"};
+        if (mat.height() != height_ || mat.width() != width_)
+            throw std::invalid_argument{"Try to set matrix of batch with different height() * width()"};
+
+        for (size_type i = 0; i < height_; i++)
+            for (size_type j = 0; j < width_; j++)
+                to(b, i, j) = mat.to(i, j);
+    }
+
+    matrix_type matrix(size_type b) const
+    {
+        if (b >= size_)
+            throw std::out_of_range{"try to get matrix of batch with index out of range"};
+
+        matrix_type res (height_, width_);
+        for (size_type i = 0; i < height_; i++)
+            for (size_type j = 0; j < width_; j++)
+                res.to(i, j) = to(b, i, j);
+        return res;
+    }
+//--------------------------------=| Acces end |=-------------------------------------------------------
+}; // class MatrixBatch
+
+namespace detail
+{
+// blocks for one chunk of parallel_for
+inline constexpr std::size_t batch_min_grain = 16;
+
+template<typename T>
+struct BatchVec
+{
+    static constexpr std::size_t lanes = MatrixBatch<T>::lanes;
+    using index_type = std::conditional_t<sizeof(T) == 8, std::int64_t, std::int32_t>;
+
+    typedef T vec __attribute__((vector_size(64)));
+    typedef index_type ivec __attribute__((vector_size(64)));
+};
+
+/*
+ * Gaussian elimination of block of n x cols matrices with partial pivoting in
+ * every lane, det gets determinants of left n x n parts. Jordan: pivot rows
+ * are divided by pivots and columns are eliminated above pivots too, so left
+ * part becomes E and right part becomes solution. Zero pivot is replaced by 1
+ * to keep other lanes free of inf and nan, det of such lane is 0.
+ */
+template<bool Jordan, typename T>
+[[gnu::always_inline]] inline void batch_eliminate(T* work, std::size_t n, std::size_t cols, typename BatchVec<T>::vec& det)
+{
+    using vec  = typename BatchVec<T>::vec;
+    using ivec = typename BatchVec<T>::ivec;
+    constexpr std::size_t lanes = BatchVec<T>::lanes;
+    constexpr std::size_t bytes = sizeof(vec);
+
+    det = vec{} + 1;
+    for (std::size_t k = 0; k < n; k++)
+    {
+        vec best, cur;
+        ivec pivot_row = ivec{} + static_cast<typename BatchVec<T>::index_type>(k);
+        std::memcpy(&best, work + k * cols * lanes + k * lanes, bytes);
+        best = best < 0 ? -best : best;
+        for (std::size_t i = k + 1; i < n; i++)
+        {
+            std::memcpy(&cur, work + (i * cols + k) * lanes, bytes);
+            cur = cur < 0 ? -cur : cur;
+            auto greater = cur > best;
+            best = greater ? cur : best;
+            pivot_row = greater ? ivec{} + static_cast<typename BatchVec<T>::index_type>(i) : pivot_row;
+        }
+
+        for (std::size_t lane = 0; lane < lanes; lane++)
+        {
+            auto p = static_cast<std::size_t>(pivot_row[lane]);
+            if (p == k)
+                continue;
+            det[lane] = -det[lane];
+            for (std::size_t j = k; j < cols; j++)
+                std::swap(work[(k * cols + j) * lanes + lane], work[(p * cols + j) * lanes + lane]);
+        }
+
+        vec pivot;
+        std::memcpy(&pivot, work + (k * cols + k) * lanes, bytes);
+        det *= pivot;
+        vec inv = 1 / (pivot == 0 ? vec{} + 1 : pivot);
+
+        T* pivot_row_data = work + k * cols * lanes;
+        if constexpr (Jordan)
+            for (std::size_t j = k; j < cols; j++)
+            {
+                std::memcpy(&cur, pivot_row_data + j * lanes, bytes);
+                cur *= inv;
+                std::memcpy(pivot_row_data + j * lanes, &cur, bytes);
+            }
+
+        for (std::size_t i = Jordan ? 0 : k + 1; i < n; i++)
+        {
+            if (i == k)
+                continue;
+            T* row = work + i * cols * lanes;
+            vec factor, elem;
+            std::memcpy(&factor, row + k * lanes, bytes);
+            if constexpr (!Jordan)
+                factor *= inv;
+            for (std::size_t j = Jordan ? k : k + 1; j < cols; j++)
+            {
+                std::memcpy(&cur, row + j * lanes, bytes);
+                std::memcpy(&elem, pivot_row_data + j * lanes, bytes);
+                cur -= factor * elem;
+                std::memcpy(row + j * lanes, &cur, bytes);
+            }
+        }
+    }
+}
+
+// blocks [first, last) of batch by kernel(block, work), work is buffer of kernel.work_size() elements
+template<typename Kernel>
+[[gnu::always_inline]] inline void batch_blocks_loop(const Kernel& kernel, std::size_t first, std::size_t last)
+{
+    AlignedBuffer<typename Kernel::value_type> work (kernel.work_size());
+    for (std::size_t k = first; k < last; k++)
+        kernel(k, work.data());
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template<typename Kernel>
+__attribute__((target("avx512f"))) void batch_blocks_avx512(const Kernel& kernel, std::size_t first, std::size_t last)
+{
+    batch_blocks_loop(kernel, first, last);
+}
+
+template<typename Kernel>
+__attribute__((target("avx2"))) void batch_blocks_avx2(const Kernel& kernel, std::size_t first, std::size_t last)
+{
+    batch_blocks_loop(kernel, first, last);
+}
+#endif
+
+template<typename Kernel>
+void batch_blocks(const Kernel& kernel, std::size_t first, std::size_t last)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level())
+    {
+        case SimdLevel::avx512: return batch_blocks_avx512(kernel, first, last);
+        case SimdLevel::avx2:   return batch_blocks_avx2(kernel, first, last);
+        default: break;
+    }
+#endif
+    batch_blocks_loop(kernel, first, last);
+}
+
+template<typename Kernel>
+void batch_for(std::size_t blocks, const Kernel& kernel, ThreadPool& pool)
+{
+    auto grain = std::max((blocks + 4 * pool.num_threads() - 1) / (4 * pool.num_threads()), batch_min_grain);
+    pool.parallel_for(0, blocks, grain, [&](std::size_t first, std::size_t last) {batch_blocks(kernel, first, last);});
+}
+
+// det[k * lanes + lane] = determinant of matrix lane of block k
+template<typename T>
+struct BatchDeterminant
+{
+    using value_type = T;
+    const MatrixBatch<T>& a;
+    T* det;
+
+    std::size_t work_size() const {return a.block_size();}
+
+    [[gnu::always_inline]] void operator()(std::size_t k, T* work) const
+    {
+        typename BatchVec<T>::vec res;
+        std::memcpy(work, a.block_data(k), a.block_size() * sizeof(T));
+        batch_eliminate<false>(work, a.height(), a.width(), res);
+        std::memcpy(det + k * MatrixBatch<T>::lanes, &res, sizeof(res));
+    }
+};
+
+// res = a^-1 * b, b is unit matrix for inverse (b == nullptr), det as in BatchDeterminant
+template<typename T>
+struct BatchSolve
+{
+    using value_type = T;
+    const MatrixBatch<T>& a;
+    const MatrixBatch<T>* b;
+    MatrixBatch<T>& res;
+    T* det;
+
+    std::size_t width() const {return b ? b->width() : a.height();}
+    std::size_t work_size() const {return a.height() * (a.height() + width()) * MatrixBatch<T>::lanes;}
+
+    [[gnu::always_inline]] void operator()(std::size_t k, T* work) const
+    {
+        constexpr std::size_t lanes = MatrixBatch<T>::lanes;
+        auto n = a.height(), m = width(), cols = n + m;
+
+        const T* a_block = a.block_data(k);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            T* row = work + i * cols * lanes;
+            std::memcpy(row, a_block + i * n * lanes, n * lanes * sizeof(T));
+            if (b)
+                std::memcpy(row + n * lanes, b->block_data(k) + i * m * lanes, m * lanes * sizeof(T));
+            else
+            {
+                std::memset(row + n * lanes, 0, m * lanes * sizeof(T));
+                for (std::size_t lane = 0; lane < lanes; lane++)
+                    row[(n + i) * lanes + lane] = T{1};
+            }
+        }
+
+        typename BatchVec<T>::vec block_det;
+        batch_eliminate<true>(work, n, cols, block_det);
+        std::memcpy(det + k * lanes, &block_det, sizeof(block_det));
+
+        T* res_block = res.block_data(k);
+        for (std::size_t i = 0; i < n; i++)
+            std::memcpy(res_block + i * m * lanes, work + (i * cols + n) * lanes, m * lanes * sizeof(T));
+    }
+};
+
+template<typename T>
+struct BatchProduct
+{
+    using value_type = T;
+    const MatrixBatch<T>& a;
+    const MatrixBatch<T>& b;
+    MatrixBatch<T>& res;
+
+    std::size_t work_size() const {return 0;}
+
+    [[gnu::always_inline]] void operator()(std::size_t k, T*) const
+    {
+        using vec = typename BatchVec<T>::vec;
+        constexpr std::size_t lanes = MatrixBatch<T>::lanes;
+        auto h = a.height(), inner = a.width(), w = b.width();
+        const T* a_block = a.block_data(k);
+        const T* b_block = b.block_data(k);
+        T* res_block = res.block_data(k);
+
+        for (std::size_t i = 0; i < h; i++)
+            for (std::size_t j = 0; j < w; j++)
+            {
+                vec acc {}, lhs, rhs;
+                for (std::size_t p = 0; p < inner; p++)
+                {
+                    std::memcpy(&lhs, a_block + (i * inner + p) * lanes, sizeof(vec));
+                    std::memcpy(&rhs, b_block + (p * w + j) * lanes, sizeof(vec));
+                    acc += lhs * rhs;
+                }
+                std::memcpy(res_block + (i * w + j) * lanes, &acc, sizeof(vec));
+            }
+    }
+};
+
+template<typename T>
+bool batch_has_zero(const std::vector<T>& det, std::size_t size)
+{
+    for (std::size_t b = 0; b < size; b++)
+        if (det[b] == T{})
+            return true;
+    return false;
+}
+} // namespace detail
+
+//--------------------------------=| Batched algorithms start |=----------------------------------------
+template<std::floating_point T>
+std::vector<T> determinant(const MatrixBatch<T>& batch, ThreadPool& pool = default_pool())
+{
+    if (!batch.is_square())
+        throw std::invalid_argument{"try to get determinant() of no square matrix"};
+
+    std::vector<T> res (batch.blocks() * MatrixBatch<T>::lanes);
+    detail::batch_for(batch.blocks(), detail::BatchDeterminant<T>{batch, res.data()}, pool);
+    res.resize(batch.size());
+    return res;
+}
+
+template<std::floating_point T>
+MatrixBatch<T> inverse(const MatrixBatch<T>& batch, ThreadPool& pool = default_pool())
+{
+    if (!batch.is_square())
+        throw std::invalid_argument{"try to get inverse matrix of no square matrix"};
+
+    MatrixBatch<T> res (batch.size(), batch.height(), batch.width());
+    std::vector<T> det (batch.blocks() * MatrixBatch<T>::lanes);
+    detail::batch_for(batch.blocks(), detail::BatchSolve<T>{batch, nullptr, res, det.data()}, pool);
+
+    if (detail::batch_has_zero(det, batch.size()))
+        throw std::invalid_argument{"try to get inverse matrix for matrix with determinant equal to zero"};
+    return res;
+}
+
+// X[b]: lhs[b] * X[b] = rhs[b]
+template<std::floating_point T>
+MatrixBatch<T> solve(const MatrixBatch<T>& lhs, const MatrixBatch<T>& rhs, ThreadPool& pool = default_pool())
+{
+    if (!lhs.is_square())
+        throw std::invalid_argument{"try to solve system with no square matrix"};
+    if (lhs.height() != rhs.height())
+        throw std::invalid_argument{"in solve: rhs.height() != lhs.height()"};
+    if (lhs.size() != rhs.size())
+        throw std::invalid_argument{"in solve: rhs.size() != lhs.size()"};
+
+    MatrixBatch<T> res (rhs.size(), rhs.height(), rhs.width());
+    std::vector<T> det (lhs.blocks() * MatrixBatch<T>::lanes);
+    detail::batch_for(lhs.blocks(), detail::BatchSolve<T>{lhs, &rhs, res, det.data()}, pool);
+
+    if (detail::batch_has_zero(det, lhs.size()))
+        throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+    return res;
+}
+
+template<std::floating_point T>
+MatrixBatch<T> product(const MatrixBatch<T>& lhs, const MatrixBatch<T>& rhs, ThreadPool& pool = default_pool())
+{
+    if (lhs.width() != rhs.height())
+        throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+    if (lhs.size() != rhs.size())
+        throw std::invalid_argument{"in product: rhs.size() != lhs.size()"};
+
+    MatrixBatch<T> res (lhs.size(), lhs.height(), rhs.width());
+    detail::batch_for(lhs.blocks(), detail::BatchProduct<T>{lhs, rhs, res}, pool);
+    return res;
+}
+//--------------------------------=| Batched algorithms end |=------------------------------------------
+
+} // namespace Matrix
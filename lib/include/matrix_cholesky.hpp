@@ -0,0 +1,905 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <utility>
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+#include "matrix_lu.hpp"
+#include "matrix_transpose.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Right-looking blocked Cholesky: A = L * L^T in place, only lower triangle    |
+ * of A is read. For every panel of nb columns:                                 |
+ *   1. L11 = chol(A11) row by row;                                             |
+ *   2. L21 = A21 * L11^-T, rows of L21 are split between threads;              |
+ *   3. A22 -= L21 * L21^T by GEMM kernel over packed L21^T, row block [lo, hi) |
+ *      of A22 updates only columns [0, hi), so half of work of LU is done.     |
+ * At the end L^T is copied above diagonal, so solves go through lower_solve /  |
+ * upper_solve of LU.                                                           |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+
+// returns n or index of first pivot that is not positive (matrix is not positive definite)
+template<typename T>
+std::size_t blocked_cholesky(MatrixContainer<T>& mat, ThreadPool& pool, std::size_t nb = lu_block_size)
+{
+    using size_type = std::size_t;
+    if (!mat.is_square())
+        throw std::invalid_argument{"try to make Cholesky decomposition of no square matrix"};
+
+    const size_type n = mat.height();
+    const size_type threads = pool.num_threads();
+    nb = std::max<size_type>(nb, 1);
+
+    // L11^T and L21^T of current panel, the first panel is the widest
+    AlignedBuffer<T> diag_block, packed;
+    if (n > nb)
+    {
+        diag_block = AlignedBuffer<T>(nb * nb);
+        if constexpr (is_gemm_available<T>)
+            packed = AlignedBuffer<T>(nb * (n - nb));
+    }
+
+    for (size_type k0 = 0; k0 < n; k0 += nb)
+    {
+        const size_type kb = std::min(nb, n - k0);
+        const size_type k_end = k0 + kb;
+
+        // l[i][j] = (a[i][j] - l[i][k0 : j] * l[j][k0 : j]) / l[j][j], earlier panels are already subtracted
+        auto solve_row = [&mat, k0](size_type i, size_type j_end)
+        {
+            T* row = mat[i].data();
+            for (size_type j = k0; j < j_end; j++)
+            {
+                const T* pivot_row = mat[j].data();
+                T sum = row[j];
+                for (size_type p = k0; p < j; p++)
+                    sum -= row[p] * pivot_row[p];
+                row[j] = sum / pivot_row[j];
+            }
+        };
+
+        // 1. L11
+        for (size_type i = k0; i < k_end; i++)
+        {
+            solve_row(i, i);
+            T* row = mat[i].data();
+            T diag = row[i];
+            for (size_type p = k0; p < i; p++)
+                diag -= row[p] * row[p];
+            if (!(diag > T{0}))
+                return i;
+            row[i] = std::sqrt(diag);
+        }
+
+        if (k_end == n)
+            break;
+
+        // 2. L21 = A21 * L11^-T, columns of L11 are rows of L11^T, so every row is solved by contiguous axpy
+        const size_type rest = n - k_end;
+        T* l11t = diag_block.data();
+        transpose_to<T>(kb, kb,
+                        [&mat, k0](size_type i) {return static_cast<const T*>(mat[k0 + i].data() + k0);},
+                        [l11t, kb](size_type p) {return l11t + p * kb;});
+
+        auto solve_rows = [&mat, l11t, k0, kb](size_type lo, size_type hi)
+        {
+            for (size_type i = lo; i < hi; i++)
+            {
+                T* row = mat[i].data() + k0;
+                for (size_type j = 0; j < kb; j++)
+                {
+                    const T* col = l11t + j * kb;
+                    row[j] /= col[j];
+                    T coef = -row[j];
+                    elementwise<ElementwiseOp::axpy>(row + j + 1, col + j + 1, coef, kb - j - 1);
+                }
+            }
+        };
+        pool.parallel_for(k_end, n, std::max<size_type>((rest + threads - 1) / threads, lu_min_grain), solve_rows);
+
+        // 3. A22 -= L21 * L21^T, lower trapezoid of every row block
+        if constexpr (is_gemm_available<T>)
+        {
+            T* buf = packed.data();
+            transpose_to<T>(rest, kb,
+                            [&mat, k0, k_end](size_type i) {return static_cast<const T*>(mat[k_end + i].data() + k0);},
+                            [buf, rest](size_type p) {return buf + p * rest;});
+
+            auto update = [&mat, buf, k0, kb, k_end, rest](size_type lo, size_type hi)
+            {
+                gemm<T>(hi - lo, hi, kb,
+                        [&mat, k0, k_end, lo](size_type i) {return static_cast<const T*>(mat[k_end + lo + i].data() + k0);},
+                        [buf, rest](size_type p) {return static_cast<const T*>(buf + p * rest);},
+                        [&mat, k_end, lo](size_type i) {return mat[k_end + lo + i].data() + k_end;},
+                        T{-1});
+            };
+            // lower rows have more work, so chunks are stolen by free threads
+            pool.parallel_for_stealing(0, rest, std::max<size_type>((rest + 2 * threads - 1) / (2 * threads), lu_min_grain), update);
+        }
+        else
+        {
+            auto update = [&mat, k0, k_end](size_type lo, size_type hi)
+            {
+                for (size_type i = lo; i < hi; i++)
+                {
+                    T* row = mat[i].data();
+                    for (size_type c = k_end; c <= i; c++)
+                    {
+                        const T* col_row = mat[c].data();
+                        T sum {};
+                        for (size_type p = k0; p < k_end; p++)
+                            sum += row[p] * col_row[p];
+                        row[c] -= sum;
+                    }
+                }
+            };
+            pool.parallel_for_stealing(k_end, n, std::max<size_type>((rest + 2 * threads - 1) / (2 * threads), lu_min_grain), update);
+        }
+    }
+
+    // U = L^T above diagonal, tile by tile
+    for (size_type i0 = 0; i0 < n; i0 += transpose_tile)
+        for (size_type j0 = 0; j0 <= i0; j0 += transpose_tile)
+            for (size_type i = i0; i < std::min(i0 + transpose_tile, n); i++)
+                for (size_type j = j0; j < std::min(j0 + transpose_tile, i); j++)
+                    mat[j][i] = mat[i][j];
+
+    return n;
+}
+
+// Bunch-Kaufman constant: growth of elements is bounded like in partial pivoting of LU
+template<typename T>
+inline constexpr T bunch_kaufman_alpha = T(0.6403882032022076);  // (1 + sqrt(17)) / 8
+
+/*
+ * Symmetric exchange of rows and columns kk < kp of matrix kept in lower triangle:
+ * rows of L left of kk are exchanged whole, like rows of LU are exchanged by swap_row.
+ */
+template<typename T>
+void symmetric_swap_lower(MatrixContainer<T>& mat, std::size_t kk, std::size_t kp)
+{
+    using std::swap;
+    const std::size_t n = mat.height();
+    for (std::size_t j = 0; j < kk; j++)
+        swap(mat[kk][j], mat[kp][j]);
+    swap(mat[kk][kk], mat[kp][kp]);
+    for (std::size_t j = kk + 1; j < kp; j++)
+        swap(mat[j][kk], mat[kp][j]);
+    for (std::size_t i = kp + 1; i < n; i++)
+        swap(mat[i][kk], mat[i][kp]);
+}
+
+} // namespace detail
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * A = L * L^T of symmetric positive definite matrix made once by blocked       |
+ * Cholesky on threads: half of flops of LU and no pivoting. Only lower         |
+ * triangle of matrix is read. Matrix that is not positive definite throws.     |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<std::floating_point T = double, bool IsDivArithm = true, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class CholeskyDecomposition
+{
+    static_assert(IsDivArithm, "Cholesky decomposition needs arithmetical correct division");
+
+public:
+    using matrix_type = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+    using size_type   = typename matrix_type::size_type;
+    using value_type  = typename matrix_type::value_type;
+
+private:
+    // L under diagonal and on it, L^T above diagonal
+    matrix_type factor_;
+    ThreadPool* pool_;      // pool of factorization, solves run on it too, so it must outlive decomposition
+
+    void factorize(ThreadPool& pool)
+    {
+        if (detail::blocked_cholesky(factor_, pool) != factor_.height())
+            throw std::invalid_argument{"try to make Cholesky decomposition of not positive definite matrix"};
+    }
+
+    void check_rhs(size_type height) const
+    {
+        if (height != size())
+            throw std::invalid_argument{"in solve: rhs.height() != size of Cholesky decomposition"};
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    explicit CholeskyDecomposition(const matrix_type& mat, ThreadPool& pool = default_pool())
+    :factor_ {mat}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+
+    // factorizes in place of mat, no copy
+    explicit CholeskyDecomposition(matrix_type&& mat, ThreadPool& pool = default_pool())
+    :factor_ {std::move(mat)}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+
+    template<detail::is_matrix_expression E>
+    explicit CholeskyDecomposition(const E& expr, ThreadPool& pool = default_pool()) requires std::same_as<typename E::matrix_type, matrix_type>
+    :factor_ {expr}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Factors start |=---------------------------------------------------
+    size_type size() const {return factor_.height();}
+
+    matrix_type lower() const
+    {
+        matrix_type res (size(), size());
+        for (size_type i = 0; i < size(); i++)
+            for (size_type j = 0; j <= i; j++)
+                res.to(i, j) = factor_.to(i, j);
+        return res;
+    }
+//--------------------------------=| Factors end |=-----------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    value_type determinant() const
+    {
+        value_type res {1};
+        for (size_type i = 0; i < size(); i++)
+            res *= factor_.to(i, i) * factor_.to(i, i);
+        return res;
+    }
+
+    // log(det A), finite when determinant itself overflows or underflows
+    value_type log_determinant() const
+    {
+        value_type res {};
+        for (size_type i = 0; i < size(); i++)
+            res += std::log(factor_.to(i, i));
+        return 2 * res;
+    }
+
+    // X: A * X = rhs, rhs may have any number of columns
+    matrix_type solve(const matrix_type& rhs) const
+    {
+        check_rhs(rhs.height());
+        matrix_type res (rhs);
+        detail::lower_solve(factor_, res, false, *pool_);
+        detail::upper_solve(factor_, res, *pool_);
+        return res;
+    }
+
+    std::vector<value_type> solve(const std::vector<value_type>& rhs) const
+    {
+        check_rhs(rhs.size());
+        matrix_type res (rhs.size(), 1, rhs.begin(), rhs.end());
+        detail::lower_solve(factor_, res, false, *pool_);
+        detail::upper_solve(factor_, res, *pool_);
+
+        std::vector<value_type> res_vec (rhs.size());
+        for (size_type i = 0; i < res_vec.size(); i++)
+            res_vec[i] = res.to(i, 0);
+        return res_vec;
+    }
+
+    matrix_type inverse() const {return solve(matrix_type::eye(size()));}
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class CholeskyDecomposition
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+CholeskyDecomposition(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&) -> CholeskyDecomposition<T, IsDivArithm, Cmp, Abs>;
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+CholeskyDecomposition(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&, ThreadPool&) -> CholeskyDecomposition<T, IsDivArithm, Cmp, Abs>;
+
+template<detail::is_matrix_expression E>
+CholeskyDecomposition(const E&) -> CholeskyDecomposition<typename E::value_type,
+                                                         detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                                         typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                                         typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
+template<detail::is_matrix_expression E>
+CholeskyDecomposition(const E&, ThreadPool&) -> CholeskyDecomposition<typename E::value_type,
+                                                                      detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                                                      typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                                                      typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * P * A * P^T = L * D * L^T of symmetric (maybe indefinite) matrix by          |
+ * Bunch-Kaufman pivoting: D has blocks 1 x 1 and 2 x 2, L has unit diagonal.   |
+ * Choice of pivot needs whole column, so columns are eliminated one by one,    |
+ * trailing rank-1 / rank-2 updates are split between threads by rows.          |
+ * Only lower triangle of matrix is read.                                       |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<std::floating_point T = double, bool IsDivArithm = true, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class LDLTDecomposition
+{
+    static_assert(IsDivArithm, "LDLT decomposition needs arithmetical correct division");
+
+public:
+    using matrix_type = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+    using size_type   = typename matrix_type::size_type;
+    using value_type  = typename matrix_type::value_type;
+
+private:
+    // L under diagonal, L^T above it, ones on diagonal
+    matrix_type factor_;
+    // diagonal of D and element under diagonal of 2 x 2 blocks, exact zero marks 1 x 1 block
+    std::vector<value_type> diag_, subdiag_;
+    // pivots_[k] is row and column exchanged with k on step k
+    std::vector<size_type> pivots_;
+    bool singular_ = false;
+    ThreadPool* pool_;      // pool of factorization, solves run on it too, so it must outlive decomposition
+    Cmp cmp {};
+
+    void factorize(ThreadPool& pool)
+    {
+        if (!factor_.is_square())
+            throw std::invalid_argument{"try to make LDLT decomposition of no square matrix"};
+
+        const size_type n = size();
+        const size_type threads = pool.num_threads();
+        const value_type alpha = detail::bunch_kaufman_alpha<value_type>;
+        const value_type null_obj {};
+        Abs abs {};
+        auto& a = factor_;
+
+        diag_.assign(n, value_type{});
+        subdiag_.assign(n, value_type{});
+        pivots_.resize(n);
+        for (size_type k = 0; k < n; k++)
+            pivots_[k] = k;
+
+        // columns k, k + 1 of trailing matrix before update, rows of the trailing matrix read them contiguously
+        std::vector<value_type> w1 (n), w2 (n);
+
+        for (size_type k = 0; k < n;)
+        {
+            value_type absakk = abs(a[k][k]), colmax {};
+            size_type imax = k;
+            for (size_type i = k + 1; i < n; i++)
+                if (abs(a[i][k]) > colmax)
+                {
+                    colmax = abs(a[i][k]);
+                    imax = i;
+                }
+
+            size_type kstep = 1, kp = k;
+            if (cmp(std::max(absakk, colmax), null_obj))
+            {
+                // zero column: D[k][k] = 0, column of L stays zero
+                singular_ = true;
+                a[k][k] = null_obj;
+                k++;
+                continue;
+            }
+            if (absakk < alpha * colmax)
+            {
+                value_type rowmax {};
+                for (size_type j = k; j < imax; j++)
+                    rowmax = std::max(rowmax, abs(a[imax][j]));
+                for (size_type i = imax + 1; i < n; i++)
+                    rowmax = std::max(rowmax, abs(a[i][imax]));
+
+                if (absakk * rowmax < alpha * colmax * colmax)
+                {
+                    kp = imax;
+                    if (abs(a[imax][imax]) < alpha * rowmax)
+                        kstep = 2;
+                }
+            }
+
+            const size_type kk = k + kstep - 1;
+            if (kp != kk)
+            {
+                detail::symmetric_swap_lower(a, kk, kp);
+                pivots_[kk] = kp;
+            }
+
+            const size_type first = k + kstep;
+            if (kstep == 1)
+            {
+                const value_type d = a[k][k];
+                diag_[k] = d;
+                for (size_type i = first; i < n; i++)
+                {
+                    w1[i] = a[i][k];
+                    a[i][k] /= d;
+                }
+            }
+            else
+            {
+                // D^-1 is applied in scaled form of LAPACK sytf2, it keeps cancellation small
+                const value_type d21 = a[k + 1][k];
+                const value_type d11 = a[k + 1][k + 1] / d21;
+                const value_type d22 = a[k][k] / d21;
+                const value_type t = value_type{1} / (d11 * d22 - value_type{1});
+                const value_type scale = t / d21;
+
+                diag_[k] = a[k][k];
+                diag_[k + 1] = a[k + 1][k + 1];
+                subdiag_[k] = d21;
+                a[k + 1][k] = null_obj;
+                for (size_type i = first; i < n; i++)
+                {
+                    w1[i] = a[i][k];
+                    w2[i] = a[i][k + 1];
+                    a[i][k]     = scale * (d11 * w1[i] - w2[i]);
+                    a[i][k + 1] = scale * (d22 * w2[i] - w1[i]);
+                }
+            }
+
+            // A22 -= L21 * D * L21^T = L21 * W^T, lower triangle only
+            auto update = [&a, &w1, &w2, k, kstep, first](size_type lo, size_type hi)
+            {
+                for (size_type i = lo; i < hi; i++)
+                {
+                    value_type* row = a[i].data();
+                    value_type coef = -row[k];
+                    detail::elementwise<detail::ElementwiseOp::axpy>(row + first, w1.data() + first, coef, i + 1 - first);
+                    if (kstep == 2)
+                    {
+                        coef = -row[k + 1];
+                        detail::elementwise<detail::ElementwiseOp::axpy>(row + first, w2.data() + first, coef, i + 1 - first);
+                    }
+                }
+            };
+            const size_type rest = n - first;
+            if (rest * rest / 2 >= detail::lu_parallel_panel)
+                pool.parallel_for_stealing(first, n, std::max<size_type>((rest + 2 * threads - 1) / (2 * threads), detail::lu_min_grain), update);
+            else
+                update(first, n);
+
+            k += kstep;
+        }
+
+        // ones on diagonal and L^T above it, so solves go through lower_solve / upper_solve of LU
+        for (size_type i = 0; i < n; i++)
+        {
+            a[i][i] = value_type{1};
+            for (size_type j = 0; j < i; j++)
+                a[j][i] = a[i][j];
+        }
+    }
+
+    void check_regular() const
+    {
+        if (singular_)
+            throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+    }
+
+    // P * A * P^T * Y = P * B with Y = P * X, rows are exchanged by O(1) swap_row
+    void solve_inplace(matrix_type& x) const
+    {
+        check_regular();
+        if (x.height() != size())
+            throw std::invalid_argument{"in solve: rhs.height() != size of LDLT decomposition"};
+
+        const size_type n = size(), m = x.width();
+        for (size_type k = 0; k < n; k++)
+            if (pivots_[k] != k)
+                x.swap_row(k, pivots_[k]);
+
+        detail::lower_solve(factor_, x, true, *pool_);
+        for (size_type k = 0; k < n; k++)
+        {
+            if (subdiag_[k] == value_type{})
+            {
+                value_type inv = value_type{1} / diag_[k];
+                detail::elementwise<detail::ElementwiseOp::mul>(x[k].data(), x[k].data(), inv, m);
+                continue;
+            }
+            const value_type det = diag_[k] * diag_[k + 1] - subdiag_[k] * subdiag_[k];
+            for (size_type j = 0; j < m; j++)
+            {
+                value_type first = x[k][j], second = x[k + 1][j];
+                x[k][j]     = (diag_[k + 1] * first - subdiag_[k] * second) / det;
+                x[k + 1][j] = (diag_[k] * second - subdiag_[k] * first) / det;
+            }
+            k++;
+        }
+        detail::upper_solve(factor_, x, *pool_);
+
+        for (size_type k = n; k-- > 0;)
+            if (pivots_[k] != k)
+                x.swap_row(k, pivots_[k]);
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    explicit LDLTDecomposition(const matrix_type& mat, ThreadPool& pool = default_pool())
+    :factor_ {mat}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+
+    // factorizes in place of mat, no copy
+    explicit LDLTDecomposition(matrix_type&& mat, ThreadPool& pool = default_pool())
+    :factor_ {std::move(mat)}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+
+    template<detail::is_matrix_expression E>
+    explicit LDLTDecomposition(const E& expr, ThreadPool& pool = default_pool()) requires std::same_as<typename E::matrix_type, matrix_type>
+    :factor_ {expr}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Factors start |=---------------------------------------------------
+    size_type size() const {return factor_.height();}
+    bool is_singular() const {return singular_;}
+
+    // pivots()[k] is row and column exchanged with k on step k
+    const std::vector<size_type>& pivots() const {return pivots_;}
+
+    // permutation()[i] is row of A that became row i of P * A * P^T
+    std::vector<size_type> permutation() const
+    {
+        std::vector<size_type> res (size());
+        for (size_type i = 0; i < size(); i++)
+            res[i] = i;
+        for (size_type k = 0; k < size(); k++)
+            std::swap(res[k], res[pivots_[k]]);
+        return res;
+    }
+
+    matrix_type lower() const
+    {
+        matrix_type res = matrix_type::eye(size());
+        for (size_type i = 0; i < size(); i++)
+            for (size_type j = 0; j < i; j++)
+                res.to(i, j) = factor_.to(i, j);
+        return res;
+    }
+
+    // block diagonal D
+    matrix_type block_diagonal() const
+    {
+        matrix_type res (size(), size());
+        for (size_type i = 0; i < size(); i++)
+        {
+            res.to(i, i) = diag_[i];
+            if (subdiag_[i] != value_type{})
+                res.to(i + 1, i) = res.to(i, i + 1) = subdiag_[i];
+        }
+        return res;
+    }
+//--------------------------------=| Factors end |=-----------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    value_type determinant() const
+    {
+        value_type res {1};
+        for (size_type k = 0; k < size(); k++)
+            if (subdiag_[k] == value_type{})
+                res *= diag_[k];
+            else
+            {
+                res *= diag_[k] * diag_[k + 1] - subdiag_[k] * subdiag_[k];
+                k++;
+            }
+        return res;
+    }
+
+    // {sign of det A, log |det A|}, log is finite when determinant itself overflows or underflows
+    std::pair<value_type, value_type> sign_log_determinant() const
+    {
+        value_type sign {1}, log_abs {};
+        for (size_type k = 0; k < size(); k++)
+        {
+            value_type block = diag_[k];
+            if (subdiag_[k] != value_type{})
+            {
+                block = diag_[k] * diag_[k + 1] - subdiag_[k] * subdiag_[k];
+                k++;
+            }
+            if (block < value_type{})
+                sign = -sign;
+            log_abs += std::log(std::abs(block));
+        }
+        return {singular_ ? value_type{} : sign, log_abs};
+    }
+
+    // X: A * X = rhs, rhs may have any number of columns
+    matrix_type solve(const matrix_type& rhs) const
+    {
+        matrix_type res (rhs);
+        solve_inplace(res);
+        return res;
+    }
+
+    std::vector<value_type> solve(const std::vector<value_type>& rhs) const
+    {
+        matrix_type res (rhs.size(), 1, rhs.begin(), rhs.end());
+        solve_inplace(res);
+
+        std::vector<value_type> res_vec (rhs.size());
+        for (size_type i = 0; i < res_vec.size(); i++)
+            res_vec[i] = res.to(i, 0);
+        return res_vec;
+    }
+
+    matrix_type inverse() const
+    {
+        if (singular_)
+            throw std::invalid_argument{"try to get inverse matrix for matrix with determinant equal to zero"};
+        return solve(matrix_type::eye(size()));
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class LDLTDecomposition
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+LDLTDecomposition(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&) -> LDLTDecomposition<T, IsDivArithm, Cmp, Abs>;
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+LDLTDecomposition(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&, ThreadPool&) -> LDLTDecomposition<T, IsDivArithm, Cmp, Abs>;
+
+template<detail::is_matrix_expression E>
+LDLTDecomposition(const E&) -> LDLTDecomposition<typename E::value_type,
+                                                 detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                                 typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                                 typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
+template<detail::is_matrix_expression E>
+LDLTDecomposition(const E&, ThreadPool&) -> LDLTDecomposition<typename E::value_type,
+                                                              detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                                              typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                                              typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Symmetric matrix keeps only lower triangle: n * (n + 1) / 2 elements row     |
+ * after row in one aligned buffer, row i starts at i * (i + 1) / 2. to(i, j)   |
+ * and to(j, i) are the same element.                                           |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T = double>
+class PackedSymmetricMatrix
+{
+public:
+    using size_type  = std::size_t;
+    using value_type = T;
+
+private:
+    size_type n_ = 0;
+    detail::AlignedBuffer<T> data_;
+
+    static size_type offset(size_type i) {return i * (i + 1) / 2;}
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    explicit PackedSymmetricMatrix(size_type n = 0)
+    :n_ {n}, data_ (offset(n), T{})
+    {}
+
+    // lower triangle of mat is taken, upper one isnt read
+    template<bool IsDivArithm, class Cmp, class Abs>
+    explicit PackedSymmetricMatrix(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat)
+    :n_ {mat.height()}
+    {
+        if (!mat.is_square())
+            throw std::invalid_argument{"try to make packed symmetric matrix of no square matrix"};
+        data_ = detail::AlignedBuffer<T>(offset(n_));
+        for (size_type i = 0; i < n_; i++)
+            std::copy_n(mat[i].data(), i + 1, row(i));
+    }
+
+    PackedSymmetricMatrix(const PackedSymmetricMatrix& rhs)
+    :n_ {rhs.n_}, data_ (rhs.data_.size())
+    {
+        std::copy_n(rhs.data_.data(), data_.size(), data_.data());
+        detail::note_copied(data_.size() * sizeof(T));
+    }
+
+    PackedSymmetricMatrix& operator=(const PackedSymmetricMatrix& rhs)
+    {
+        return *this = PackedSymmetricMatrix{rhs};
+    }
+
+    PackedSymmetricMatrix(PackedSymmetricMatrix&& rhs) noexcept
+    :n_ {std::exchange(rhs.n_, 0)}, data_ {std::move(rhs.data_)}
+    {}
+
+    PackedSymmetricMatrix& operator=(PackedSymmetricMatrix&& rhs) noexcept
+    {
+        std::swap(n_, rhs.n_);
+        std::swap(data_, rhs.data_);
+        return *this;
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Access start |=----------------------------------------------------
+    size_type size() const {return n_;}
+
+    // number of stored elements, dense matrix has n * n
+    size_type packed_size() const {return data_.size();}
+
+    T& to(size_type i, size_type j) {return i >= j ? data_[offset(i) + j] : data_[offset(j) + i];}
+    const T& to(size_type i, size_type j) const {return i >= j ? data_[offset(i) + j] : data_[offset(j) + i];}
+
+    // first i + 1 elements of row i: to(i, 0) ... to(i, i)
+    T* row(size_type i) {return data_.data() + offset(i);}
+    const T* row(size_type i) const {return data_.data() + offset(i);}
+
+    template<class M = MatrixArithmetic<T, true>>
+    M to_dense() const
+    {
+        M res (n_, n_);
+        for (size_type i = 0; i < n_; i++)
+            for (size_type j = 0; j <= i; j++)
+                res.to(i, j) = res.to(j, i) = to(i, j);
+        return res;
+    }
+//--------------------------------=| Access end |=------------------------------------------------------
+}; // class PackedSymmetricMatrix
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+PackedSymmetricMatrix(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&) -> PackedSymmetricMatrix<T>;
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * A = L * L^T in packed storage: L takes place of lower triangle of A, so      |
+ * factorization needs no memory beyond half of dense matrix. Row i of L is     |
+ * made by dot products of contiguous packed rows (Crout order).                |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<std::floating_point T = double>
+class PackedCholesky
+{
+public:
+    using size_type   = std::size_t;
+    using value_type  = T;
+    using packed_type = PackedSymmetricMatrix<T>;
+
+private:
+    packed_type factor_;
+
+    // four independent sums, so additions dont wait for each other
+    static T dot(const T* lhs, const T* rhs, size_type n)
+    {
+        T sum[4] {};
+        size_type p = 0;
+        for (; p + 4 <= n; p += 4)
+            for (size_type q = 0; q < 4; q++)
+                sum[q] += lhs[p + q] * rhs[p + q];
+        for (; p < n; p++)
+            sum[0] += lhs[p] * rhs[p];
+        return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+
+    void factorize()
+    {
+        for (size_type i = 0; i < size(); i++)
+        {
+            T* row = factor_.row(i);
+            for (size_type j = 0; j < i; j++)
+            {
+                const T* pivot_row = factor_.row(j);
+                row[j] = (row[j] - dot(row, pivot_row, j)) / pivot_row[j];
+            }
+            T diag = row[i] - dot(row, row, i);
+            if (!(diag > T{0}))
+                throw std::invalid_argument{"try to make Cholesky decomposition of not positive definite matrix"};
+            row[i] = std::sqrt(diag);
+        }
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    explicit PackedCholesky(const packed_type& mat)
+    :factor_ {mat}
+    {
+        factorize();
+    }
+
+    // factorizes in place of mat, no copy
+    explicit PackedCholesky(packed_type&& mat)
+    :factor_ {std::move(mat)}
+    {
+        factorize();
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    size_type size() const {return factor_.size();}
+
+    // L is to(i, j) for i >= j, elements above diagonal read as symmetric are not part of L
+    const packed_type& factor() const {return factor_;}
+
+    value_type determinant() const
+    {
+        value_type res {1};
+        for (size_type i = 0; i < size(); i++)
+            res *= factor_.row(i)[i] * factor_.row(i)[i];
+        return res;
+    }
+
+    value_type log_determinant() const
+    {
+        value_type res {};
+        for (size_type i = 0; i < size(); i++)
+            res += std::log(factor_.row(i)[i]);
+        return 2 * res;
+    }
+
+    std::vector<value_type> solve(std::vector<value_type> rhs) const
+    {
+        if (rhs.size() != size())
+            throw std::invalid_argument{"in solve: rhs.size() != size of Cholesky decomposition"};
+
+        // L * Y = B
+        for (size_type i = 0; i < size(); i++)
+        {
+            const T* row = factor_.row(i);
+            rhs[i] = (rhs[i] - dot(row, rhs.data(), i)) / row[i];
+        }
+        // L^T * X = Y: x[i] is found, then row i of L is subtracted from the rest
+        for (size_type i = size(); i-- > 0;)
+        {
+            const T* row = factor_.row(i);
+            rhs[i] /= row[i];
+            T coef = -rhs[i];
+            for (size_type j = 0; j < i; j++)
+                rhs[j] += coef * row[j];
+        }
+        return rhs;
+    }
+
+    /*
+     * A^-1 = L^-T * L^-1 in packed storage: L^-1 is made in place of copy of L
+     * (row i needs only inverted rows above it), then row i of result is sum of
+     * rows k >= i of L^-1 with coefficients L^-1[k][i], it overwrites row i,
+     * which later rows dont need.
+     */
+    packed_type inverse() const
+    {
+        const size_type n = size();
+        packed_type res {factor_};
+
+        for (size_type i = 0; i < n; i++)
+        {
+            T* row = res.row(i);
+            const T inv_diag = T{1} / row[i];
+            for (size_type j = 0; j < i; j++)
+            {
+                T sum {};
+                for (size_type k = j; k < i; k++)
+                    sum += row[k] * res.row(k)[j];
+                row[j] = -inv_diag * sum;
+            }
+            row[i] = inv_diag;
+        }
+
+        std::vector<T> acc (n);
+        for (size_type i = 0; i < n; i++)
+        {
+            std::fill_n(acc.begin(), i + 1, T{});
+            for (size_type k = i; k < n; k++)
+            {
+                const T* inv_row = res.row(k);
+                const T coef = inv_row[i];
+                for (size_type j = 0; j <= i; j++)
+                    acc[j] += coef * inv_row[j];
+            }
+            std::copy_n(acc.begin(), i + 1, res.row(i));
+        }
+        return res;
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class PackedCholesky
+
+} // namespace Matrix
@@ -7,11 +7,424 @@
 #include <type_traits>
 #include <cstddef>
 #include <compare>
-
-#include "vector.hpp"
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "matrix_memory.hpp"
+#include "matrix_instrument.hpp"
+#include "matrix_transpose.hpp"
+
+// bytes inside matrix object for elements and row table of small matrices, 0 turns it off;
+// default holds 4 x 4 doubles with row table, every matrix object is this much bigger
+#ifndef MATRIX_INLINE_BYTES
+#define MATRIX_INLINE_BYTES 192
+#endif
 
 namespace Matrix
 {
+
+template<typename T>
+class MatrixContainer;
+
+namespace detail
+{
+template<typename T>
+class MatrixStorage;
+
+/*
+ * Owning array of elements placed in one allocation aligned to a cache line,
+ * so every row that starts on multiple of ld() is ready for vector loads.
+ * Memory is taken from resource, current resource of thread by default.
+ */
+template<typename T>
+class AlignedBuffer
+{
+public:
+    using size_type = std::size_t;
+    static constexpr size_type alignment = alignof(T) > 64 ? alignof(T) : 64;
+
+private:
+    T* data_ = nullptr;
+    size_type size_ = 0;
+    std::pmr::memory_resource* resource_ = current_resource();
+
+    T* allocate(size_type sz)
+    {
+        if (sz == 0)
+            return nullptr;
+        detail::note_allocated(sz * sizeof(T));
+        return static_cast<T*>(resource_->allocate(sz * sizeof(T), alignment));
+    }
+
+    void deallocate(T* ptr, size_type sz)
+    {
+        if (ptr)
+            resource_->deallocate(ptr, sz * sizeof(T), alignment);
+    }
+
+public:
+    AlignedBuffer() = default;
+
+    explicit AlignedBuffer(size_type sz, std::pmr::memory_resource* resource = current_resource())
+    :resource_ {resource}
+    {
+        data_ = allocate(sz);
+        size_ = sz;
+        try {std::uninitialized_value_construct_n(data_, size_);}
+        catch (...) {deallocate(data_, size_); throw;}
+    }
+
+    AlignedBuffer(size_type sz, const T& val, std::pmr::memory_resource* resource = current_resource())
+    :resource_ {resource}
+    {
+        data_ = allocate(sz);
+        size_ = sz;
+        try {std::uninitialized_fill_n(data_, size_, val);}
+        catch (...) {deallocate(data_, size_); throw;}
+    }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    // resource goes with memory
+    AlignedBuffer(AlignedBuffer&& rhs) noexcept
+    :data_ {std::exchange(rhs.data_, nullptr)}, size_ {std::exchange(rhs.size_, 0)}, resource_ {rhs.resource_}
+    {}
+
+    AlignedBuffer& operator=(AlignedBuffer&& rhs) noexcept
+    {
+        std::swap(data_, rhs.data_);
+        std::swap(size_, rhs.size_);
+        std::swap(resource_, rhs.resource_);
+        return *this;
+    }
+
+    ~AlignedBuffer()
+    {
+        std::destroy_n(data_, size_);
+        deallocate(data_, size_);
+    }
+
+    T*       data()       noexcept {return data_;}
+    const T* data() const noexcept {return data_;}
+    size_type size() const noexcept {return size_;}
+
+    T&       operator[](size_type ind)       noexcept {return data_[ind];}
+    const T& operator[](size_type ind) const noexcept {return data_[ind];}
+
+    std::pmr::memory_resource* resource() const noexcept {return resource_;}
+};
+
+} // namespace detail
+
+/*
+ * Non-owning handle of one matrix row. Assigning to it copies elements, so
+ * mat[i] = mat[j] behaves like it did when rows were separate vectors. Handle
+ * can't be copied (auto r = mat[i] doesn't compile, take auto& instead), and
+ * swap of two rows exchanges elements, so it never mixes handle and element
+ * semantics. MatrixContainer::swap_row() exchanges handles and is cheaper.
+ */
+template<typename T>
+class MatrixRow
+{
+public:
+    using size_type        = std::size_t;
+    using value_type       = T;
+    using reference        = T&;
+    using const_reference  = const T&;
+    using pointer          = T*;
+    using const_pointer    = const T*;
+
+    using iterator               = pointer;
+    using const_iterator         = const_pointer;
+    using reverse_iterator       = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+    pointer data_ = nullptr;
+    size_type size_ = 0;
+
+    template<typename> friend class MatrixContainer;
+    template<typename> friend class detail::MatrixStorage;
+
+public:
+    MatrixRow() = default;
+    MatrixRow(const MatrixRow&) = delete;
+
+    // handle of elements kept outside of matrix, e.g. in mapped file
+    MatrixRow(pointer data, size_type size) noexcept
+    :data_ {data}, size_ {size}
+    {}
+
+    MatrixRow& operator=(const MatrixRow& rhs)
+    {
+        if (size_ != rhs.size_)
+            throw std::invalid_argument{"try to assign rows with different sizes"};
+        if (data_ != rhs.data_)
+            std::copy(rhs.begin(), rhs.end(), begin());
+        return *this;
+    }
+
+    // found by ADL (using std::swap; swap(mat[i], mat[j])), std::swap itself needs copyable rows
+    friend void swap(MatrixRow& lhs, MatrixRow& rhs)
+    {
+        if (lhs.size_ != rhs.size_)
+            throw std::invalid_argument{"try to swap rows with different sizes"};
+        std::swap_ranges(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    size_type size() const noexcept {return size_;}
+
+    pointer       data()       noexcept {return data_;}
+    const_pointer data() const noexcept {return data_;}
+
+    reference       operator[](size_type ind)       noexcept {return data_[ind];}
+    const_reference operator[](size_type ind) const noexcept {return data_[ind];}
+
+    reference at(size_type ind)
+    {
+        if (ind >= size_)
+            throw std::out_of_range{"try to get element of row with index out of range"};
+        return data_[ind];
+    }
+
+    const_reference at(size_type ind) const
+    {
+        if (ind >= size_)
+            throw std::out_of_range{"try to get element of row with index out of range"};
+        return data_[ind];
+    }
+
+    iterator begin() noexcept {return data_;}
+    iterator end()   noexcept {return data_ + size_;}
+
+    const_iterator begin() const noexcept {return data_;}
+    const_iterator end()   const noexcept {return data_ + size_;}
+
+    const_iterator cbegin() const noexcept {return data_;}
+    const_iterator cend()   const noexcept {return data_ + size_;}
+
+    reverse_iterator rbegin() noexcept {return reverse_iterator{end()};}
+    reverse_iterator rend()   noexcept {return reverse_iterator{begin()};}
+
+    const_reverse_iterator rbegin() const noexcept {return const_reverse_iterator{end()};}
+    const_reverse_iterator rend()   const noexcept {return const_reverse_iterator{begin()};}
+
+    const_reverse_iterator crbegin() const noexcept {return const_reverse_iterator{end()};}
+    const_reverse_iterator crend()   const noexcept {return const_reverse_iterator{begin()};}
+};
+
+namespace detail
+{
+// tag of ctors that leave elements of trivial type unwritten, for kernels that write all of them
+// (and so touch memory first from threads that will use it)
+struct uninitialized_t {explicit uninitialized_t() = default;};
+inline constexpr uninitialized_t uninitialized {};
+
+/*
+ * Elements and row table of matrix in one block: elements from the start,
+ * table after them. Block of small matrix is placed inside object (no
+ * allocation at all), bigger one is taken from resource. Moving of inline
+ * block moves elements and points row handles to new place.
+ * grow_rows() moves table to its own allocation when matrix needs more rows
+ * over the same elements (in-place transposition of wide matrix).
+ */
+template<typename T>
+class MatrixStorage
+{
+public:
+    using size_type = std::size_t;
+    using Row = MatrixRow<T>;
+
+    static constexpr size_type alignment    = AlignedBuffer<T>::alignment;
+    static constexpr size_type inline_bytes = MATRIX_INLINE_BYTES;
+
+private:
+    T* data_ = nullptr;
+    Row* rows_ = nullptr;
+    size_type size_ = 0, height_ = 0;
+    size_type block_height_ = 0;    // handles in block, table is allocated apart when height_ is bigger
+    std::pmr::memory_resource* resource_ = current_resource();
+    alignas(alignment) std::byte inline_[inline_bytes ? inline_bytes : 1];
+
+    static constexpr size_type rows_offset(size_type sz)
+    {
+        return (sz * sizeof(T) + alignof(Row) - 1) / alignof(Row) * alignof(Row);
+    }
+
+    static constexpr size_type block_bytes(size_type sz, size_type h) {return rows_offset(sz) + h * sizeof(Row);}
+
+    void allocate(size_type sz, size_type h)
+    {
+        auto bytes = block_bytes(sz, h);
+        if (bytes == 0)
+            return;
+
+        // only blocks from resource are counted, inline one costs nothing
+        if (bytes > inline_bytes)
+            detail::note_allocated(bytes);
+        auto block = bytes <= inline_bytes ? inline_ : static_cast<std::byte*>(resource_->allocate(bytes, alignment));
+        data_ = reinterpret_cast<T*>(block);
+        rows_ = reinterpret_cast<Row*>(block + rows_offset(sz));
+        size_ = sz;
+        height_ = block_height_ = h;
+    }
+
+    void deallocate_rows() noexcept
+    {
+        if (height_ != block_height_)
+            resource_->deallocate(rows_, height_ * sizeof(Row), alignof(Row));
+    }
+
+    // elements must be destroyed before
+    void deallocate() noexcept
+    {
+        deallocate_rows();
+        if (data_ && !is_inline())
+            resource_->deallocate(data_, block_bytes(size_, block_height_), alignment);
+        data_ = nullptr;
+        rows_ = nullptr;
+        size_ = height_ = block_height_ = 0;
+    }
+
+    void clear() noexcept
+    {
+        std::destroy_n(data_, size_);
+        deallocate();
+    }
+
+    void steal(MatrixStorage& rhs)
+    {
+        if (!rhs.is_inline())
+        {
+            data_   = std::exchange(rhs.data_, nullptr);
+            rows_   = std::exchange(rhs.rows_, nullptr);
+            size_   = std::exchange(rhs.size_, 0);
+            height_ = std::exchange(rhs.height_, 0);
+            block_height_ = std::exchange(rhs.block_height_, 0);
+            return;
+        }
+
+        // the same block fits inline again, so nothing is allocated here
+        allocate(rhs.size_, rhs.block_height_);
+        std::uninitialized_move_n(rhs.data_, size_, data_);
+        if (rhs.height_ != rhs.block_height_)
+        {
+            // table made by grow_rows() is taken as it is, only its handles are moved to new elements
+            rows_ = std::exchange(rhs.rows_, nullptr);
+            height_ = std::exchange(rhs.height_, rhs.block_height_);
+        }
+        else
+            for (size_type i = 0; i < height_; i++)
+                std::construct_at(rows_ + i, rhs.rows_[i].data_, rhs.rows_[i].size_);
+
+        // handles past height of transposed matrix are empty
+        for (size_type i = 0; i < height_; i++)
+            if (rows_[i].data_)
+                rows_[i].data_ = data_ + (rows_[i].data_ - rhs.data_);
+        rhs.clear();
+    }
+
+public:
+    MatrixStorage() = default;
+
+    MatrixStorage(size_type sz, size_type h)
+    {
+        allocate(sz, h);
+        try {std::uninitialized_value_construct_n(data_, size_);}
+        catch (...) {deallocate(); throw;}
+        std::uninitialized_value_construct_n(rows_, height_);
+    }
+
+    MatrixStorage(size_type sz, size_type h, const T& val)
+    {
+        allocate(sz, h);
+        try {std::uninitialized_fill_n(data_, size_, val);}
+        catch (...) {deallocate(); throw;}
+        std::uninitialized_value_construct_n(rows_, height_);
+    }
+
+    MatrixStorage(uninitialized_t, size_type sz, size_type h) requires std::is_trivially_default_constructible_v<T>
+    {
+        allocate(sz, h);
+        std::uninitialized_value_construct_n(rows_, height_);
+    }
+
+    MatrixStorage(const MatrixStorage&) = delete;
+    MatrixStorage& operator=(const MatrixStorage&) = delete;
+
+    // resource goes with memory
+    MatrixStorage(MatrixStorage&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>)
+    :resource_ {rhs.resource_}
+    {
+        steal(rhs);
+    }
+
+    MatrixStorage& operator=(MatrixStorage&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this == &rhs)
+            return *this;
+        clear();
+        resource_ = rhs.resource_;
+        steal(rhs);
+        return *this;
+    }
+
+    ~MatrixStorage() {clear();}
+
+    T*       data()       noexcept {return data_;}
+    const T* data() const noexcept {return data_;}
+
+    Row*       rows()       noexcept {return rows_;}
+    const Row* rows() const noexcept {return rows_;}
+
+    // elements and row handles block has room for
+    size_type size()   const noexcept {return size_;}
+    size_type height() const noexcept {return height_;}
+
+    // room for h row handles, elements stay in place; old handles are kept, new ones are empty
+    void grow_rows(size_type h)
+    {
+        if (h <= height_)
+            return;
+
+        auto bytes = h * sizeof(Row);
+        detail::note_allocated(bytes);
+        auto table = static_cast<Row*>(resource_->allocate(bytes, alignof(Row)));
+        for (size_type i = 0; i < height_; i++)
+            std::construct_at(table + i, rows_[i].data_, rows_[i].size_);
+        std::uninitialized_value_construct_n(table + height_, h - height_);
+
+        deallocate_rows();
+        rows_ = table;
+        height_ = h;
+    }
+
+    bool is_inline() const noexcept {return static_cast<const void*>(data_) == inline_;}
+
+    std::pmr::memory_resource* resource() const noexcept {return resource_;}
+};
+
+} // namespace detail
+
+/*
+ * Elements live in one aligned buffer of height() * ld() elements, row after
+ * row. Rows are reached through a table of MatrixRow handles, this table is
+ * the row permutation: swap_row exchanges two handles in O(1) and leaves
+ * elements in place. is_contiguous() tells if row i still starts at
+ * data() + i * ld(), make_contiguous() restores this order.
+ * Elements and row table are taken from current_resource() of thread which
+ * creates matrix (see matrix_memory.hpp), small matrices keep them inside
+ * object without allocation (up to MATRIX_INLINE_BYTES).
+ * Move of allocated matrix takes its block, so row references and pointers
+ * into moved matrix now refer to target. Move of inline matrix (is_inline())
+ * copies elements into target and invalidates them. Views are invalidated by
+ * any move (see matrix_view.hpp).
+ */
 template<typename T = int>
 class MatrixContainer
 {
@@ -23,53 +436,84 @@ public:
     using pointer          = T*;
     using const_pointer    = const T*;
 
-    using Row = typename Container::Vector<value_type>;
+    using Row = MatrixRow<value_type>;
 
     using row_iterator       = typename Row::iterator;
     using row_const_iterator = typename Row::const_iterator;
-    using iterator       = typename Container::Vector<Row>::iterator;
-    using const_iterator = typename Container::Vector<Row>::const_iterator;
-    using reverse_iterator       = typename Container::Vector<Row>::reverse_iterator;
-    using const_reverse_iterator = typename Container::Vector<Row>::const_reverse_iterator;
+    using iterator       = Row*;
+    using const_iterator = const Row*;
+    using reverse_iterator       = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_type alignment = detail::MatrixStorage<value_type>::alignment;
 
 private:
-    size_type height_ = 0, width_ = 0;
-    Container::Vector<Container::Vector<value_type>> data_ = {};
+    size_type height_ = 0, width_ = 0, ld_ = 0;
+    detail::MatrixStorage<value_type> storage_ = {};
+
+    // rows shorter than a cache line are not padded to keep small matrices small
+    static size_type calc_ld(size_type w)
+    {
+        constexpr size_type align_elems = alignment % sizeof(value_type) == 0 ? alignment / sizeof(value_type) : 1;
+        if (w < align_elems)
+            return w;
+        return (w + align_elems - 1) / align_elems * align_elems;
+    }
+
+    void init_rows()
+    {
+        for (size_type i = 0; i < height_; i++)
+        {
+            storage_.rows()[i].data_ = storage_.data() + i * ld_;
+            storage_.rows()[i].size_ = width_;
+        }
+    }
 
 public:
 //--------------------------------=| Classic ctors start |=---------------------------------------------
     MatrixContainer() = default;
-    
+
     MatrixContainer(size_type h, size_type w, const_reference val)
-    :height_ {h}, width_ {w}, data_ (height_, Row(width_, val))
-    {}
+    :height_ {h}, width_ {w}, ld_ {calc_ld(w)}, storage_ (height_ * ld_, height_, val)
+    {
+        init_rows();
+    }
 
     MatrixContainer(size_type h, size_type w)
-    :height_ {h}, width_ {w}, data_ (height_, Row(width_))
-    {}
+    :height_ {h}, width_ {w}, ld_ {calc_ld(w)}, storage_ (height_ * ld_, height_)
+    {
+        init_rows();
+    }
+
+    // BE CAREFUL: elements and padding of rows up to ld() must be written before they are read
+    MatrixContainer(detail::uninitialized_t tag, size_type h, size_type w) requires std::is_trivially_default_constructible_v<T>
+    :height_ {h}, width_ {w}, ld_ {calc_ld(w)}, storage_ (tag, height_ * ld_, height_)
+    {
+        init_rows();
+    }
 
     template<std::input_iterator InpIt>
     MatrixContainer(size_type h, size_type w, InpIt begin, InpIt end)
-    :height_ {h}, width_ {w}, data_ (height_, Row(width_))
-    {   
-        for (auto& row: data_)
+    :MatrixContainer(h, w)
+    {
+        for (auto& row: *this)
             for (auto& elem: row)
                 if (begin != end)
                     elem = *begin++;
                 else
-                    elem = value_type{};        
+                    break;
     }
 
     explicit MatrixContainer(const_reference val)
-    :height_ {1}, width_ {1}, data_ (1, Row{val})
+    :MatrixContainer(1, 1, val)
     {}
 
     MatrixContainer(std::initializer_list<value_type> onedim_list)
-    :height_ {onedim_list.size()}, width_ {1}, data_ (height_, Row(1))
+    :MatrixContainer(onedim_list.size(), 1)
     {
         size_type i = 0;
         for (const auto& elem: onedim_list)
-            data_[i++][0] = elem;
+            to(i++, 0) = elem;
     }
 
 private:
@@ -85,34 +529,96 @@ private:
 
 public:
     MatrixContainer(std::initializer_list<std::initializer_list<value_type>> twodim_list)
-    :height_ {twodim_list.size()}, width_ {calc_width(twodim_list)},
-     data_ (height_, Container::Vector<value_type>(width_))
+    :MatrixContainer(twodim_list.size(), calc_width(twodim_list))
     {
         size_type i = 0;
         for (auto& row: twodim_list)
-            std::copy(row.begin(), row.end(), data_[i++].begin());
+            std::copy(row.begin(), row.end(), storage_.rows()[i++].begin());
     }
 //--------------------------------=| Classic ctors end |=-----------------------------------------------
 
+//--------------------------------=| Big five start |=--------------------------------------------------
+    // copy gathers rows in their logical order, so a copy is always contiguous
+    MatrixContainer(const MatrixContainer& rhs)
+    :MatrixContainer(rhs.height_, rhs.width_)
+    {
+        detail::note_copied(height_ * width_ * sizeof(value_type));
+        for (size_type i = 0; i < height_; i++)
+            std::copy(rhs[i].begin(), rhs[i].end(), (*this)[i].begin());
+    }
+
+    // elements of small inline matrix are moved one by one
+    MatrixContainer(MatrixContainer&& rhs) noexcept(std::is_nothrow_move_constructible_v<value_type>)
+    :height_ {std::exchange(rhs.height_, 0)}, width_ {std::exchange(rhs.width_, 0)},
+     ld_ {std::exchange(rhs.ld_, 0)}, storage_ {std::move(rhs.storage_)}
+    {}
+
+    // copy is made in resource of *this
+    MatrixContainer& operator=(const MatrixContainer& rhs)
+    {
+        if (this == &rhs)
+            return *this;
+        ResourceGuard guard {*resource()};
+        MatrixContainer cpy (rhs);
+        return *this = std::move(cpy);
+    }
+
+    // buffer is taken only if resources are equal, else elements are copied
+    MatrixContainer& operator=(MatrixContainer&& rhs)
+    {
+        if (!resource()->is_equal(*rhs.resource()))
+            return *this = static_cast<const MatrixContainer&>(rhs);
+        if (this == &rhs)
+            return *this;
+        height_  = std::exchange(rhs.height_, 0);
+        width_   = std::exchange(rhs.width_, 0);
+        ld_      = std::exchange(rhs.ld_, 0);
+        storage_ = std::move(rhs.storage_);
+        return *this;
+    }
+
+    ~MatrixContainer() = default;
+//--------------------------------=| Big five end |=----------------------------------------------------
+
 //--------------------------------=| Acces operators start |=-------------------------------------------
     size_type height() const {return height_;}
     size_type width()  const {return width_;}
+    size_type ld()     const {return ld_;}
+
+    std::pmr::memory_resource* resource() const noexcept {return storage_.resource();}
+
+    pointer       data()       noexcept {return storage_.data();}
+    const_pointer data() const noexcept {return storage_.data();}
+
+    // elements are inside object: move copies them, so it invalidates views, rows and pointers
+    bool is_inline() const noexcept {return storage_.is_inline();}
 
     reference to(size_type i, size_type j) noexcept
     {
-        return data_[i][j];
+        return storage_.rows()[i].data_[j];
     }
 
     const_reference to(size_type i, size_type j) const noexcept
     {
-        return data_[i][j];
+        return storage_.rows()[i].data_[j];
     }
 
-    Row&       at(size_type ind)       {return data_.at(ind);}
-    const Row& at(size_type ind) const {return data_.at(ind);}
+    Row& at(size_type ind)
+    {
+        if (ind >= height_)
+            throw std::out_of_range{"try to get row with index out of range"};
+        return storage_.rows()[ind];
+    }
 
-    Row&       operator[](size_type ind)       {return data_[ind];}
-    const Row& operator[](size_type ind) const {return data_[ind];} 
+    const Row& at(size_type ind) const
+    {
+        if (ind >= height_)
+            throw std::out_of_range{"try to get row with index out of range"};
+        return storage_.rows()[ind];
+    }
+
+    Row&       operator[](size_type ind)       {return storage_.rows()[ind];}
+    const Row& operator[](size_type ind) const {return storage_.rows()[ind];}
 //--------------------------------=| Acces operators end |=---------------------------------------------
 
 //--------------------------------=| Types start |=-----------------------------------------------------
@@ -121,22 +627,30 @@ public:
     bool is_column() const {return width() == 1;}
     bool is_scalar() const {return height() == 1 && width() == 1;}
     bool is_square() const {return height() == width();}
+
+    bool is_contiguous() const
+    {
+        for (size_type i = 0; i < height_; i++)
+            if (storage_.rows()[i].data_ != storage_.data() + i * ld_)
+                return false;
+        return true;
+    }
 //--------------------------------=| Types end |=-------------------------------------------------------
 
 //--------------------------------=| Swap rows and columns start |=-------------------------------------
-/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++                                                                         
+/*+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
  *----------------------------------------------------------------------------*
  *      ________________________________________________________________      *
  *---==| BE CAREFUL, THIS OPERATIONS INVALIDATE ITERATORS AND REFERENCES|==---*
  *     ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~      *
  *----------------------------------------------------------------------------*
- */                              
+ */
     void swap_row(size_type ind1, size_type ind2)
     {
         if (ind1 >= height() || ind2 >= height())
             throw std::out_of_range{"try to swap rows with indexis out of range"};
 
-        std::swap(data_[ind1], data_[ind2]);
+        std::swap(storage_.rows()[ind1].data_, storage_.rows()[ind2].data_);
     }
 
     void swap_col(size_type ind1, size_type ind2)
@@ -144,30 +658,110 @@ public:
         if (ind1 >= width() || ind2 >= width())
             throw std::out_of_range{"try to swap columns with indexis out of range"};
 
-        for (auto& row: data_)
-            std::swap(row[ind1], row[ind2]);
+        for (size_type i = 0; i < height_; i++)
+            std::swap(storage_.rows()[i].data_[ind1], storage_.rows()[i].data_[ind2]);
+    }
+
+    // moves rows in memory by cycles of the permutation, so row i starts at data() + i * ld() again
+    void make_contiguous()
+    {
+        if (width_ == 0)
+            return;
+
+        std::vector<size_type> slot_of (height_), row_in (height_);
+        for (size_type i = 0; i < height_; i++)
+        {
+            slot_of[i] = static_cast<size_type>(storage_.rows()[i].data_ - storage_.data()) / ld_;
+            row_in[slot_of[i]] = i;
+        }
+
+        for (size_type i = 0; i < height_; i++)
+        {
+            if (slot_of[i] == i)
+                continue;
+            auto other = row_in[i];
+            auto slot  = slot_of[i];
+            std::swap_ranges(storage_.rows()[i].data_, storage_.rows()[i].data_ + width_, storage_.data() + i * ld_);
+
+            storage_.rows()[other].data_ = storage_.rows()[i].data_;
+            storage_.rows()[i].data_     = storage_.data() + i * ld_;
+            slot_of[other] = slot;
+            row_in[slot]   = other;
+            slot_of[i] = i;
+            row_in[i]  = i;
+        }
+    }
+
+    /*
+     * Square matrix swaps elements through row handles. Rectangular one is made contiguous
+     * and its elements follow cycles of transposition (see transpose_dense_inplace), so
+     * elements are never reallocated. Wide matrix needs more row handles than it has, its
+     * row table is grown apart from elements. Rows of result are padded like in new matrix
+     * when buffer has room for it, else they are left dense (ld() == width()).
+     */
+    void transpose_inplace()
+    {
+        detail::OperationScope scope {Operation::transpos, std::max(height_, width_)};
+        if (is_square())
+        {
+            detail::transpose_square_inplace<value_type>(height_, [this](size_type i) {return storage_.rows()[i].data_;});
+            return;
+        }
+
+        if (width_ == 0 || height_ == 0)
+        {
+            ResourceGuard guard {*resource()};
+            *this = MatrixContainer(width_, height_);
+            return;
+        }
+
+        auto new_ld = calc_ld(height_);
+        if (width_ * new_ld > storage_.size())
+            new_ld = height_;
+        storage_.grow_rows(width_);
+
+        make_contiguous();
+        auto data = storage_.data();
+        for (size_type i = 1; i < height_; i++)
+            std::move(data + i * ld_, data + i * ld_ + width_, data + i * width_);
+        detail::transpose_dense_inplace(data, height_, width_);
+        for (size_type j = width_; j-- > 1;)
+            std::move_backward(data + j * height_, data + (j + 1) * height_, data + j * new_ld + height_);
+
+        std::swap(height_, width_);
+        ld_ = new_ld;
+        init_rows();
+        for (size_type i = 0; i < height_; i++)
+            std::fill(data + i * ld_ + width_, data + (i + 1) * ld_, value_type{});
+
+        // handles beyond height() pointed into old rows
+        for (size_type i = height_; i < storage_.height(); i++)
+        {
+            storage_.rows()[i].data_ = nullptr;
+            storage_.rows()[i].size_ = 0;
+        }
     }
 //--------------------------------=| Swap rows and columns end |=---------------------------------------
 
 //--------------------------------=| Iterators start |=-------------------------------------------------
 
-    iterator begin() {return data_.begin();}
-    iterator end()   {return data_.end();}
+    iterator begin() {return storage_.rows();}
+    iterator end()   {return storage_.rows() + height_;}
 
-    const_iterator begin() const {return data_.cbegin();}
-    const_iterator end()   const {return data_.cend();}
+    const_iterator begin() const {return storage_.rows();}
+    const_iterator end()   const {return storage_.rows() + height_;}
 
-    const_iterator cbegin() const {return data_.cbegin();}
-    const_iterator cend()   const {return data_.cend();}
+    const_iterator cbegin() const {return storage_.rows();}
+    const_iterator cend()   const {return storage_.rows() + height_;}
 
-    reverse_iterator rbegin() {return data_.rbegin();}
-    reverse_iterator rend()   {return data_.rend();}
+    reverse_iterator rbegin() {return reverse_iterator{end()};}
+    reverse_iterator rend()   {return reverse_iterator{begin()};}
 
-    const_reverse_iterator rbegin() const {return data_.crbegin();}
-    const_reverse_iterator rend()   const {return data_.crend();}
+    const_reverse_iterator rbegin() const {return const_reverse_iterator{end()};}
+    const_reverse_iterator rend()   const {return const_reverse_iterator{begin()};}
 
-    const_reverse_iterator crbegin() const {return data_.crbegin();}
-    const_reverse_iterator crend()   const {return data_.crend();}
+    const_reverse_iterator crbegin() const {return const_reverse_iterator{end()};}
+    const_reverse_iterator crend()   const {return const_reverse_iterator{begin()};}
 //--------------------------------=| Iterators end |=---------------------------------------------------
 };
 
@@ -192,4 +786,4 @@ std::ostream& operator<<(std::ostream& os, const MatrixContainer<value_type>& ma
     return dump(os, mat);
 }
 
-} // Matrix
\ No newline at end of file
+} // Matrix
@@ -0,0 +1,308 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "matrix_simd.hpp"
+#include "matrix_instrument.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Lazy element-wise expressions. A + B - C * 2 builds tree of small nodes     |
+ * and nothing is computed until tree is assigned into matrix. Then every row  |
+ * of result is made by one loop over row pointers of all leaves: one pass     |
+ * over memory and no temporary matrices. Nodes apply the same apply_op as     |
+ * element-wise kernels, so loop works both with vectors and with scalars.     |
+ *                                                                              |
+ * Leaves keep lvalue matrices by reference and take rvalue ones by value, so  |
+ * expression with temporary matrix inside can be kept in variable. Result of  |
+ * rvalue expression is written over buffer of such temporary (donate()), so   |
+ * std::move(A) + B + C allocates nothing.                                     |
+ *                                                                              |
+ * Expression kept in variable (auto e = A + B) must not outlive lvalue        |
+ * matrices in it: e dangles when A or B is destroyed, e.g. when e is returned |
+ * from function where A is local. Assign e to matrix to keep the result, or   |
+ * pass std::move(A) to move A into e.                                         |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+struct ExpressionTag {};
+
+template<typename E>
+concept is_matrix_expression = std::is_base_of_v<ExpressionTag, std::remove_cvref_t<E>>;
+
+// memory under matrix or under matrix of view, used to find aliasing
+template<typename X>
+std::pair<const void*, const void*> storage_range(const X& x)
+{
+    if constexpr (requires {x.owner();})
+    {
+        if (x.owner())
+            return storage_range(*x.owner());
+        return {nullptr, nullptr};
+    }
+    else
+        return {x.data(), x.data() + x.height() * x.ld()};
+}
+
+template<typename X, typename Y>
+bool storage_overlaps(const X& x, const Y& y)
+{
+    auto [x_begin, x_end] = storage_range(x);
+    auto [y_begin, y_end] = storage_range(y);
+    return std::less<>{}(x_begin, y_end) && std::less<>{}(y_begin, x_end);
+}
+
+template<typename M, bool Owns>
+class ExprLeaf : public ExpressionTag
+{
+public:
+    using matrix_type = M;
+    using value_type  = typename M::value_type;
+    using size_type   = typename M::size_type;
+
+private:
+    std::conditional_t<Owns, M, const M&> mat_;
+    const M* donated_to_ = nullptr;
+
+    const M& matrix() const {return donated_to_ ? *donated_to_ : mat_;}
+
+public:
+    explicit ExprLeaf(const M& mat) requires (!Owns) :mat_ {mat} {}
+    explicit ExprLeaf(M mat) requires Owns :mat_ {std::move(mat)} {}
+
+    size_type height() const {return matrix().height();}
+    size_type width()  const {return matrix().width();}
+
+    // dst shares memory with this leaf, but is not the same matrix: element (i, j) of leaf may sit in other place of dst
+    template<typename D>
+    bool aliases(const D& dst) const
+    {
+        if constexpr (std::is_same_v<D, M>)
+            if (&dst == &matrix())
+                return false;
+        return storage_overlaps(matrix(), dst);
+    }
+
+    // rvalue matrix gives its buffer to result of expression, then leaf reads elements from dst
+    bool donate(M& dst)
+    {
+        if constexpr (Owns)
+            if (!donated_to_)
+            {
+                dst = std::move(mat_);
+                donated_to_ = &dst;
+                return true;
+            }
+        return false;
+    }
+
+    struct RowEval
+    {
+        const value_type* row;
+
+        template<typename V>
+        [[gnu::always_inline]] void load(V& out, size_type j) const
+        {
+            if constexpr (std::is_same_v<V, value_type>)
+                out = row[j];
+            else
+                std::memcpy(&out, row + j, sizeof(V));
+        }
+    };
+
+    RowEval row_eval(size_type i) const {return {matrix()[i].data()};}
+
+    matrix_type eval() const {return matrix();}
+};
+
+// Op is add or sub
+template<ElementwiseOp Op, typename L, typename R>
+class ExprBinary : public ExpressionTag
+{
+public:
+    using matrix_type = typename L::matrix_type;
+    using value_type  = typename L::value_type;
+    using size_type   = typename L::size_type;
+
+private:
+    L lhs_;
+    R rhs_;
+
+public:
+    ExprBinary(L lhs, R rhs)
+    :lhs_ {std::move(lhs)}, rhs_ {std::move(rhs)}
+    {
+        if (lhs_.height() != rhs_.height() || lhs_.width() != rhs_.width())
+            throw std::invalid_argument{Op == ElementwiseOp::add ? "Try to add matrixes with different height() * width()"
+                                                                 : "Try to sub matrixes with different height() * width()"};
+    }
+
+    size_type height() const {return lhs_.height();}
+    size_type width()  const {return lhs_.width();}
+
+    template<typename D>
+    bool aliases(const D& dst) const {return lhs_.aliases(dst) || rhs_.aliases(dst);}
+
+    bool donate(matrix_type& dst) {return lhs_.donate(dst) || rhs_.donate(dst);}
+
+    struct RowEval
+    {
+        typename L::RowEval lhs;
+        typename R::RowEval rhs;
+
+        template<typename V>
+        [[gnu::always_inline]] void load(V& out, size_type j) const
+        {
+            V rhs_val;
+            lhs.load(out, j);
+            rhs.load(rhs_val, j);
+            apply_op<Op>(out, rhs_val, value_type{});
+        }
+    };
+
+    RowEval row_eval(size_type i) const {return {lhs_.row_eval(i), rhs_.row_eval(i)};}
+
+    matrix_type eval() const {return matrix_type(*this);}
+};
+
+// Op is neg, mul or div, alpha is scalar for mul and div
+template<ElementwiseOp Op, typename E>
+class ExprUnary : public ExpressionTag
+{
+public:
+    using matrix_type = typename E::matrix_type;
+    using value_type  = typename E::value_type;
+    using size_type   = typename E::size_type;
+
+private:
+    E arg_;
+    value_type alpha_;
+
+public:
+    explicit ExprUnary(E arg, value_type alpha = value_type{})
+    :arg_ {std::move(arg)}, alpha_ {std::move(alpha)}
+    {}
+
+    size_type height() const {return arg_.height();}
+    size_type width()  const {return arg_.width();}
+
+    template<typename D>
+    bool aliases(const D& dst) const {return arg_.aliases(dst);}
+
+    bool donate(matrix_type& dst) {return arg_.donate(dst);}
+
+    struct RowEval
+    {
+        typename E::RowEval arg;
+        const value_type& alpha;
+
+        template<typename V>
+        [[gnu::always_inline]] void load(V& out, size_type j) const
+        {
+            if constexpr (Op == ElementwiseOp::neg)
+            {
+                V arg_val;
+                arg.load(arg_val, j);
+                apply_op<Op>(out, arg_val, alpha);
+            }
+            else
+            {
+                arg.load(out, j);
+                apply_op<Op>(out, out, alpha);
+            }
+        }
+    };
+
+    RowEval row_eval(size_type i) const {return {arg_.row_eval(i), alpha_};}
+
+    matrix_type eval() const {return matrix_type(*this);}
+};
+
+template<std::size_t Bytes, typename T, typename RowEval>
+[[gnu::always_inline]] inline void expression_row_loop(T* dst, const RowEval& row, std::size_t n)
+{
+    typedef T vec __attribute__((vector_size(Bytes)));
+    constexpr std::size_t vl = Bytes / sizeof(T);
+
+    std::size_t j = 0;
+    for (; j + vl <= n; j += vl)
+    {
+        vec val;
+        row.load(val, j);
+        std::memcpy(dst + j, &val, Bytes);
+    }
+    // through temporary: dst may be operand of expression too (donate())
+    for (; j < n; j++)
+    {
+        T val;
+        row.load(val, j);
+        dst[j] = val;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template<typename T, typename RowEval>
+__attribute__((target("avx512f"))) void expression_row_avx512(T* dst, const RowEval& row, std::size_t n)
+{
+    expression_row_loop<64>(dst, row, n);
+}
+
+template<typename T, typename RowEval>
+__attribute__((target("avx2"))) void expression_row_avx2(T* dst, const RowEval& row, std::size_t n)
+{
+    expression_row_loop<32>(dst, row, n);
+}
+#endif
+
+// dst[j] = row[j] for j < n, widest vectors supported by CPU are used like in elementwise()
+template<typename T, typename RowEval>
+void expression_row(T* dst, const RowEval& row, std::size_t n)
+{
+    if constexpr (is_simd_available<T>)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        switch (simd_level())
+        {
+            case SimdLevel::avx512: return expression_row_avx512(dst, row, n);
+            case SimdLevel::avx2:   return expression_row_avx2(dst, row, n);
+            default: break;
+        }
+#endif
+        expression_row_loop<16>(dst, row, n);
+    }
+    else
+        for (std::size_t j = 0; j < n; j++)
+        {
+            T val;
+            row.load(val, j);
+            dst[j] = std::move(val);
+        }
+}
+
+// dst must have size of expr; result goes to temporary first if expr reads memory of dst in other places
+template<typename M, typename E>
+void assign_expression(M& dst, const E& expr)
+{
+    if (expr.aliases(dst))
+    {
+        M tmp (expr.height(), expr.width());
+        assign_expression(tmp, expr);
+        dst = std::move(tmp);
+        return;
+    }
+
+    OperationScope scope {Operation::expression, std::max(dst.height(), dst.width())};
+    for (typename M::size_type i = 0; i < dst.height(); i++)
+        expression_row(dst[i].data(), expr.row_eval(i), dst.width());
+}
+
+} // namespace detail
+} // namespace Matrix
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <concepts>
+#include <stdexcept>
+
+#include "matrix_container.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Fraction-free solve of A * X = B for types without arithmetical division,   |
+ * f.e. integers. Bareiss elimination goes over A and B together, every        |
+ * division in it is exact. With d - last pivot (d = +-det(A)) N = d * X is    |
+ * matrix of elements of T by Cramer's rule and back substitution              |
+ *     N[i] = (d * B'[i] - sum(U[i][l] * N[l], l > i)) / U[i][i]               |
+ * divides exactly too. Result is X = N / d without any rounding.              |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T, typename Abs, typename Cmp>
+T bareiss_solve(MatrixContainer<T>& a, MatrixContainer<T>& b, Abs abs, Cmp cmp)
+{
+    using size_type = std::size_t;
+
+    if (!a.is_square())
+        throw std::invalid_argument{"try to solve system with no square matrix"};
+    if (a.height() != b.height())
+        throw std::invalid_argument{"in solve: rhs.height() != lhs.height()"};
+
+    const size_type n = a.height();
+    const size_type m = b.width();
+    const T null_obj {};
+    if (n == 0)
+        return T{1};
+
+    T prev {1};
+    for (size_type k = 0; k < n; k++)
+    {
+        size_type piv = k;
+        for (size_type i = k + 1; i < n; i++)
+            if ((cmp(a[piv][k], null_obj) && !cmp(a[i][k], null_obj)) || abs(a[i][k]) > abs(a[piv][k]))
+                piv = i;
+        if (cmp(a[piv][k], null_obj))
+            throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+        if (piv != k)
+        {
+            a.swap_row(k, piv);
+            b.swap_row(k, piv);
+        }
+
+        const auto& pivot_row = a[k];
+        const auto& pivot_rhs = b[k];
+        const T pivot = pivot_row[k];
+        for (size_type i = k + 1; i < n; i++)
+        {
+            auto& row = a[i];
+            auto& rhs = b[i];
+            const T coef = row[k];
+            for (size_type j = k + 1; j < n; j++)
+                row[j] = (row[j] * pivot - coef * pivot_row[j]) / prev;
+            for (size_type j = 0; j < m; j++)
+                rhs[j] = (rhs[j] * pivot - coef * pivot_rhs[j]) / prev;
+            row[k] = null_obj;
+        }
+        prev = pivot;
+    }
+
+    const T denom = a[n - 1][n - 1];
+    for (size_type i = n; i-- > 0;)
+        for (size_type j = 0; j < m; j++)
+        {
+            T num = denom * b[i][j];
+            for (size_type l = i + 1; l < n; l++)
+                num -= a[i][l] * b[l][j];
+            b[i][j] = num / a[i][i];
+        }
+
+    if constexpr (std::totally_ordered<T>)
+        if (denom < null_obj)
+        {
+            for (auto& row: b)
+                for (auto& elem: row)
+                    elem = -elem;
+            return -denom;
+        }
+    return denom;
+}
+
+} // namespace detail
+} // namespace Matrix
@@ -0,0 +1,196 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+
+#include "matrix_container.hpp"
+#include "matrix_simd.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Blocked matrix product C += A * B in the spirit of GotoBLAS / BLIS:          |
+ *   jc loop - NC columns of B, packed panel of B lives in L3                    |
+ *   pc loop - KC deep slice of A and B                                          |
+ *   ic loop - MC rows of A, packed block of A lives in L2                       |
+ *   jr, ir  - MR x NR tile of C accumulated in registers by micro kernel        |
+ * A, B and C are given by functions returning pointer to row, so permuted     |
+ * rows of MatrixContainer are used without making them contiguous first.       |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T>
+concept is_gemm_available = is_simd_available<T>;
+
+template<typename T>
+struct GemmBlocking
+{
+    using size_type = std::size_t;
+
+    // 6 x 2 vectors: 12 accumulators of 16 vector registers, compilers keep 256-bit width on AVX-512 too
+#if defined(__AVX__)
+    static constexpr size_type vector_bytes = 32;
+#else
+    static constexpr size_type vector_bytes = 16;
+#endif
+    static constexpr size_type mr = 6;
+    static constexpr size_type nv = 2;
+    static constexpr size_type vl = vector_bytes / sizeof(T);
+    static constexpr size_type nr = nv * vl;
+
+    typedef T vector_type __attribute__((vector_size(vector_bytes)));
+
+    static constexpr size_type kc = 256;
+    static constexpr size_type mc = mr * 16;
+    static constexpr size_type nc = 2048 / nr * nr;
+};
+
+// products with less multiply-adds than this go to simple loop
+inline constexpr std::size_t gemm_threshold = 48 * 48 * 48;
+
+//--------------------------------=| Packing start |=---------------------------------------------------
+// block mc x kc of alpha * A to panels of MR rows, inside panel elements go column by column
+template<typename T, typename ARows>
+void pack_a(ARows a_row, std::size_t ic, std::size_t pc, std::size_t mc, std::size_t kc, T alpha, T* dst)
+{
+    constexpr auto mr = GemmBlocking<T>::mr;
+    for (std::size_t ir = 0; ir < mc; ir += mr)
+    {
+        auto rows = std::min(mr, mc - ir);
+        for (std::size_t i = 0; i < rows; i++)
+        {
+            const T* src = a_row(ic + ir + i) + pc;
+            for (std::size_t p = 0; p < kc; p++)
+                dst[p * mr + i] = alpha * src[p];
+        }
+        for (std::size_t i = rows; i < mr; i++)
+            for (std::size_t p = 0; p < kc; p++)
+                dst[p * mr + i] = T{};
+        dst += mr * kc;
+    }
+}
+
+// block kc x nc of B to panels of NR columns, inside panel elements go row by row
+template<typename T, typename BRows>
+void pack_b(BRows b_row, std::size_t pc, std::size_t jc, std::size_t kc, std::size_t nc, T* dst)
+{
+    constexpr auto nr = GemmBlocking<T>::nr;
+    for (std::size_t jr = 0; jr < nc; jr += nr)
+    {
+        auto cols = std::min(nr, nc - jr);
+        for (std::size_t p = 0; p < kc; p++)
+        {
+            const T* src = b_row(pc + p) + jc + jr;
+            std::size_t j = 0;
+            for (; j < cols; j++)
+                dst[p * nr + j] = src[j];
+            for (; j < nr; j++)
+                dst[p * nr + j] = T{};
+        }
+        dst += nr * kc;
+    }
+}
+//--------------------------------=| Packing end |=-----------------------------------------------------
+
+//--------------------------------=| Micro kernel start |=----------------------------------------------
+// C[0:mr, 0:nr] += A panel * B panel, accumulators stay in vector registers for all kc steps
+template<typename T>
+void micro_kernel(std::size_t kc, const T* __restrict a, const T* __restrict b,
+                  T* const* c, std::size_t mr, std::size_t nr)
+{
+    using blk = GemmBlocking<T>;
+    using vec = typename blk::vector_type;
+    constexpr auto MR = blk::mr;
+    constexpr auto NR = blk::nr;
+    constexpr auto NV = blk::nv;
+    constexpr auto VL = blk::vl;
+
+    vec acc[MR][NV] = {};
+    for (std::size_t p = 0; p < kc; p++)
+    {
+        vec b_vec[NV];
+        for (std::size_t v = 0; v < NV; v++)
+            std::memcpy(&b_vec[v], b + p * NR + v * VL, sizeof(vec));
+
+        for (std::size_t i = 0; i < MR; i++)
+        {
+            const T a_elem = a[p * MR + i];
+            for (std::size_t v = 0; v < NV; v++)
+                acc[i][v] += a_elem * b_vec[v];
+        }
+    }
+
+    alignas(64) T res[MR][NR];
+    std::memcpy(res, acc, sizeof(res));
+    if (mr == MR && nr == NR)
+    {
+        for (std::size_t i = 0; i < MR; i++)
+            for (std::size_t j = 0; j < NR; j++)
+                c[i][j] += res[i][j];
+    }
+    else
+    {
+        for (std::size_t i = 0; i < mr; i++)
+            for (std::size_t j = 0; j < nr; j++)
+                c[i][j] += res[i][j];
+    }
+}
+//--------------------------------=| Micro kernel end |=------------------------------------------------
+
+/*
+ * C += alpha * A * B, where a_row(i) points to row i of m x k A, b_row(p) points to
+ * row p of k x n B and c_row(i) points to row i of m x n C.
+ */
+template<typename T, typename ARows, typename BRows, typename CRows>
+void gemm(std::size_t m, std::size_t n, std::size_t k, ARows a_row, BRows b_row, CRows c_row, T alpha = T{1})
+{
+    using blk = GemmBlocking<T>;
+
+    if (m == 0 || n == 0 || k == 0)
+        return;
+
+    auto mc_max = std::min(blk::mc, (m + blk::mr - 1) / blk::mr * blk::mr);
+    auto nc_max = std::min(blk::nc, (n + blk::nr - 1) / blk::nr * blk::nr);
+    auto kc_max = std::min(blk::kc, k);
+
+    AlignedBuffer<T> a_pack (mc_max * kc_max);
+    AlignedBuffer<T> b_pack (kc_max * nc_max);
+
+    for (std::size_t jc = 0; jc < n; jc += blk::nc)
+    {
+        auto nc = std::min(blk::nc, n - jc);
+        for (std::size_t pc = 0; pc < k; pc += blk::kc)
+        {
+            auto kc = std::min(blk::kc, k - pc);
+            pack_b(b_row, pc, jc, kc, nc, b_pack.data());
+
+            for (std::size_t ic = 0; ic < m; ic += blk::mc)
+            {
+                auto mc = std::min(blk::mc, m - ic);
+                pack_a(a_row, ic, pc, mc, kc, alpha, a_pack.data());
+
+                for (std::size_t ir = 0; ir < mc; ir += blk::mr)
+                {
+                    auto mr = std::min(blk::mr, mc - ir);
+                    T* c_tile[blk::mr] = {};
+                    for (std::size_t i = 0; i < mr; i++)
+                        c_tile[i] = c_row(ic + ir + i) + jc;
+
+                    for (std::size_t jr = 0; jr < nc; jr += blk::nr)
+                    {
+                        micro_kernel(kc, a_pack.data() + ir * kc, b_pack.data() + jr * kc,
+                                     c_tile, mr, std::min(blk::nr, nc - jr));
+                        for (std::size_t i = 0; i < mr; i++)
+                            c_tile[i] += blk::nr;
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace detail
+} // namespace Matrix
@@ -0,0 +1,390 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// 1 - operations of library count calls, flops, bytes and time (see below), 0 - counters compile to nothing
+#ifndef MATRIX_INSTRUMENT
+#define MATRIX_INSTRUMENT 0
+#endif
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Opt-in counters of library operations, built with MATRIX_INSTRUMENT=1.        |
+ * Every thread adds to its own counters (relaxed load and store, no locked     |
+ * instructions), instrument_snapshot() sums counters of all threads that ever  |
+ * ran operations. Counters are kept for every operation and size bucket:       |
+ * calls, flops, nanoseconds of wall time, bytes of matrices allocated and      |
+ * copied inside operation. Time of nested operation is part of time of outer   |
+ * one, bytes go to innermost operation (Operation::other outside of all).      |
+ * Between start_trace() and stop_trace() every call is recorded as event,      |
+ * write_chrome_trace() gives them in Chrome trace JSON (chrome://tracing,      |
+ * Perfetto).                                                                   |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+
+inline constexpr bool instrument_enabled = MATRIX_INSTRUMENT;
+
+enum class Operation
+{
+    other,
+    product,
+    strassen,
+    determinant,
+    inverse,
+    solve,
+    power,
+    transpos,
+    expression,
+    count
+};
+
+inline const char* operation_name(Operation op)
+{
+    static constexpr const char* names[] = {"other", "product", "strassen", "determinant", "inverse",
+                                            "solve", "power", "transpos", "expression"};
+    return op < Operation::count ? names[static_cast<std::size_t>(op)] : "unknown";
+}
+
+struct OperationCounters
+{
+    std::uint64_t calls = 0;
+    std::uint64_t flops = 0;
+    std::uint64_t bytes_allocated = 0;
+    std::uint64_t bytes_copied = 0;
+    std::uint64_t nanoseconds = 0;
+
+    OperationCounters& operator+=(const OperationCounters& rhs)
+    {
+        calls += rhs.calls;
+        flops += rhs.flops;
+        bytes_allocated += rhs.bytes_allocated;
+        bytes_copied += rhs.bytes_copied;
+        nanoseconds += rhs.nanoseconds;
+        return *this;
+    }
+
+    double seconds() const {return static_cast<double>(nanoseconds) * 1e-9;}
+    double gflops() const {return nanoseconds ? static_cast<double>(flops) / static_cast<double>(nanoseconds) : 0;}
+};
+
+// sum of counters at some moment, size bucket b holds operations on matrices with largest side in [2^(b-1), 2^b)
+class InstrumentSnapshot
+{
+public:
+    static constexpr std::size_t buckets = 32;
+    static constexpr std::size_t operations = static_cast<std::size_t>(Operation::count);
+
+private:
+    std::array<std::array<OperationCounters, buckets>, operations> counters_ {};
+
+public:
+    static std::size_t bucket_of(std::size_t size) {return std::min<std::size_t>(std::bit_width(size), buckets - 1);}
+
+    // smallest size of bucket
+    static std::size_t bucket_size(std::size_t bucket) {return bucket ? std::size_t{1} << (bucket - 1) : 0;}
+
+    OperationCounters&       at(Operation op, std::size_t bucket)       {return counters_.at(static_cast<std::size_t>(op)).at(bucket);}
+    const OperationCounters& at(Operation op, std::size_t bucket) const {return counters_.at(static_cast<std::size_t>(op)).at(bucket);}
+
+    OperationCounters total(Operation op) const
+    {
+        OperationCounters res;
+        for (const auto& counters: counters_.at(static_cast<std::size_t>(op)))
+            res += counters;
+        return res;
+    }
+
+    // table of buckets that had calls
+    void print(std::ostream& os) const
+    {
+        os << "operation\tsize\tcalls\tseconds\tGFLOP/s\tallocated\tcopied\n";
+        for (std::size_t op = 0; op < operations; op++)
+            for (std::size_t b = 0; b < buckets; b++)
+            {
+                const auto& counters = counters_[op][b];
+                if (!counters.calls && !counters.bytes_allocated && !counters.bytes_copied)
+                    continue;
+                os << operation_name(static_cast<Operation>(op)) << '\t' << bucket_size(b) << '\t' << counters.calls << '\t'
+                   << counters.seconds() << '\t' << counters.gflops() << '\t'
+                   << counters.bytes_allocated << '\t' << counters.bytes_copied << '\n';
+            }
+    }
+};
+
+namespace detail
+{
+// flops of classical algorithms, one multiply-add is two flops
+inline constexpr std::uint64_t product_flops(std::uint64_t m, std::uint64_t n, std::uint64_t k) {return 2 * m * n * k;}
+inline constexpr std::uint64_t lu_flops(std::uint64_t n) {return 2 * n * n * n / 3;}
+inline constexpr std::uint64_t lu_solve_flops(std::uint64_t n, std::uint64_t rhs) {return 2 * n * n * rhs;}
+
+#if MATRIX_INSTRUMENT
+struct TraceEvent
+{
+    Operation op;
+    std::size_t size;
+    std::uint64_t flops;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds duration;
+};
+
+struct ThreadCounters;
+
+/*
+ * Counters of all running threads in intrusive list, counters of finished threads are added
+ * to retired ones. Registry and counters live in static and thread storage, so counting
+ * doesnt allocate and allocation tests of library see no difference.
+ */
+struct InstrumentRegistry
+{
+    std::mutex mutex;
+    ThreadCounters* threads = nullptr;
+    std::size_t next_tid = 0;
+    InstrumentSnapshot retired;
+    std::vector<std::pair<std::size_t, TraceEvent>> retired_events;
+    std::atomic<bool> tracing {false};
+    const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+};
+
+// never destroyed: workers of static pools finish after static objects are gone
+inline InstrumentRegistry& instrument_registry()
+{
+    static union Holder
+    {
+        InstrumentRegistry registry;
+        Holder() :registry {} {}
+        ~Holder() {}
+    } holder;
+    return holder.registry;
+}
+
+struct ThreadCounters
+{
+    enum Field {calls, flops, allocated, copied, nanoseconds, fields};
+
+    // written only by owner thread, read by snapshots
+    std::array<std::array<std::array<std::atomic<std::uint64_t>, fields>, InstrumentSnapshot::buckets>,
+               InstrumentSnapshot::operations> values {};
+
+    // innermost running operation, owner thread only
+    Operation current = Operation::other;
+    std::size_t current_bucket = 0;
+
+    std::vector<TraceEvent> events;     // guarded by mutex of registry
+    std::size_t tid;
+    ThreadCounters* prev = nullptr;
+    ThreadCounters* next = nullptr;
+
+    ThreadCounters()
+    {
+        auto& registry = instrument_registry();
+        std::lock_guard lock {registry.mutex};
+        tid = registry.next_tid++;
+        next = registry.threads;
+        if (next)
+            next->prev = this;
+        registry.threads = this;
+    }
+
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    ~ThreadCounters()
+    {
+        auto& registry = instrument_registry();
+        std::lock_guard lock {registry.mutex};
+        add_to(registry.retired);
+        for (auto& event: events)
+            registry.retired_events.emplace_back(tid, event);
+        (prev ? prev->next : registry.threads) = next;
+        if (next)
+            next->prev = prev;
+    }
+
+    void add(Operation op, std::size_t bucket, Field field, std::uint64_t val)
+    {
+        auto& counter = values[static_cast<std::size_t>(op)][bucket][field];
+        counter.store(counter.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+    }
+
+    void add_to(InstrumentSnapshot& snapshot) const
+    {
+        for (std::size_t op = 0; op < InstrumentSnapshot::operations; op++)
+            for (std::size_t b = 0; b < InstrumentSnapshot::buckets; b++)
+            {
+                const auto& val = values[op][b];
+                auto get = [&val](Field field) {return val[field].load(std::memory_order_relaxed);};
+                snapshot.at(static_cast<Operation>(op), b) += {get(calls), get(flops), get(allocated),
+                                                               get(copied), get(nanoseconds)};
+            }
+    }
+
+    void reset()
+    {
+        for (auto& op: values)
+            for (auto& bucket: op)
+                for (auto& val: bucket)
+                    val.store(0, std::memory_order_relaxed);
+        events.clear();
+    }
+};
+
+inline ThreadCounters& thread_counters()
+{
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+// some C++ runtimes allocate when thread_local with destructor is met first time,
+// main thread meets it before main(), so operations there allocate only what they count
+inline const bool main_thread_counters = (thread_counters(), true);
+
+// one call of op on matrices with largest side size, counted when scope ends
+class OperationScope
+{
+    using clock = std::chrono::steady_clock;
+
+    ThreadCounters& counters_;
+    Operation op_, outer_;
+    std::size_t size_, bucket_, outer_bucket_;
+    std::uint64_t flops_;
+    clock::time_point start_;
+
+public:
+    OperationScope(Operation op, std::size_t size, std::uint64_t flops = 0)
+    :counters_ {thread_counters()}, op_ {op}, outer_ {counters_.current}, size_ {size},
+     bucket_ {InstrumentSnapshot::bucket_of(size)}, outer_bucket_ {counters_.current_bucket}, flops_ {flops},
+     start_ {clock::now()}
+    {
+        counters_.current = op_;
+        counters_.current_bucket = bucket_;
+    }
+
+    OperationScope(const OperationScope&) = delete;
+    OperationScope& operator=(const OperationScope&) = delete;
+
+    ~OperationScope()
+    {
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_);
+        counters_.add(op_, bucket_, ThreadCounters::calls, 1);
+        counters_.add(op_, bucket_, ThreadCounters::flops, flops_);
+        counters_.add(op_, bucket_, ThreadCounters::nanoseconds, static_cast<std::uint64_t>(duration.count()));
+        counters_.current = outer_;
+        counters_.current_bucket = outer_bucket_;
+
+        auto& registry = instrument_registry();
+        if (registry.tracing.load(std::memory_order_relaxed))
+        {
+            std::lock_guard lock {registry.mutex};
+            counters_.events.push_back({op_, size_, flops_, start_, duration});
+        }
+    }
+};
+
+inline void note_allocated(std::size_t bytes)
+{
+    auto& counters = thread_counters();
+    counters.add(counters.current, counters.current_bucket, ThreadCounters::allocated, bytes);
+}
+
+inline void note_copied(std::size_t bytes)
+{
+    auto& counters = thread_counters();
+    counters.add(counters.current, counters.current_bucket, ThreadCounters::copied, bytes);
+}
+#else
+class OperationScope
+{
+public:
+    constexpr OperationScope(Operation, std::size_t, std::uint64_t = 0) noexcept {}
+};
+
+inline void note_allocated(std::size_t) noexcept {}
+inline void note_copied(std::size_t) noexcept {}
+#endif
+} // namespace detail
+
+// counters of all threads, empty without MATRIX_INSTRUMENT
+inline InstrumentSnapshot instrument_snapshot()
+{
+    InstrumentSnapshot snapshot;
+#if MATRIX_INSTRUMENT
+    auto& registry = detail::instrument_registry();
+    std::lock_guard lock {registry.mutex};
+    snapshot = registry.retired;
+    for (auto* counters = registry.threads; counters; counters = counters->next)
+        counters->add_to(snapshot);
+#endif
+    return snapshot;
+}
+
+// BE CAREFUL: operations running during reset may keep part of their counts
+inline void instrument_reset()
+{
+#if MATRIX_INSTRUMENT
+    auto& registry = detail::instrument_registry();
+    std::lock_guard lock {registry.mutex};
+    registry.retired = {};
+    registry.retired_events.clear();
+    for (auto* counters = registry.threads; counters; counters = counters->next)
+        counters->reset();
+#endif
+}
+
+inline void start_trace()
+{
+#if MATRIX_INSTRUMENT
+    detail::instrument_registry().tracing = true;
+#endif
+}
+
+inline void stop_trace()
+{
+#if MATRIX_INSTRUMENT
+    detail::instrument_registry().tracing = false;
+#endif
+}
+
+// recorded events as complete ("X") events of Chrome trace format, time in microseconds from first use of counters
+inline void write_chrome_trace(std::ostream& os)
+{
+    os << "{\"traceEvents\":[";
+#if MATRIX_INSTRUMENT
+    auto& registry = detail::instrument_registry();
+    bool first = true;
+    auto flags = os.flags();
+    os << std::fixed << std::setprecision(3);
+    auto write = [&](std::size_t tid, const detail::TraceEvent& event)
+    {
+        auto start = std::chrono::duration<double, std::micro>(event.start - registry.origin).count();
+        auto duration = std::chrono::duration<double, std::micro>(event.duration).count();
+        os << (first ? "" : ",") << "\n{\"name\":\"" << operation_name(event.op) << "\",\"cat\":\"matrix\",\"ph\":\"X\""
+           << ",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << start << ",\"dur\":" << duration
+           << ",\"args\":{\"size\":" << event.size << ",\"flops\":" << event.flops << "}}";
+        first = false;
+    };
+
+    std::lock_guard lock {registry.mutex};
+    for (const auto& [tid, event]: registry.retired_events)
+        write(tid, event);
+    for (auto* counters = registry.threads; counters; counters = counters->next)
+        for (const auto& event: counters->events)
+            write(counters->tid, event);
+    os.flags(flags);
+#endif
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+} // namespace Matrix
@@ -0,0 +1,528 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "matrix_container.hpp"
+#include "matrix_view.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Input and output of matrices.                                                |
+ *                                                                              |
+ * Binary file: 64 bytes of FileHeader (sizes, type of elements, order of      |
+ * elements, byte order of machine that wrote it), then elements without gaps. |
+ * read_binary() reads them straight into rows of new matrix, MappedMatrix     |
+ * maps file into memory and gives view of it without reading or copying.      |
+ *                                                                              |
+ * Text: size N, then N * N elements by rows, separated by any spaces. It is   |
+ * parsed by std::from_chars from chunks of stream, so elements go into matrix |
+ * without temporary vector and without locale work of operator>>.             |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+enum class FileDtype : std::uint32_t
+{
+    f32 = 1,
+    f64 = 2,
+    i32 = 3,
+    i64 = 4
+};
+
+enum class FileLayout : std::uint32_t
+{
+    row_major = 0,
+    col_major = 1
+};
+
+struct FileHeader
+{
+    static constexpr char magic_value[8] = {'M', 'T', 'R', 'X', 'B', 'I', 'N', '\0'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t endian_mark = 0x01020304;   // reads as 0x04030201 on machine with other byte order
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endian;
+    FileDtype dtype;
+    FileLayout layout;
+    std::uint64_t height;
+    std::uint64_t width;
+    std::uint64_t data_offset;      // elements start here, multiple of 64 for aligned mapping
+    std::byte reserved[16];
+};
+
+static_assert(sizeof(FileHeader) == 64 && std::is_trivially_copyable_v<FileHeader>);
+
+namespace detail
+{
+template<typename T> constexpr FileDtype dtype_of = FileDtype{0};
+template<> inline constexpr FileDtype dtype_of<float>         = FileDtype::f32;
+template<> inline constexpr FileDtype dtype_of<double>        = FileDtype::f64;
+template<> inline constexpr FileDtype dtype_of<std::int32_t>  = FileDtype::i32;
+template<> inline constexpr FileDtype dtype_of<std::int64_t>  = FileDtype::i64;
+
+template<typename T>
+concept file_element = dtype_of<T> != FileDtype{0};
+
+// calls func.template operator()<F>() for type F of dtype
+template<typename Func>
+decltype(auto) visit_dtype(FileDtype dtype, Func&& func)
+{
+    switch (dtype)
+    {
+        case FileDtype::f32: return func.template operator()<float>();
+        case FileDtype::f64: return func.template operator()<double>();
+        case FileDtype::i32: return func.template operator()<std::int32_t>();
+        case FileDtype::i64: return func.template operator()<std::int64_t>();
+    }
+    throw std::runtime_error{"unknown type of elements in matrix file"};
+}
+
+template<typename T>
+void byte_swap(T* data, std::size_t n)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        if constexpr (sizeof(T) == 4)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, data + i, 4);
+            bits = __builtin_bswap32(bits);
+            std::memcpy(data + i, &bits, 4);
+        }
+        else
+        {
+            std::uint64_t bits;
+            std::memcpy(&bits, data + i, 8);
+            bits = __builtin_bswap64(bits);
+            std::memcpy(data + i, &bits, 8);
+        }
+    }
+}
+
+// header from start of file, swapped to byte order of this machine, throws if it is not matrix file
+inline FileHeader checked_header(const void* bytes, std::size_t file_size)
+{
+    if (file_size < sizeof(FileHeader))
+        throw std::runtime_error{"matrix file is shorter than header"};
+
+    FileHeader header;
+    std::memcpy(&header, bytes, sizeof(FileHeader));
+    if (std::memcmp(header.magic, FileHeader::magic_value, sizeof(header.magic)) != 0)
+        throw std::runtime_error{"file is not binary matrix file"};
+
+    if (header.endian != FileHeader::endian_mark)
+    {
+        byte_swap(&header.version, 1);
+        byte_swap(&header.endian, 1);
+        byte_swap(reinterpret_cast<std::uint32_t*>(&header.dtype), 1);
+        byte_swap(reinterpret_cast<std::uint32_t*>(&header.layout), 1);
+        byte_swap(&header.height, 1);
+        byte_swap(&header.width, 1);
+        byte_swap(&header.data_offset, 1);
+        if (header.endian != FileHeader::endian_mark)
+            throw std::runtime_error{"wrong byte order mark in matrix file"};
+        header.endian = 0;  // 0 means elements must be swapped
+    }
+
+    if (header.version != FileHeader::current_version)
+        throw std::runtime_error{"unsupported version of matrix file"};
+    if (header.layout != FileLayout::row_major && header.layout != FileLayout::col_major)
+        throw std::runtime_error{"unknown layout in matrix file"};
+
+    if (header.data_offset < sizeof(FileHeader) || header.data_offset > file_size)
+        throw std::runtime_error{"wrong offset of elements in matrix file"};
+
+    auto elem_size = visit_dtype(header.dtype, []<typename F>() {return sizeof(F);});
+    if (header.height && header.width > std::numeric_limits<std::size_t>::max() / elem_size / header.height)
+        throw std::runtime_error{"size of matrix in matrix file is too big"};
+    if (header.height && header.width > (file_size - header.data_offset) / elem_size / header.height)
+        throw std::runtime_error{"matrix file is shorter than its elements"};
+    return header;
+}
+
+// bytes from current position to end of seekable stream, stream that cant seek gives SIZE_MAX / 2
+// (only overflow of size is checked then), position and state of stream are not changed
+inline std::size_t remaining_size(std::istream& in)
+{
+    const std::streampos none {std::streamoff{-1}};
+    auto buf = in.rdbuf();
+    auto here = buf->pubseekoff(0, std::ios::cur, std::ios::in);
+    if (here == none)
+        return std::numeric_limits<std::size_t>::max() / 2;
+    auto end = buf->pubseekoff(0, std::ios::end, std::ios::in);
+    buf->pubseekpos(here, std::ios::in);
+    if (end == none || end < here)
+        return std::numeric_limits<std::size_t>::max() / 2;
+    return static_cast<std::size_t>(end - here);
+}
+} // namespace detail
+
+//--------------------------------=| Binary start |=----------------------------------------------------
+// M is matrix or view, layout is order of elements in file
+template<typename M>
+void write_binary(std::ostream& out, const M& mat, FileLayout layout = FileLayout::row_major)
+{
+    using T = typename M::value_type;
+    static_assert(detail::file_element<T>, "binary file keeps only float, double, int32_t and int64_t");
+
+    FileHeader header {};
+    std::memcpy(header.magic, FileHeader::magic_value, sizeof(header.magic));
+    header.version = FileHeader::current_version;
+    header.endian = FileHeader::endian_mark;
+    header.dtype = detail::dtype_of<T>;
+    header.layout = layout;
+    header.height = mat.height();
+    header.width = mat.width();
+    header.data_offset = sizeof(FileHeader);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    auto outer = layout == FileLayout::row_major ? mat.height() : mat.width();
+    auto inner = layout == FileLayout::row_major ? mat.width() : mat.height();
+    std::vector<T> buf (inner);
+    for (std::size_t k = 0; k < outer; k++)
+    {
+        const T* data = buf.data();
+        if constexpr (requires {mat[k].data();})
+        {
+            if (layout == FileLayout::row_major)
+                data = mat[k].data();
+        }
+        if (data == buf.data())
+            for (std::size_t l = 0; l < inner; l++)
+                buf[l] = layout == FileLayout::row_major ? mat.to(k, l) : mat.to(l, k);
+        out.write(reinterpret_cast<const char*>(data), inner * sizeof(T));
+    }
+
+    if (!out)
+        throw std::runtime_error{"cant write matrix file"};
+}
+
+template<typename M>
+void write_binary(const std::string& path, const M& mat, FileLayout layout = FileLayout::row_major)
+{
+    std::ofstream out {path, std::ios::binary};
+    if (!out)
+        throw std::runtime_error{"cant open matrix file " + path};
+    write_binary(out, mat, layout);
+}
+
+// elements of any dtype of file are converted to value_type of M
+template<typename M>
+M read_binary(std::istream& in)
+{
+    using T = typename M::value_type;
+
+    char header_bytes[sizeof(FileHeader)];
+    if (!in.read(header_bytes, sizeof(header_bytes)))
+        throw std::runtime_error{"matrix file is shorter than header"};
+    auto header = detail::checked_header(header_bytes, sizeof(FileHeader) + detail::remaining_size(in));
+    in.ignore(header.data_offset - sizeof(FileHeader));
+
+    M mat (header.height, header.width);
+    bool row_major = header.layout == FileLayout::row_major;
+    auto outer = row_major ? header.height : header.width;
+    auto inner = row_major ? header.width : header.height;
+
+    detail::visit_dtype(header.dtype, [&]<typename F>()
+    {
+        std::vector<F> buf;
+        for (std::size_t k = 0; k < outer; k++)
+        {
+            // row of the same type goes straight into matrix
+            F* dst = nullptr;
+            if constexpr (std::is_same_v<F, T>)
+                if (row_major)
+                    dst = mat[k].data();
+            if (!dst)
+            {
+                buf.resize(inner);
+                dst = buf.data();
+            }
+
+            if (!in.read(reinterpret_cast<char*>(dst), inner * sizeof(F)))
+                throw std::runtime_error{"matrix file is shorter than its elements"};
+            if (!header.endian)
+                detail::byte_swap(dst, inner);
+
+            if (dst == buf.data())
+                for (std::size_t l = 0; l < inner; l++)
+                    (row_major ? mat.to(k, l) : mat.to(l, k)) = static_cast<T>(buf[l]);
+        }
+    });
+    return mat;
+}
+
+template<typename M>
+M read_binary(const std::string& path)
+{
+    std::ifstream in {path, std::ios::binary};
+    if (!in)
+        throw std::runtime_error{"cant open matrix file " + path};
+    return read_binary<M>(in);
+}
+
+// file is binary matrix file if it starts with magic of FileHeader
+inline bool is_binary_matrix_file(const std::string& path)
+{
+    std::ifstream in {path, std::ios::binary};
+    char magic[sizeof(FileHeader::magic_value)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, FileHeader::magic_value, sizeof(magic)) == 0;
+}
+
+/*
+ * Binary file mapped into memory. Mapping is private: elements can be changed
+ * through view, changed pages are copied by system and file stays the same.
+ * File must have elements of type T in byte order of this machine, other
+ * files are read by read_binary(). Column-major file gives transposed view.
+ */
+template<typename T>
+class MappedMatrix
+{
+    static_assert(detail::file_element<T>, "binary file keeps only float, double, int32_t and int64_t");
+
+public:
+    using size_type  = std::size_t;
+    using value_type = T;
+
+private:
+    void* map_ = MAP_FAILED;
+    size_type map_size_ = 0;
+    FileHeader header_ {};
+    // row handles are not copyable, so they live in array built once for the mapping
+    std::unique_ptr<MatrixRow<T>[]> rows_;
+    size_type rows_size_ = 0;
+
+    void unmap() noexcept
+    {
+        if (map_ != MAP_FAILED)
+            ::munmap(map_, map_size_);
+        map_ = MAP_FAILED;
+    }
+
+public:
+    explicit MappedMatrix(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error{"cant open matrix file " + path};
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader)))
+        {
+            ::close(fd);
+            throw std::runtime_error{"matrix file is shorter than header"};
+        }
+        map_size_ = static_cast<size_type>(st.st_size);
+        map_ = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map_ == MAP_FAILED)
+            throw std::runtime_error{"cant map matrix file " + path};
+
+        try
+        {
+            header_ = detail::checked_header(map_, map_size_);
+            if (header_.dtype != detail::dtype_of<T>)
+                throw std::runtime_error{"type of elements in matrix file differs from type of MappedMatrix, use read_binary()"};
+            if (!header_.endian)
+                throw std::runtime_error{"matrix file has other byte order, use read_binary()"};
+            if (header_.data_offset % alignof(T))
+                throw std::runtime_error{"elements in matrix file are not aligned"};
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+        ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+        auto data = reinterpret_cast<T*>(static_cast<std::byte*>(map_) + header_.data_offset);
+        auto outer = header_.layout == FileLayout::row_major ? header_.height : header_.width;
+        auto inner = header_.layout == FileLayout::row_major ? header_.width : header_.height;
+        rows_ = std::make_unique<MatrixRow<T>[]>(outer);
+        rows_size_ = outer;
+        for (size_type k = 0; k < outer; k++)
+            std::construct_at(rows_.get() + k, data + k * inner, inner);
+    }
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    MappedMatrix(MappedMatrix&& rhs) noexcept
+    :map_ {std::exchange(rhs.map_, MAP_FAILED)}, map_size_ {rhs.map_size_}, header_ {rhs.header_}, rows_ {std::move(rhs.rows_)},
+     rows_size_ {std::exchange(rhs.rows_size_, 0)}
+    {}
+
+    MappedMatrix& operator=(MappedMatrix&& rhs) noexcept
+    {
+        std::swap(map_, rhs.map_);
+        std::swap(map_size_, rhs.map_size_);
+        std::swap(header_, rhs.header_);
+        std::swap(rows_, rhs.rows_);
+        std::swap(rows_size_, rhs.rows_size_);
+        return *this;
+    }
+
+    ~MappedMatrix() {unmap();}
+
+    size_type height() const {return header_.height;}
+    size_type width()  const {return header_.width;}
+    FileLayout layout() const {return header_.layout;}
+
+    // view is valid while MappedMatrix lives, M is matrix type the view works with
+    template<typename M = MatrixContainer<T>>
+    MatrixView<M> view()
+    {
+        static_assert(std::is_same_v<typename M::value_type, T>);
+        MatrixView<M> res (rows_.get(), rows_size_, rows_size_ ? rows_[0].size() : 0);
+        if (header_.layout == FileLayout::col_major)
+            return res.transposed();
+        return res;
+    }
+
+    template<typename M = MatrixContainer<T>>
+    ConstMatrixView<M> view() const
+    {
+        static_assert(std::is_same_v<typename M::value_type, T>);
+        ConstMatrixView<M> res (rows_.get(), rows_size_, rows_size_ ? rows_[0].size() : 0);
+        if (header_.layout == FileLayout::col_major)
+            return res.transposed();
+        return res;
+    }
+};
+//--------------------------------=| Binary end |=------------------------------------------------------
+
+//--------------------------------=| Text start |=------------------------------------------------------
+namespace detail
+{
+// numbers separated by spaces, stream is read by chunks, number cut by end of chunk is moved to start of buffer
+class TextReader
+{
+    std::istream& in_;
+    std::vector<char> buf_;
+    std::size_t pos_ = 0, end_ = 0;
+    bool eof_ = false;
+
+    static bool is_space(char ch) {return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';}
+
+    void refill()
+    {
+        std::memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+        end_ -= pos_;
+        pos_ = 0;
+        if (end_ == buf_.size())
+            buf_.resize(buf_.size() * 2);   // number longer than chunk
+        in_.read(buf_.data() + end_, static_cast<std::streamsize>(buf_.size() - end_));
+        end_ += static_cast<std::size_t>(in_.gcount());
+        eof_ = !in_;
+    }
+
+public:
+    explicit TextReader(std::istream& in, std::size_t chunk = 1 << 20)
+    :in_ {in}, buf_ (std::max<std::size_t>(chunk, 64))
+    {}
+
+    template<typename V>
+    V next()
+    {
+        for (;;)
+        {
+            while (pos_ < end_ && is_space(buf_[pos_]))
+                pos_++;
+            if (pos_ < end_)
+                break;
+            if (eof_)
+                throw std::invalid_argument{"text of matrix ends before all elements"};
+            refill();
+        }
+
+        auto token_end = pos_;
+        for (;;)
+        {
+            while (token_end < end_ && !is_space(buf_[token_end]))
+                token_end++;
+            if (token_end < end_ || eof_)
+                break;
+            token_end -= pos_;
+            refill();
+        }
+
+        auto first = buf_.data() + pos_;
+        if (*first == '+')
+            first++;
+        V val;
+        auto [ptr, err] = std::from_chars(first, buf_.data() + token_end, val);
+        if (err != std::errc{} || ptr != buf_.data() + token_end)
+            throw std::invalid_argument{"wrong number in text of matrix"};
+        pos_ = token_end;
+        return val;
+    }
+};
+} // namespace detail
+
+// size N, then N * N elements by rows
+template<typename M>
+M read_text(std::istream& in, std::size_t chunk = 1 << 20)
+{
+    detail::TextReader reader {in, chunk};
+    auto size = reader.next<std::size_t>();
+
+    M mat (size, size);
+    for (std::size_t i = 0; i < size; i++)
+        for (std::size_t j = 0; j < size; j++)
+            mat.to(i, j) = reader.next<typename M::value_type>();
+    return mat;
+}
+
+// the shortest text that reads back to the same elements
+template<typename M>
+void write_text(std::ostream& out, const M& mat)
+{
+    if (!mat.is_square())
+        throw std::invalid_argument{"text format keeps only square matrices"};
+
+    std::vector<char> buf (1 << 16);
+    std::size_t pos = 0;
+    auto flush = [&] {out.write(buf.data(), static_cast<std::streamsize>(pos)); pos = 0;};
+
+    auto put = [&](const auto& val, char sep)
+    {
+        if (buf.size() - pos < 64)
+            flush();
+        pos = static_cast<std::size_t>(std::to_chars(buf.data() + pos, buf.data() + buf.size() - 1, val).ptr - buf.data());
+        buf[pos++] = sep;
+    };
+
+    put(mat.height(), '\n');
+    for (std::size_t i = 0; i < mat.height(); i++)
+        for (std::size_t j = 0; j < mat.width(); j++)
+            put(mat.to(i, j), j + 1 == mat.width() ? '\n' : ' ');
+    flush();
+
+    if (!out)
+        throw std::runtime_error{"cant write text of matrix"};
+}
+//--------------------------------=| Text end |=--------------------------------------------------------
+
+} // namespace Matrix
@@ -0,0 +1,261 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "matrix_container.hpp"
+#include "matrix_gemm.hpp"
+#include "matrix_simd.hpp"
+#include "matrix_thread_pool.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Right-looking blocked LU with partial pivoting: P * A = L * U in place.       |
+ * For every panel of nb columns:                                                |
+ *   1. panel is factorized column by column, pivot row is swapped whole        |
+ *      (O(1) swap_row of MatrixContainer), so pivots are the same as in        |
+ *      unblocked Gauss elimination;                                            |
+ *   2. U12 = L11^-1 * A12, columns of A12 are split between threads;           |
+ *   3. A22 -= L21 * U12 by GEMM kernel, rows of A22 are split between threads. |
+ * L has unit diagonal and is kept under diagonal of matrix. Types without     |
+ * GEMM kernel go through the same steps with plain loops.                      |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T>
+concept is_blocked_lu_available = std::is_floating_point_v<T> && is_gemm_available<T>;
+
+inline constexpr std::size_t lu_block_size = 128;
+
+// smaller matrices are factorized by old single thread elimination
+inline constexpr std::size_t blocked_lu_threshold = 256;
+
+// update of panel is split between threads when it has at least this number of elements
+inline constexpr std::size_t lu_parallel_panel = 1 << 16;
+
+// threads get at least this number of rows or columns
+inline constexpr std::size_t lu_min_grain = 96;
+
+/*
+ * pivots[k] is row swapped with row k on step k. Returns 1 or -1: sign of permutation P.
+ * Column without nonzero pivot is skipped, so singular matrix gets zero on diagonal of U.
+ */
+template<typename T, typename Abs, typename Cmp>
+T blocked_lu(MatrixContainer<T>& mat, std::vector<std::size_t>& pivots, Abs abs, Cmp cmp,
+             ThreadPool& pool, std::size_t nb = lu_block_size)
+{
+    using size_type = std::size_t;
+    if (!mat.is_square())
+        throw std::invalid_argument{"try to make LU decomposition of no square matrix"};
+
+    const size_type n = mat.height();
+    const size_type threads = pool.num_threads();
+    nb = std::max<size_type>(nb, 1);
+    pivots.assign(n, 0);
+
+    T sign {1};
+    T null_obj {};
+    for (size_type k0 = 0; k0 < n; k0 += nb)
+    {
+        const size_type kb = std::min(nb, n - k0);
+        const size_type k_end = k0 + kb;
+
+        // 1. panel
+        for (size_type k = k0; k < k_end; k++)
+        {
+            size_type piv = k;
+            for (size_type i = k + 1; i < n; i++)
+                if (abs(mat[i][k]) > abs(mat[piv][k]))
+                    piv = i;
+            pivots[k] = piv;
+            if (piv != k)
+            {
+                mat.swap_row(k, piv);
+                sign *= T{-1};
+            }
+
+            const T pivot = mat[k][k];
+            if (cmp(pivot, null_obj))
+                continue;
+
+            auto eliminate = [&mat, k, k_end, pivot](size_type lo, size_type hi)
+            {
+                const T* pivot_row = mat[k].data();
+                for (size_type i = lo; i < hi; i++)
+                {
+                    T* row = mat[i].data();
+                    T coef = row[k] / pivot;
+                    row[k] = coef;
+                    for (size_type j = k + 1; j < k_end; j++)
+                        row[j] -= coef * pivot_row[j];
+                }
+            };
+
+            if ((n - k) * kb >= lu_parallel_panel)
+                pool.parallel_for(k + 1, n, std::max<size_type>((n - k) / threads, lu_min_grain), eliminate);
+            else
+                eliminate(k + 1, n);
+        }
+
+        if (k_end == n)
+            break;
+
+        // 2. U12 = L11^-1 * A12
+        auto solve_u12 = [&mat, k0, k_end](size_type lo, size_type hi)
+        {
+            for (size_type k = k0; k < k_end; k++)
+                for (size_type i = k + 1; i < k_end; i++)
+                {
+                    T coef = -mat[i][k];
+                    elementwise<ElementwiseOp::axpy>(mat[i].data() + lo, mat[k].data() + lo, coef, hi - lo);
+                }
+        };
+        const size_type rest = n - k_end;
+        pool.parallel_for(k_end, n, std::max<size_type>((rest + threads - 1) / threads, lu_min_grain), solve_u12);
+
+        // 3. A22 -= L21 * U12
+        auto update = [&mat, k0, kb, k_end, rest](size_type lo, size_type hi)
+        {
+            if constexpr (is_gemm_available<T>)
+                gemm<T>(hi - lo, rest, kb,
+                        [&mat, k0, k_end, lo](size_type i) {return static_cast<const T*>(mat[k_end + lo + i].data() + k0);},
+                        [&mat, k0, k_end](size_type p) {return static_cast<const T*>(mat[k0 + p].data() + k_end);},
+                        [&mat, k_end, lo](size_type i) {return mat[k_end + lo + i].data() + k_end;},
+                        T{-1});
+            else
+                for (size_type i = k_end + lo; i < k_end + hi; i++)
+                    for (size_type p = 0; p < kb; p++)
+                    {
+                        T coef = -mat[i][k0 + p];
+                        elementwise<ElementwiseOp::axpy>(mat[i].data() + k_end, mat[k0 + p].data() + k_end, coef, rest);
+                    }
+        };
+        pool.parallel_for(0, rest, std::max<size_type>((rest + 2 * threads - 1) / (2 * threads), lu_min_grain), update);
+    }
+
+    return sign;
+}
+
+// right-hand sides narrower than this are updated by row axpy, not by GEMM kernel
+inline constexpr std::size_t lu_solve_gemm_width = 8;
+
+// x[r0 + i] -= lu[r0 + i][c0 : c0 + kb] * x[c0 : c0 + kb] for i < rows
+template<typename T>
+void lu_solve_update(const MatrixContainer<T>& lu, MatrixContainer<T>& x, std::size_t r0, std::size_t rows,
+                     std::size_t c0, std::size_t kb, ThreadPool& pool)
+{
+    using size_type = std::size_t;
+    const size_type m = x.width();
+
+    auto update = [&lu, &x, r0, c0, kb, m](size_type lo, size_type hi)
+    {
+        if constexpr (is_gemm_available<T>)
+            if (m >= lu_solve_gemm_width)
+            {
+                gemm<T>(hi - lo, m, kb,
+                        [&lu, r0, c0, lo](size_type i) {return lu[r0 + lo + i].data() + c0;},
+                        [&x, c0](size_type p) {return static_cast<const T*>(x[c0 + p].data());},
+                        [&x, r0, lo](size_type i) {return x[r0 + lo + i].data();},
+                        T{-1});
+                return;
+            }
+
+        for (size_type i = r0 + lo; i < r0 + hi; i++)
+            for (size_type p = c0; p < c0 + kb; p++)
+            {
+                T coef = -lu[i][p];
+                elementwise<ElementwiseOp::axpy>(x[i].data(), x[p].data(), coef, m);
+            }
+    };
+
+    if (rows * kb * m >= lu_parallel_panel * lu_min_grain)
+        pool.parallel_for(0, rows, std::max<size_type>((rows + pool.num_threads() - 1) / pool.num_threads(), lu_min_grain), update);
+    else
+        update(0, rows);
+}
+
+/*
+ * Triangular solves in place of x by blocks of nb rows: inside diagonal block by
+ * row axpy over all right-hand sides at once, rest of rows are updated by one
+ * GEMM per block. Lower one reads lu under diagonal, with unit diagonal or with
+ * diagonal of lu, upper one reads lu on and above diagonal.
+ */
+template<typename T>
+void lower_solve(const MatrixContainer<T>& lu, MatrixContainer<T>& x, bool unit_diagonal,
+                 ThreadPool& pool = default_pool(), std::size_t nb = lu_block_size)
+{
+    using size_type = std::size_t;
+
+    const size_type n = lu.height();
+    const size_type m = x.width();
+    nb = std::max<size_type>(nb, 1);
+
+    for (size_type k0 = 0; k0 < n; k0 += nb)
+    {
+        const size_type k_end = std::min(k0 + nb, n);
+        for (size_type k = k0; k < k_end; k++)
+        {
+            if (!unit_diagonal)
+                elementwise<ElementwiseOp::div>(x[k].data(), x[k].data(), lu[k][k], m);
+            for (size_type i = k + 1; i < k_end; i++)
+            {
+                T coef = -lu[i][k];
+                elementwise<ElementwiseOp::axpy>(x[i].data(), x[k].data(), coef, m);
+            }
+        }
+        lu_solve_update(lu, x, k_end, n - k_end, k0, k_end - k0, pool);
+    }
+}
+
+template<typename T>
+void upper_solve(const MatrixContainer<T>& lu, MatrixContainer<T>& x,
+                 ThreadPool& pool = default_pool(), std::size_t nb = lu_block_size)
+{
+    using size_type = std::size_t;
+
+    const size_type n = lu.height();
+    const size_type m = x.width();
+    nb = std::max<size_type>(nb, 1);
+
+    for (size_type k_end = n; k_end > 0;)
+    {
+        const size_type k0 = k_end > nb ? k_end - nb : 0;
+        for (size_type k = k_end; k-- > k0;)
+        {
+            elementwise<ElementwiseOp::div>(x[k].data(), x[k].data(), lu[k][k], m);
+            for (size_type i = k0; i < k; i++)
+            {
+                T coef = -lu[i][k];
+                elementwise<ElementwiseOp::axpy>(x[i].data(), x[k].data(), coef, m);
+            }
+        }
+        lu_solve_update(lu, x, 0, k0, k0, k_end - k0, pool);
+        k_end = k0;
+    }
+}
+
+// solves L * U * X = P * B in place of x for factors made by blocked_lu, rows of x are exchanged by O(1) swap_row
+template<typename T>
+void lu_solve(const MatrixContainer<T>& lu, const std::vector<std::size_t>& pivots, MatrixContainer<T>& x,
+              ThreadPool& pool = default_pool(), std::size_t nb = lu_block_size)
+{
+    using size_type = std::size_t;
+
+    const size_type n = lu.height();
+    if (x.height() != n)
+        throw std::invalid_argument{"in solve: rhs.height() != size of LU decomposition"};
+
+    for (size_type k = 0; k < n; k++)
+        if (pivots[k] != k)
+            x.swap_row(k, pivots[k]);
+
+    lower_solve(lu, x, true, pool, nb);
+    upper_solve(lu, x, pool, nb);
+}
+
+} // namespace detail
+} // namespace Matrix
@@ -0,0 +1,156 @@
+#pragma once
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * P * A = L * U made once, then determinant, solves and inverse reuse factors: |
+ * determinant is O(n), every solve is O(n^2) for each right-hand side.          |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T = double, bool IsDivArithm = true, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class LUDecomposition
+{
+    static_assert(IsDivArithm, "LU decomposition needs arithmetical correct division");
+
+public:
+    using matrix_type = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+    using size_type   = typename matrix_type::size_type;
+    using value_type  = typename matrix_type::value_type;
+
+private:
+    matrix_type lu_;
+    std::vector<size_type> pivots_;
+    value_type sign_ {1};
+    bool singular_ = false;
+    ThreadPool* pool_;      // pool of factorization, solves run on it too, so it must outlive decomposition
+    Cmp cmp {};
+
+    void factorize(ThreadPool& pool)
+    {
+        if (!lu_.is_square())
+            throw std::invalid_argument{"try to make LU decomposition of no square matrix"};
+
+        sign_ = detail::blocked_lu(lu_, pivots_, Abs{}, cmp, pool);
+        for (size_type i = 0; i < lu_.height(); i++)
+            if (cmp(lu_.to(i, i), value_type{}))
+                singular_ = true;
+    }
+
+    void check_regular() const
+    {
+        if (singular_)
+            throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    explicit LUDecomposition(const matrix_type& mat, ThreadPool& pool = default_pool())
+    :lu_ {mat}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+
+    // factorizes in place of mat, no copy
+    explicit LUDecomposition(matrix_type&& mat, ThreadPool& pool = default_pool())
+    :lu_ {std::move(mat)}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+
+    // view of block or other lazy expression is evaluated straight into factors
+    template<detail::is_matrix_expression E>
+    explicit LUDecomposition(const E& expr, ThreadPool& pool = default_pool()) requires std::same_as<typename E::matrix_type, matrix_type>
+    :lu_ {expr}, pool_ {&pool}
+    {
+        factorize(pool);
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Factors start |=---------------------------------------------------
+    size_type size() const {return lu_.height();}
+    bool is_singular() const {return singular_;}
+
+    // pivots()[k] is row exchanged with row k on step k of elimination
+    const std::vector<size_type>& pivots() const {return pivots_;}
+
+    matrix_type lower() const
+    {
+        matrix_type res = matrix_type::eye(size());
+        for (size_type i = 0; i < size(); i++)
+            for (size_type j = 0; j < i; j++)
+                res.to(i, j) = lu_.to(i, j);
+        return res;
+    }
+
+    matrix_type upper() const
+    {
+        matrix_type res (size(), size());
+        for (size_type i = 0; i < size(); i++)
+            for (size_type j = i; j < size(); j++)
+                res.to(i, j) = lu_.to(i, j);
+        return res;
+    }
+//--------------------------------=| Factors end |=-----------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    value_type determinant() const
+    {
+        value_type res = sign_;
+        for (size_type i = 0; i < size(); i++)
+            res *= lu_.to(i, i);
+        return res;
+    }
+
+    // X: A * X = rhs, rhs may have any number of columns
+    matrix_type solve(const matrix_type& rhs) const
+    {
+        check_regular();
+        matrix_type res (rhs);
+        detail::lu_solve(lu_, pivots_, res, *pool_);
+        return res;
+    }
+
+    std::vector<value_type> solve(const std::vector<value_type>& rhs) const
+    {
+        check_regular();
+        matrix_type res (rhs.size(), 1, rhs.begin(), rhs.end());
+        detail::lu_solve(lu_, pivots_, res, *pool_);
+
+        std::vector<value_type> res_vec (rhs.size());
+        for (size_type i = 0; i < res_vec.size(); i++)
+            res_vec[i] = res.to(i, 0);
+        return res_vec;
+    }
+
+    matrix_type inverse() const
+    {
+        if (singular_)
+            throw std::invalid_argument{"try to get inverse matrix for matrix with determinant equal to zero"};
+        return solve(matrix_type::eye(size()));
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class LUDecomposition
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+LUDecomposition(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&) -> LUDecomposition<T, IsDivArithm, Cmp, Abs>;
+
+template<typename T, bool IsDivArithm, class Cmp, class Abs>
+LUDecomposition(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>&, ThreadPool&) -> LUDecomposition<T, IsDivArithm, Cmp, Abs>;
+
+template<detail::is_matrix_expression E>
+LUDecomposition(const E&) -> LUDecomposition<typename E::value_type,
+                                             detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                             typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                             typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
+template<detail::is_matrix_expression E>
+LUDecomposition(const E&, ThreadPool&) -> LUDecomposition<typename E::value_type,
+                                                          detail::is_matrix_arithmetic<typename E::matrix_type>::is_div_arithmetical,
+                                                          typename detail::is_matrix_arithmetic<typename E::matrix_type>::cmp_type,
+                                                          typename detail::is_matrix_arithmetic<typename E::matrix_type>::abs_type>;
+
+} // namespace Matrix
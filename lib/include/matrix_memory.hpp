@@ -0,0 +1,298 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Memory of matrices comes from std::pmr::memory_resource. Every matrix keeps  |
+ * resource it was created with, new matrices take current resource of their  |
+ * thread: std::pmr::get_default_resource() or resource set by ResourceGuard.   |
+ * So all matrices of one request, temporaries inside library included, can   |
+ * live in one Arena and be freed by one reset():                               |
+ *                                                                              |
+ *     Matrix::Arena arena;                                                     |
+ *     {                                                                        |
+ *         Matrix::ResourceGuard guard {arena};                                 |
+ *         ... work with matrices ...                                           |
+ *     }                                                                        |
+ *     arena.reset();                                                           |
+ *                                                                              |
+ * Like in std::pmr containers, move assignment moves buffer only between      |
+ * equal resources and copies elements otherwise, so matrix never takes memory |
+ * of arena it was not created in. Workers of ThreadPool have own current      |
+ * resource, Arena and SizeClassPool are not thread safe and are not shared.   |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+namespace detail
+{
+inline std::pmr::memory_resource*& thread_resource() noexcept
+{
+    thread_local std::pmr::memory_resource* res = nullptr;
+    return res;
+}
+} // namespace detail
+
+// resource for new matrices of calling thread
+inline std::pmr::memory_resource* current_resource() noexcept
+{
+    auto res = detail::thread_resource();
+    return res ? res : std::pmr::get_default_resource();
+}
+
+// sets current resource of thread while guard is alive
+class ResourceGuard
+{
+    std::pmr::memory_resource* prev_;
+
+public:
+    explicit ResourceGuard(std::pmr::memory_resource& res)
+    :prev_ {std::exchange(detail::thread_resource(), &res)}
+    {}
+
+    ResourceGuard(const ResourceGuard&) = delete;
+    ResourceGuard& operator=(const ResourceGuard&) = delete;
+
+    ~ResourceGuard() {detail::thread_resource() = prev_;}
+};
+
+namespace detail
+{
+inline std::byte* align_up(std::byte* ptr, std::size_t align) noexcept
+{
+    auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+    return ptr + ((align - addr % align) % align);
+}
+} // namespace detail
+
+/*
+ * Bump allocator: allocation moves pointer inside chunk, deallocation does
+ * nothing, reset() makes all memory free at once. Chunks are kept between
+ * resets, and if request did not fit in one chunk they are merged into one
+ * big chunk, so after first request arena does not go to upstream at all.
+ */
+class Arena : public std::pmr::memory_resource
+{
+public:
+    using size_type = std::size_t;
+    static constexpr size_type chunk_alignment = 64;
+
+private:
+    struct Chunk
+    {
+        std::byte* data;
+        size_type size;
+    };
+
+    std::pmr::memory_resource* upstream_;
+    std::vector<Chunk> chunks_;
+    size_type current_ = 0;     // chunks before current_ are full
+    std::byte* ptr_ = nullptr;
+    std::byte* end_ = nullptr;
+    size_type next_size_;
+
+    void use_chunk(size_type ind) noexcept
+    {
+        current_ = ind;
+        ptr_ = chunks_[ind].data;
+        end_ = chunks_[ind].data + chunks_[ind].size;
+    }
+
+    void add_chunk(size_type size)
+    {
+        chunks_.reserve(chunks_.size() + 1);
+        auto data = static_cast<std::byte*>(upstream_->allocate(size, chunk_alignment));
+        chunks_.push_back({data, size});
+        use_chunk(chunks_.size() - 1);
+    }
+
+    size_type total_size() const noexcept
+    {
+        size_type res = 0;
+        for (auto& chunk: chunks_)
+            res += chunk.size;
+        return res;
+    }
+
+protected:
+    void* do_allocate(size_type bytes, size_type align) override
+    {
+        for (;;)
+        {
+            auto ptr = detail::align_up(ptr_, align);
+            if (ptr_ && ptr <= end_ && static_cast<size_type>(end_ - ptr) >= bytes)
+            {
+                ptr_ = ptr + bytes;
+                return ptr;
+            }
+            if (current_ + 1 < chunks_.size())
+                use_chunk(current_ + 1);
+            else
+                break;
+        }
+
+        add_chunk(std::max(next_size_, bytes + align));
+        next_size_ = std::max(next_size_, chunks_.back().size) * 2;
+        auto ptr = detail::align_up(ptr_, align);
+        ptr_ = ptr + bytes;
+        return ptr;
+    }
+
+    void do_deallocate(void*, size_type, size_type) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {return this == &other;}
+
+public:
+    explicit Arena(size_type initial_size = 64 * 1024,
+                   std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+    :upstream_ {upstream}, next_size_ {std::max<size_type>(initial_size, chunk_alignment)}
+    {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {release();}
+
+    // all memory given by arena is free again, matrices from it must be destroyed before
+    void reset()
+    {
+        if (chunks_.empty())
+            return;
+        if (chunks_.size() > 1)
+        {
+            auto size = total_size();
+            release();
+            add_chunk(size);
+            next_size_ = size * 2;
+        }
+        use_chunk(0);
+    }
+
+    // gives chunks back to upstream
+    void release() noexcept
+    {
+        for (auto& chunk: chunks_)
+            upstream_->deallocate(chunk.data, chunk.size, chunk_alignment);
+        chunks_.clear();
+        current_ = 0;
+        ptr_ = end_ = nullptr;
+    }
+
+    size_type capacity() const noexcept {return total_size();}
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {return upstream_;}
+};
+
+/*
+ * Pool of blocks with sizes 64, 128, 256 ... max_block bytes. Block is
+ * taken from free list of its size class, freed block goes back to the list,
+ * so matrices of the same size are made again and again without upstream.
+ * Lists are filled by slabs from upstream, release() returns all of them.
+ * Bigger blocks and alignment over 64 go to upstream directly.
+ */
+class SizeClassPool : public std::pmr::memory_resource
+{
+public:
+    using size_type = std::size_t;
+    static constexpr size_type min_block = 64;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct Slab
+    {
+        std::byte* data;
+        size_type size;
+    };
+
+    std::pmr::memory_resource* upstream_;
+    size_type max_block_, slab_size_;
+    std::vector<FreeBlock*> free_;  // free list for every size class
+    std::vector<Slab> slabs_;
+
+    static size_type class_of(size_type bytes) noexcept
+    {
+        return std::bit_width(std::bit_ceil(std::max(bytes, min_block)) / min_block) - 1;
+    }
+
+    static size_type block_size(size_type cls) noexcept {return min_block << cls;}
+
+    void add_slab(size_type cls)
+    {
+        auto block = block_size(cls);
+        auto size  = std::max(slab_size_ / block, size_type{1}) * block;
+
+        slabs_.reserve(slabs_.size() + 1);
+        auto data = static_cast<std::byte*>(upstream_->allocate(size, min_block));
+        slabs_.push_back({data, size});
+
+        for (auto ptr = data + size; ptr != data;)
+        {
+            ptr -= block;
+            free_[cls] = ::new (ptr) FreeBlock {free_[cls]};
+        }
+    }
+
+protected:
+    void* do_allocate(size_type bytes, size_type align) override
+    {
+        if (bytes > max_block_ || align > min_block)
+            return upstream_->allocate(bytes, align);
+
+        auto cls = class_of(bytes);
+        if (!free_[cls])
+            add_slab(cls);
+        auto block = free_[cls];
+        free_[cls] = block->next;
+        return block;
+    }
+
+    void do_deallocate(void* ptr, size_type bytes, size_type align) override
+    {
+        if (bytes > max_block_ || align > min_block)
+            return upstream_->deallocate(ptr, bytes, align);
+
+        auto cls = class_of(bytes);
+        free_[cls] = ::new (ptr) FreeBlock {free_[cls]};
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {return this == &other;}
+
+public:
+    // max_block is rounded up to power of two
+    explicit SizeClassPool(size_type max_block = 256 * 1024, size_type slab_size = 64 * 1024,
+                           std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+    :upstream_ {upstream}, max_block_ {std::bit_ceil(std::max(max_block, min_block))}, slab_size_ {slab_size},
+     free_ (class_of(max_block_) + 1, nullptr)
+    {}
+
+    SizeClassPool(const SizeClassPool&) = delete;
+    SizeClassPool& operator=(const SizeClassPool&) = delete;
+
+    ~SizeClassPool() {release();}
+
+    // gives slabs back to upstream, matrices from pool must be destroyed before
+    void release() noexcept
+    {
+        for (auto& slab: slabs_)
+            upstream_->deallocate(slab.data, slab.size, min_block);
+        slabs_.clear();
+        std::fill(free_.begin(), free_.end(), nullptr);
+    }
+
+    size_type max_block() const noexcept {return max_block_;}
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {return upstream_;}
+};
+
+} // namespace Matrix
@@ -0,0 +1,585 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+#include "matrix_instrument.hpp"
+#include "matrix_thread_pool.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Montgomery arithmetic modulo odd p < 2^31: x is kept as x * 2^32 mod p, so   |
+ * product needs two multiplications and one shift instead of division:         |
+ *     reduce(t) = (t + (t * (-p^-1) mod 2^32) * p) / 2^32 = t * 2^-32 mod p    |
+ * t < p^2 and result < 2p fit into 64 and 32 bits. Constants are computed      |
+ * once per prime (at compile time for ModInt<P>).                              |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+struct Montgomery32
+{
+    std::uint32_t mod;
+    std::uint32_t neg_inv;  // -mod^-1 mod 2^32
+    std::uint32_t r2;       // 2^64 mod mod
+
+    static constexpr std::uint32_t inverse_pow2(std::uint32_t p)
+    {
+        // p * p = 1 mod 8, every Newton step doubles number of correct bits: 3 -> 48
+        std::uint32_t x = p;
+        for (int i = 0; i < 4; i++)
+            x *= 2 - p * x;
+        return x;
+    }
+
+    constexpr explicit Montgomery32(std::uint32_t p)
+    :mod {p}, neg_inv {0u - inverse_pow2(p)}, r2 {static_cast<std::uint32_t>((~std::uint64_t{0} % p + 1) % p)}
+    {}
+
+    constexpr std::uint32_t reduce(std::uint64_t t) const
+    {
+        std::uint32_t m = static_cast<std::uint32_t>(t) * neg_inv;
+        auto res = static_cast<std::uint32_t>((t + std::uint64_t{m} * mod) >> 32);
+        return res >= mod ? res - mod : res;
+    }
+
+    // x < mod
+    constexpr std::uint32_t to(std::uint32_t x) const {return reduce(std::uint64_t{x} * r2);}
+    constexpr std::uint32_t from(std::uint32_t x) const {return reduce(x);}
+    constexpr std::uint32_t one() const {return to(1);}
+
+    constexpr std::uint32_t mul(std::uint32_t lhs, std::uint32_t rhs) const {return reduce(std::uint64_t{lhs} * rhs);}
+    constexpr std::uint32_t add(std::uint32_t lhs, std::uint32_t rhs) const
+    {
+        std::uint32_t res = lhs + rhs;
+        return res >= mod ? res - mod : res;
+    }
+    constexpr std::uint32_t sub(std::uint32_t lhs, std::uint32_t rhs) const {return lhs >= rhs ? lhs - rhs : lhs + mod - rhs;}
+
+    constexpr std::uint32_t pow(std::uint32_t base, std::uint64_t exp) const
+    {
+        std::uint32_t res = one();
+        for (; exp; exp >>= 1)
+        {
+            if (exp & 1)
+                res = mul(res, base);
+            base = mul(base, base);
+        }
+        return res;
+    }
+
+    // Fermat: x^(p - 2) = x^-1 for x != 0
+    constexpr std::uint32_t inverse(std::uint32_t x) const {return pow(x, mod - 2);}
+
+    // residue of any integer, not in Montgomery form
+    template<std::integral I>
+    constexpr std::uint32_t residue(I val) const
+    {
+        if constexpr (std::is_signed_v<I>)
+        {
+            auto res = static_cast<long long>(val) % static_cast<long long>(mod);
+            return static_cast<std::uint32_t>(res < 0 ? res + mod : res);
+        }
+        else
+            return static_cast<std::uint32_t>(static_cast<unsigned long long>(val) % mod);
+    }
+};
+
+// deterministic Miller-Rabin: bases 2, 7, 61 are enough for all n < 2^32
+constexpr bool is_prime_u32(std::uint32_t n)
+{
+    if (n < 2)
+        return false;
+    for (std::uint32_t p: {2u, 3u, 5u, 7u, 61u})
+        if (n % p == 0)
+            return n == p;
+
+    std::uint32_t d = n - 1;
+    int s = 0;
+    for (; d % 2 == 0; s++)
+        d /= 2;
+
+    for (std::uint64_t a: {2u, 7u, 61u})
+    {
+        std::uint64_t x = 1, base = a;
+        for (auto e = d; e; e >>= 1)
+        {
+            if (e & 1)
+                x = x * base % n;
+            base = base * base % n;
+        }
+        if (x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (int r = 1; r < s && composite; r++)
+        {
+            x = x * x % n;
+            composite = x != n - 1;
+        }
+        if (composite)
+            return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Element of field Z / P for prime P < 2^31 in Montgomery form. Division is    |
+ * arithmetical correct, so MatrixArithmetic<ModInt<P>, true> gets Gauss        |
+ * determinant, LU inverse and solve modulo P without rounding and overflow.    |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<std::uint32_t P>
+class ModInt
+{
+    static_assert(P % 2 == 1 && P < (1u << 31) && detail::is_prime_u32(P), "ModInt needs odd prime modulus below 2^31");
+
+    static constexpr detail::Montgomery32 mont {P};
+    std::uint32_t val_ = 0;
+
+    struct raw_t {};
+    constexpr ModInt(raw_t, std::uint32_t val): val_ {val} {}
+
+public:
+    static constexpr std::uint32_t modulus() {return P;}
+
+    constexpr ModInt() = default;
+
+    template<std::integral I>
+    constexpr ModInt(I val)
+    :val_ {mont.to(mont.residue(val))}
+    {}
+
+    // representative in [0, P)
+    constexpr std::uint32_t value() const {return mont.from(val_);}
+
+    constexpr ModInt pow(std::uint64_t exp) const {return {raw_t{}, mont.pow(val_, exp)};}
+
+    constexpr ModInt inverse() const
+    {
+        if (val_ == 0)
+            throw std::invalid_argument{"try to get inverse of zero modulo P"};
+        return {raw_t{}, mont.inverse(val_)};
+    }
+
+    constexpr ModInt& operator+=(const ModInt& rhs) {val_ = mont.add(val_, rhs.val_); return *this;}
+    constexpr ModInt& operator-=(const ModInt& rhs) {val_ = mont.sub(val_, rhs.val_); return *this;}
+    constexpr ModInt& operator*=(const ModInt& rhs) {val_ = mont.mul(val_, rhs.val_); return *this;}
+    constexpr ModInt& operator/=(const ModInt& rhs) {return *this *= rhs.inverse();}
+
+    constexpr ModInt operator-() const {return {raw_t{}, mont.sub(0, val_)};}
+
+    friend constexpr ModInt operator+(ModInt lhs, const ModInt& rhs) {return lhs += rhs;}
+    friend constexpr ModInt operator-(ModInt lhs, const ModInt& rhs) {return lhs -= rhs;}
+    friend constexpr ModInt operator*(ModInt lhs, const ModInt& rhs) {return lhs *= rhs;}
+    friend constexpr ModInt operator/(ModInt lhs, const ModInt& rhs) {return lhs /= rhs;}
+
+    // Montgomery form is one to one, so it is compared as is
+    friend constexpr bool operator==(const ModInt& lhs, const ModInt& rhs) {return lhs.val_ == rhs.val_;}
+
+    friend std::ostream& operator<<(std::ostream& os, const ModInt& rhs) {return os << rhs.value();}
+};
+
+namespace detail
+{
+// field has no order: pivot search of Gauss and LU takes the first nonzero element
+template<std::uint32_t P>
+struct DefaultAbs<ModInt<P>>
+{
+    int operator()(const ModInt<P>& arg) const {return arg == ModInt<P>{} ? 0 : 1;}
+};
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Multi-modular exact determinant of integer matrix:                           |
+ *   1. Hadamard bound |det A| <= H = min(prod of row norms, prod of column     |
+ *      norms) gives number of primes: their product M must exceed 2H;          |
+ *   2. det A mod p is found by Gauss elimination in Montgomery arithmetic      |
+ *      for primes just below 2^31, primes are split between threads;           |
+ *   3. Garner's algorithm turns residues to mixed radix digits, they give      |
+ *      det A mod M in [0, M), M - it is taken when it is closer to zero.       |
+ * Nothing grows during elimination, so int matrix doesnt overflow and work is  |
+ * O(n^3 * log H / 31) word operations.                                         |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+
+// count primes below 2^31 from the largest one down
+inline std::vector<std::uint32_t> modular_primes(std::size_t count)
+{
+    std::vector<std::uint32_t> res;
+    res.reserve(count);
+    for (std::uint32_t n = (1u << 31) - 1; res.size() < count && n > 2; n -= 2)
+        if (is_prime_u32(n))
+            res.push_back(n);
+    return res;
+}
+
+// rank of integer matrix is maximum of its ranks modulo this number of primes
+inline constexpr std::size_t modular_rank_primes = 3;
+
+// h x w elements of mat modulo p in Montgomery form, row after row
+template<typename M>
+std::vector<std::uint32_t> reduce_modulo(const M& mat, const Montgomery32& mont)
+{
+    const std::size_t h = mat.height(), w = mat.width();
+    std::vector<std::uint32_t> res (h * w);
+    for (std::size_t i = 0; i < h; i++)
+    {
+        const auto* row = mat[i].data();
+        for (std::size_t j = 0; j < w; j++)
+            res[i * w + j] = mont.to(mont.residue(row[j]));
+    }
+    return res;
+}
+
+// row[j] -= coef * pivot_row[j] modulo p, 32 x 32 -> 64 bit products of the loop are vectorized;
+// mont is taken by value, so stores to row cant change its constants
+[[gnu::always_inline]] inline void submul_modulo(std::uint32_t* row, const std::uint32_t* pivot_row, std::uint32_t coef,
+                                                 std::size_t n, Montgomery32 mont)
+{
+    for (std::size_t j = 0; j < n; j++)
+        row[j] = mont.sub(row[j], mont.mul(coef, pivot_row[j]));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx512f"))) inline void submul_modulo_avx512(std::uint32_t* row, const std::uint32_t* pivot_row, std::uint32_t coef,
+                                                                   std::size_t n, Montgomery32 mont)
+{
+    submul_modulo(row, pivot_row, coef, n, mont);
+}
+
+__attribute__((target("avx2"))) inline void submul_modulo_avx2(std::uint32_t* row, const std::uint32_t* pivot_row, std::uint32_t coef,
+                                                               std::size_t n, Montgomery32 mont)
+{
+    submul_modulo(row, pivot_row, coef, n, mont);
+}
+#endif
+
+/*
+ * Row echelon form of h x w matrix modulo p, a is destroyed. Returns rank and
+ * product of pivots with sign of row exchanges (not in Montgomery form), which
+ * is determinant when matrix is square and has full rank.
+ */
+inline std::pair<std::size_t, std::uint32_t> echelon_modulo(std::uint32_t* a, std::size_t h, std::size_t w, const Montgomery32& mont)
+{
+    const auto level = simd_level();
+    std::size_t rank = 0;
+    std::uint32_t det = mont.one();
+    bool negative = false;
+    for (std::size_t col = 0; col < w && rank < h; col++)
+    {
+        std::size_t piv = rank;
+        while (piv < h && a[piv * w + col] == 0)
+            piv++;
+        if (piv == h)
+        {
+            det = 0;
+            continue;
+        }
+        if (piv != rank)
+        {
+            std::swap_ranges(a + piv * w + col, a + piv * w + w, a + rank * w + col);
+            negative = !negative;
+        }
+
+        const std::uint32_t* pivot_row = a + rank * w;
+        det = mont.mul(det, pivot_row[col]);
+        const std::uint32_t inv = mont.inverse(pivot_row[col]);
+        for (std::size_t i = rank + 1; i < h; i++)
+        {
+            std::uint32_t* row = a + i * w;
+            if (row[col] == 0)
+                continue;
+            const std::uint32_t coef = mont.mul(row[col], inv);
+            auto* dst = row + col + 1;
+            const auto* src = pivot_row + col + 1;
+            switch (level)
+            {
+#if defined(__x86_64__) || defined(__i386__)
+                case SimdLevel::avx512: submul_modulo_avx512(dst, src, coef, w - col - 1, mont); break;
+                case SimdLevel::avx2:   submul_modulo_avx2(dst, src, coef, w - col - 1, mont); break;
+#endif
+                default: submul_modulo(dst, src, coef, w - col - 1, mont); break;
+            }
+            row[col] = 0;
+        }
+        rank++;
+    }
+
+    std::uint32_t res = mont.from(det);
+    return {rank, negative && res != 0 ? mont.mod - res : res};
+}
+
+// log2 of Hadamard bound, -infinity for zero row or column
+template<typename M>
+long double hadamard_log2(const M& mat)
+{
+    const std::size_t n = mat.height();
+    std::vector<long double> col_norms (n);
+    long double rows_log = 0, cols_log = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        long double row_norm = 0;
+        for (std::size_t j = 0; j < n; j++)
+        {
+            auto elem = static_cast<long double>(mat.to(i, j));
+            row_norm += elem * elem;
+            col_norms[j] += elem * elem;
+        }
+        rows_log += std::log2(row_norm) / 2;
+    }
+    for (auto norm: col_norms)
+        cols_log += std::log2(norm) / 2;
+    return std::min(rows_log, cols_log);
+}
+
+// little-endian base 2^32 digits of natural number, no leading zeros
+using Limbs = std::vector<std::uint32_t>;
+
+inline void limbs_mul_add(Limbs& x, std::uint32_t mul, std::uint32_t add)
+{
+    std::uint64_t carry = add;
+    for (auto& limb: x)
+    {
+        carry += std::uint64_t{limb} * mul;
+        limb = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    if (carry)
+        x.push_back(static_cast<std::uint32_t>(carry));
+}
+
+inline bool limbs_less(const Limbs& lhs, const Limbs& rhs)
+{
+    if (lhs.size() != rhs.size())
+        return lhs.size() < rhs.size();
+    return std::lexicographical_compare(lhs.rbegin(), lhs.rend(), rhs.rbegin(), rhs.rend());
+}
+
+// lhs - rhs for lhs >= rhs
+inline Limbs limbs_sub(Limbs lhs, const Limbs& rhs)
+{
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < lhs.size(); i++)
+    {
+        std::int64_t diff = std::int64_t{lhs[i]} - borrow - (i < rhs.size() ? std::int64_t{rhs[i]} : 0);
+        borrow = diff < 0;
+        lhs[i] = static_cast<std::uint32_t>(diff + (borrow << 32));
+    }
+    while (!lhs.empty() && lhs.back() == 0)
+        lhs.pop_back();
+    return lhs;
+}
+
+// x /= div, returns remainder
+inline std::uint32_t limbs_div(Limbs& x, std::uint32_t div)
+{
+    std::uint64_t rem = 0;
+    for (auto it = x.rbegin(); it != x.rend(); ++it)
+    {
+        std::uint64_t cur = (rem << 32) | *it;
+        *it = static_cast<std::uint32_t>(cur / div);
+        rem = cur % div;
+    }
+    while (!x.empty() && x.back() == 0)
+        x.pop_back();
+    return static_cast<std::uint32_t>(rem);
+}
+
+} // namespace detail
+
+// exact integer of any size restored from residues, result of modular_determinant
+class ExactDeterminant
+{
+    bool negative_ = false;
+    detail::Limbs magnitude_;
+    std::size_t primes_ = 0;
+
+public:
+    ExactDeterminant() = default;
+
+    template<std::integral I>
+    explicit ExactDeterminant(I val)
+    :negative_ {val < 0}
+    {
+        unsigned long long magnitude = val < 0 ? 0ull - static_cast<unsigned long long>(val) : static_cast<unsigned long long>(val);
+        for (; magnitude; magnitude >>= 32)
+            magnitude_.push_back(static_cast<std::uint32_t>(magnitude));
+    }
+
+    // Garner's algorithm: residues[i] = x mod primes[i], result is x in (-M / 2, M / 2]
+    static ExactDeterminant from_residues(const std::vector<std::uint32_t>& residues, const std::vector<std::uint32_t>& primes)
+    {
+        const std::size_t k = primes.size();
+        std::vector<std::uint32_t> digits (k);
+        for (std::size_t i = 0; i < k; i++)
+        {
+            detail::Montgomery32 mont {primes[i]};
+            // value of known digits and product of previous primes modulo primes[i]
+            std::uint32_t known = 0, radix = mont.one();
+            for (std::size_t j = i; j-- > 0;)
+                known = mont.add(mont.mul(known, mont.to(primes[j] % primes[i])), mont.to(digits[j]));
+            for (std::size_t j = 0; j < i; j++)
+                radix = mont.mul(radix, mont.to(primes[j] % primes[i]));
+            auto diff = mont.sub(mont.to(residues[i]), known);
+            digits[i] = mont.from(mont.mul(diff, mont.inverse(radix)));
+        }
+
+        detail::Limbs value, modulus {1};
+        for (std::size_t i = k; i-- > 0;)
+        {
+            detail::limbs_mul_add(value, primes[i], digits[i]);
+            detail::limbs_mul_add(modulus, primes[i], 0);
+        }
+        while (!value.empty() && value.back() == 0)
+            value.pop_back();
+
+        ExactDeterminant res;
+        res.primes_ = k;
+        auto complement = detail::limbs_sub(modulus, value);
+        if (detail::limbs_less(complement, value))
+        {
+            res.negative_ = true;
+            res.magnitude_ = std::move(complement);
+        }
+        else
+            res.magnitude_ = std::move(value);
+        return res;
+    }
+
+    bool is_zero() const {return magnitude_.empty();}
+    int sign() const {return is_zero() ? 0 : negative_ ? -1 : 1;}
+
+    // number of primes determinant was computed modulo
+    std::size_t primes() const {return primes_;}
+
+    // value in integral type, throws when it doesnt fit
+    template<std::integral I>
+    I to() const requires (!std::same_as<I, bool>)
+    {
+        unsigned long long magnitude = 0;
+        if (magnitude_.size() > 2)
+            throw std::overflow_error{"try to convert determinant that doesnt fit into type"};
+        for (std::size_t i = magnitude_.size(); i-- > 0;)
+            magnitude = (magnitude << 32) | magnitude_[i];
+
+        using U = std::make_unsigned_t<I>;
+        const auto max = static_cast<unsigned long long>(std::numeric_limits<I>::max());
+        if (negative_)
+        {
+            if (!std::is_signed_v<I> || magnitude > max + 1)
+                throw std::overflow_error{"try to convert determinant that doesnt fit into type"};
+            return static_cast<I>(U{0} - static_cast<U>(magnitude));
+        }
+        if (magnitude > max)
+            throw std::overflow_error{"try to convert determinant that doesnt fit into type"};
+        return static_cast<I>(magnitude);
+    }
+
+    double to_double() const
+    {
+        long double res = 0;
+        for (std::size_t i = magnitude_.size(); i-- > 0;)
+            res = res * 4294967296.0L + magnitude_[i];
+        return static_cast<double>(negative_ ? -res : res);
+    }
+
+    std::string to_string() const
+    {
+        if (is_zero())
+            return "0";
+
+        // digits by groups of 9 from the lowest one
+        auto rest = magnitude_;
+        std::vector<std::uint32_t> groups;
+        while (!rest.empty())
+            groups.push_back(detail::limbs_div(rest, 1000000000));
+
+        std::string res = negative_ ? "-" : "";
+        res += std::to_string(groups.back());
+        for (std::size_t i = groups.size() - 1; i-- > 0;)
+        {
+            auto group = std::to_string(groups[i]);
+            res.append(9 - group.size(), '0');
+            res += group;
+        }
+        return res;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const ExactDeterminant& rhs) {return os << rhs.to_string();}
+};
+
+/*
+ * Exact determinant of matrix of integers of any size, no intermediate value
+ * overflows. Primes are computed on threads of pool.
+ */
+template<std::integral T, bool IsDivArithm, class Cmp, class Abs>
+ExactDeterminant modular_determinant(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat, ThreadPool& pool = default_pool())
+{
+    if (!mat.is_square())
+        throw std::invalid_argument{"try to get determinant() of no square matrix"};
+
+    const std::size_t n = mat.height();
+    if (n == 0)
+        return ExactDeterminant{1};
+
+    auto bound = detail::hadamard_log2(mat);
+    if (std::isinf(bound))
+        return ExactDeterminant{0};
+
+    // sum of log2 of primes > log2(H) + 1, one more prime covers rounding of bound
+    std::size_t count = static_cast<std::size_t>(std::ceil((bound + 1) / 30.99L)) + 1;
+    auto primes = detail::modular_primes(count);
+
+    detail::OperationScope scope {Operation::determinant, n, count * detail::lu_flops(n)};
+    std::vector<std::uint32_t> residues (count);
+    pool.parallel_for(0, count, 1, [&mat, &primes, &residues, n](std::size_t lo, std::size_t hi)
+    {
+        for (std::size_t i = lo; i < hi; i++)
+        {
+            detail::Montgomery32 mont {primes[i]};
+            auto reduced = detail::reduce_modulo(mat, mont);
+            residues[i] = detail::echelon_modulo(reduced.data(), n, n, mont).second;
+        }
+    });
+    return ExactDeterminant::from_residues(residues, primes);
+}
+
+/*
+ * Rank of matrix of integers: rank modulo p is not greater than rank over rationals
+ * and is less only when p divides all its nonzero minors of maximal size, so maximum
+ * over modular_rank_primes large primes is wrong only for such specially made matrix.
+ */
+template<std::integral T, bool IsDivArithm, class Cmp, class Abs>
+std::size_t modular_rank(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& mat, ThreadPool& pool = default_pool())
+{
+    const std::size_t h = mat.height(), w = mat.width();
+    auto primes = detail::modular_primes(detail::modular_rank_primes);
+    std::vector<std::size_t> ranks (primes.size());
+    pool.parallel_for(0, primes.size(), 1, [&mat, &primes, &ranks, h, w](std::size_t lo, std::size_t hi)
+    {
+        for (std::size_t i = lo; i < hi; i++)
+        {
+            detail::Montgomery32 mont {primes[i]};
+            auto reduced = detail::reduce_modulo(mat, mont);
+            ranks[i] = detail::echelon_modulo(reduced.data(), h, w, mont).first;
+        }
+    });
+    return *std::max_element(ranks.begin(), ranks.end());
+}
+
+} // namespace Matrix
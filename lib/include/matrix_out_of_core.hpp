@@ -0,0 +1,551 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "matrix_arithmetic.hpp"
+#include "matrix_lu.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * LU decomposition of matrix that lives in file. Matrix is cut into tiles of   |
+ * tile_size x tile_size, tiles of one tile column make one strip: N x tile     |
+ * elements stored contiguously, so strip is read and written by one call.      |
+ * Elimination is right-looking by strips: strip of panel k is factorized with |
+ * partial pivoting, then every strip j > k is read, rows are swapped,          |
+ * U_kj = L_kk^-1 * A_kj, A_ij -= L_ik * U_kj by GEMM kernel, and strip is     |
+ * written back. Next strip is read by async read while current one is         |
+ * updated, so only three strips are in memory: working_set() bytes.          |
+ *                                                                              |
+ * Header of file keeps progress, so work stopped after factorize(max_strips)  |
+ * or by crash continues from the same place after OutOfCoreLU(path). In       |
+ * durable mode every strip goes to journal and is synced before it is copied |
+ * to its place, so half written strip is never left in tiles.               |
+ *                                                                              |
+ * Pivots are applied to strips right of panel only, L of earlier panels keeps |
+ * order of rows of its own step (like product of elementary matrices), solve |
+ * applies pivots and L panel by panel in the same order.                     |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+namespace detail
+{
+struct OutOfCoreHeader
+{
+    static constexpr char magic_value[8] = {'M', 'T', 'R', 'X', 'O', 'O', 'C', '\0'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint64_t none = static_cast<std::uint64_t>(-1);
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t elem_size;
+    std::uint64_t size;             // N of matrix, strips are padded by identity to multiple of tile
+    std::uint64_t tile;
+    std::uint64_t panel;            // strips before it are factorized
+    std::uint64_t column;           // strips before it are updated by panel, column == panel: panel is not factorized
+    std::uint64_t journal_column;   // journal keeps strip for this column of current panel, none if it is empty
+    std::byte reserved[8];
+};
+
+static_assert(sizeof(OutOfCoreHeader) == 64);
+
+inline void pread_all(int fd, void* data, std::size_t bytes, std::uint64_t offset)
+{
+    auto ptr = static_cast<char*>(data);
+    while (bytes)
+    {
+        auto got = ::pread(fd, ptr, bytes, static_cast<off_t>(offset));
+        if (got <= 0)
+            throw std::runtime_error{"cant read tiles of out-of-core matrix"};
+        ptr += got;
+        bytes -= static_cast<std::size_t>(got);
+        offset += static_cast<std::uint64_t>(got);
+    }
+}
+
+inline void pwrite_all(int fd, const void* data, std::size_t bytes, std::uint64_t offset)
+{
+    auto ptr = static_cast<const char*>(data);
+    while (bytes)
+    {
+        auto put = ::pwrite(fd, ptr, bytes, static_cast<off_t>(offset));
+        if (put <= 0)
+            throw std::runtime_error{"cant write tiles of out-of-core matrix"};
+        ptr += put;
+        bytes -= static_cast<std::size_t>(put);
+        offset += static_cast<std::uint64_t>(put);
+    }
+}
+} // namespace detail
+
+template<std::floating_point T = double>
+class OutOfCoreLU
+{
+    static_assert(detail::is_blocked_lu_available<T>, "out-of-core LU needs GEMM kernel for type of elements");
+
+public:
+    using size_type   = std::size_t;
+    using value_type  = T;
+    using matrix_type = MatrixArithmetic<T, true>;
+
+    static constexpr size_type default_tile = 256;
+
+private:
+    static constexpr std::uint64_t page = 4096;
+
+    int fd_ = -1;
+    bool durable_ = true;
+    detail::OutOfCoreHeader header_ {};
+    size_type padded_ = 0, strips_ = 0;
+    std::uint64_t pivots_offset_ = 0, journal_offset_ = 0, tiles_offset_ = 0;
+
+    static std::uint64_t round_up(std::uint64_t val, std::uint64_t align) {return (val + align - 1) / align * align;}
+
+    size_type strip_elems() const {return padded_ * header_.tile;}
+    size_type strip_bytes() const {return strip_elems() * sizeof(T);}
+    std::uint64_t strip_offset(size_type j) const {return tiles_offset_ + j * strip_bytes();}
+
+    void layout()
+    {
+        auto tile = header_.tile;
+        padded_ = round_up(header_.size, tile);
+        strips_ = padded_ / tile;
+        pivots_offset_  = page;
+        journal_offset_ = round_up(pivots_offset_ + padded_ * sizeof(std::uint64_t), page);
+        tiles_offset_   = round_up(journal_offset_ + tile * sizeof(std::uint64_t) + strip_bytes(), page);
+    }
+
+    void sync() const
+    {
+        if (durable_ && ::fdatasync(fd_) != 0)
+            throw std::runtime_error{"cant sync tiles of out-of-core matrix"};
+    }
+
+    void write_header() const {detail::pwrite_all(fd_, &header_, sizeof(header_), 0);}
+
+    void read_strip(size_type j, std::vector<T>& strip) const
+    {
+        strip.resize(strip_elems());
+        detail::pread_all(fd_, strip.data(), strip_bytes(), strip_offset(j));
+    }
+
+    // pivots of panel k: rows of strip exchanged with rows k * tile, k * tile + 1 ...
+    std::vector<std::uint64_t> read_pivots(size_type k) const
+    {
+        std::vector<std::uint64_t> pivots (header_.tile);
+        detail::pread_all(fd_, pivots.data(), pivots.size() * sizeof(std::uint64_t),
+                          pivots_offset_ + k * header_.tile * sizeof(std::uint64_t));
+        return pivots;
+    }
+
+    void place(size_type j, const std::vector<T>& strip, const std::vector<std::uint64_t>* pivots) const
+    {
+        detail::pwrite_all(fd_, strip.data(), strip_bytes(), strip_offset(j));
+        if (pivots)
+            detail::pwrite_all(fd_, pivots->data(), pivots->size() * sizeof(std::uint64_t),
+                               pivots_offset_ + header_.panel * header_.tile * sizeof(std::uint64_t));
+    }
+
+    void advance()
+    {
+        if (++header_.column == strips_)
+            header_.column = ++header_.panel;
+    }
+
+    // strip j of current panel is done: through journal in durable mode, then progress goes forward
+    void commit(size_type j, const std::vector<T>& strip, const std::vector<std::uint64_t>* pivots)
+    {
+        if (durable_)
+        {
+            if (pivots)
+                detail::pwrite_all(fd_, pivots->data(), pivots->size() * sizeof(std::uint64_t), journal_offset_);
+            detail::pwrite_all(fd_, strip.data(), strip_bytes(), journal_offset_ + header_.tile * sizeof(std::uint64_t));
+            sync();
+            header_.journal_column = j;
+            write_header();
+            sync();
+        }
+
+        place(j, strip, pivots);
+        sync();
+        header_.journal_column = detail::OutOfCoreHeader::none;
+        advance();
+        write_header();
+        sync();
+    }
+
+    // strip of crashed commit is copied again from journal
+    void replay_journal()
+    {
+        if (header_.journal_column == detail::OutOfCoreHeader::none)
+            return;
+
+        std::vector<T> strip (strip_elems());
+        detail::pread_all(fd_, strip.data(), strip_bytes(), journal_offset_ + header_.tile * sizeof(std::uint64_t));
+        if (header_.journal_column == header_.panel)
+        {
+            std::vector<std::uint64_t> pivots (header_.tile);
+            detail::pread_all(fd_, pivots.data(), pivots.size() * sizeof(std::uint64_t), journal_offset_);
+            place(header_.journal_column, strip, &pivots);
+        }
+        else
+            place(header_.journal_column, strip, nullptr);
+        sync();
+
+        header_.journal_column = detail::OutOfCoreHeader::none;
+        advance();
+        write_header();
+        sync();
+    }
+
+    // panel strip: padded_ x tile, row r of strip is row r of matrix
+    void factorize_panel(std::vector<T>& strip, std::vector<std::uint64_t>& pivots, ThreadPool& pool) const
+    {
+        auto tile = header_.tile;
+        auto k0 = header_.panel * tile;
+        auto threads = pool.num_threads();
+        pivots.resize(tile);
+
+        for (size_type c = 0; c < tile; c++)
+        {
+            auto k = k0 + c;
+            auto piv = k;
+            for (auto i = k + 1; i < padded_; i++)
+                if (std::abs(strip[i * tile + c]) > std::abs(strip[piv * tile + c]))
+                    piv = i;
+            pivots[c] = piv;
+            if (piv != k)
+                std::swap_ranges(strip.begin() + k * tile, strip.begin() + (k + 1) * tile, strip.begin() + piv * tile);
+
+            const T pivot = strip[k * tile + c];
+            if (pivot == T{})
+                continue;
+
+            auto eliminate = [&strip, tile, k, c, pivot](size_type lo, size_type hi)
+            {
+                const T* pivot_row = strip.data() + k * tile;
+                for (auto i = lo; i < hi; i++)
+                {
+                    T* row = strip.data() + i * tile;
+                    T coef = row[c] / pivot;
+                    row[c] = coef;
+                    for (auto j = c + 1; j < tile; j++)
+                        row[j] -= coef * pivot_row[j];
+                }
+            };
+
+            if ((padded_ - k) * tile >= detail::lu_parallel_panel)
+                pool.parallel_for(k + 1, padded_, std::max<size_type>((padded_ - k) / threads, detail::lu_min_grain), eliminate);
+            else
+                eliminate(k + 1, padded_);
+        }
+    }
+
+    void update_strip(const std::vector<T>& panel, const std::vector<std::uint64_t>& pivots, std::vector<T>& strip,
+                      ThreadPool& pool) const
+    {
+        auto tile = header_.tile;
+        auto k0 = header_.panel * tile;
+        auto k_end = k0 + tile;
+        auto threads = pool.num_threads();
+
+        for (size_type c = 0; c < tile; c++)
+            if (pivots[c] != k0 + c)
+                std::swap_ranges(strip.begin() + (k0 + c) * tile, strip.begin() + (k0 + c + 1) * tile, strip.begin() + pivots[c] * tile);
+
+        // U_kj = L_kk^-1 * A_kj
+        for (size_type c = 0; c < tile; c++)
+            for (auto i = k0 + c + 1; i < k_end; i++)
+            {
+                T coef = -panel[i * tile + c];
+                detail::elementwise<detail::ElementwiseOp::axpy>(strip.data() + i * tile, strip.data() + (k0 + c) * tile, coef, tile);
+            }
+
+        // A_ij -= L_ik * U_kj
+        auto rest = padded_ - k_end;
+        auto update = [&panel, &strip, tile, k0, k_end](size_type lo, size_type hi)
+        {
+            detail::gemm<T>(hi - lo, tile, tile,
+                            [&panel, tile, k_end, lo](size_type i) {return panel.data() + (k_end + lo + i) * tile;},
+                            [&strip, tile, k0](size_type p) {return static_cast<const T*>(strip.data() + (k0 + p) * tile);},
+                            [&strip, tile, k_end, lo](size_type i) {return strip.data() + (k_end + lo + i) * tile;},
+                            T{-1});
+        };
+        pool.parallel_for(0, rest, std::max<size_type>((rest + 2 * threads - 1) / (2 * threads), detail::lu_min_grain), update);
+    }
+
+    void check_finished() const
+    {
+        if (!is_finished())
+            throw std::invalid_argument{"try to use out-of-core LU before factorize() is finished"};
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    /*
+     * Writes tiles of mat (matrix or view, e.g. view of MappedMatrix, so file bigger
+     * than memory is read by pages) to new file path, tile rows of mat are read one by one.
+     */
+    template<typename M>
+    OutOfCoreLU(const std::string& path, const M& mat, size_type tile = default_tile, bool durable = true) requires requires {mat.to(0, 0);}
+    :durable_ {durable}
+    {
+        if (!mat.is_square())
+            throw std::invalid_argument{"try to make LU decomposition of no square matrix"};
+        if (tile == 0)
+            throw std::invalid_argument{"tile of out-of-core matrix must be positive"};
+
+        std::memcpy(header_.magic, detail::OutOfCoreHeader::magic_value, sizeof(header_.magic));
+        header_.version = detail::OutOfCoreHeader::current_version;
+        header_.elem_size = sizeof(T);
+        header_.size = mat.height();
+        header_.tile = tile;
+        header_.panel = header_.column = 0;
+        header_.journal_column = detail::OutOfCoreHeader::none;
+        layout();
+
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0)
+            throw std::runtime_error{"cant create file of out-of-core matrix " + path};
+
+        try
+        {
+            if (::ftruncate(fd_, static_cast<off_t>(strip_offset(strips_))) != 0)
+                throw std::runtime_error{"cant resize file of out-of-core matrix " + path};
+
+            // tile row goes to its rows in all strips, padding is identity
+            std::vector<T> tiles (tile * padded_);
+            for (size_type ti = 0; ti < strips_; ti++)
+            {
+                std::fill(tiles.begin(), tiles.end(), T{});
+                for (size_type r = 0; r < tile; r++)
+                {
+                    auto i = ti * tile + r;
+                    for (size_type j = 0; j < padded_; j++)
+                        tiles[(j / tile) * tile * tile + r * tile + j % tile] =
+                            i < header_.size && j < header_.size ? static_cast<T>(mat.to(i, j)) : T(i == j);
+                }
+                for (size_type tj = 0; tj < strips_; tj++)
+                    detail::pwrite_all(fd_, tiles.data() + tj * tile * tile, tile * tile * sizeof(T),
+                                       strip_offset(tj) + ti * tile * tile * sizeof(T));
+            }
+            write_header();
+            sync();
+        }
+        catch (...)
+        {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    // opens file of started or finished factorization
+    explicit OutOfCoreLU(const std::string& path, bool durable = true)
+    :durable_ {durable}
+    {
+        fd_ = ::open(path.c_str(), O_RDWR);
+        if (fd_ < 0)
+            throw std::runtime_error{"cant open file of out-of-core matrix " + path};
+
+        try
+        {
+            detail::pread_all(fd_, &header_, sizeof(header_), 0);
+            if (std::memcmp(header_.magic, detail::OutOfCoreHeader::magic_value, sizeof(header_.magic)) != 0 ||
+                header_.version != detail::OutOfCoreHeader::current_version)
+                throw std::runtime_error{"file is not file of out-of-core matrix " + path};
+            if (header_.elem_size != sizeof(T))
+                throw std::runtime_error{"type of elements in out-of-core file differs from OutOfCoreLU"};
+            layout();
+            replay_journal();
+        }
+        catch (...)
+        {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    OutOfCoreLU(const OutOfCoreLU&) = delete;
+    OutOfCoreLU& operator=(const OutOfCoreLU&) = delete;
+
+    OutOfCoreLU(OutOfCoreLU&& rhs) noexcept
+    :fd_ {std::exchange(rhs.fd_, -1)}, durable_ {rhs.durable_}, header_ {rhs.header_}, padded_ {rhs.padded_},
+     strips_ {rhs.strips_}, pivots_offset_ {rhs.pivots_offset_}, journal_offset_ {rhs.journal_offset_},
+     tiles_offset_ {rhs.tiles_offset_}
+    {}
+
+    OutOfCoreLU& operator=(OutOfCoreLU&&) = delete;
+
+    ~OutOfCoreLU()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Factors start |=---------------------------------------------------
+    size_type size() const {return header_.size;}
+    size_type tile_size() const {return header_.tile;}
+    size_type tiles() const {return strips_;}
+
+    bool is_finished() const {return header_.panel >= strips_;}
+
+    // number of strips already factorized or updated, of tiles() * (tiles() + 1) / 2
+    size_type progress() const
+    {
+        size_type done = 0;
+        for (size_type k = 0; k < header_.panel; k++)
+            done += strips_ - k;
+        return done + (is_finished() ? 0 : header_.column - header_.panel);
+    }
+
+    // memory taken by factorize(): panel, current strip and strip read ahead
+    size_type working_set() const {return 3 * strip_bytes();}
+
+    // tile (i, j) of factors: L with unit diagonal below diagonal, U on and above it
+    matrix_type tile(size_type i, size_type j) const
+    {
+        if (i >= strips_ || j >= strips_)
+            throw std::out_of_range{"try to get tile of out-of-core matrix with index out of range"};
+
+        auto tile = header_.tile;
+        std::vector<T> data (tile * tile);
+        detail::pread_all(fd_, data.data(), data.size() * sizeof(T), strip_offset(j) + i * tile * tile * sizeof(T));
+        return matrix_type::square(tile, data.cbegin(), data.cend());
+    }
+//--------------------------------=| Factors end |=-----------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    // does at most max_strips strips, returns true when factorization is finished
+    bool factorize(size_type max_strips = static_cast<size_type>(-1), ThreadPool& pool = default_pool())
+    {
+        std::vector<T> panel, current, next;
+        std::vector<std::uint64_t> pivots;
+        size_type loaded_panel = strips_;
+
+        for (size_type done = 0; !is_finished() && done < max_strips;)
+        {
+            auto k = header_.panel;
+            if (header_.column == k)
+            {
+                read_strip(k, panel);
+                factorize_panel(panel, pivots, pool);
+                commit(k, panel, &pivots);
+                loaded_panel = k;
+                done++;
+                continue;
+            }
+
+            if (loaded_panel != k)
+            {
+                read_strip(k, panel);
+                pivots = read_pivots(k);
+                loaded_panel = k;
+            }
+
+            // strips of this panel go one by one, next one is read while current is updated
+            read_strip(header_.column, current);
+            for (; header_.column < strips_ && done < max_strips; done++)
+            {
+                auto j = header_.column;
+                std::future<void> ahead;
+                if (j + 1 < strips_ && done + 1 < max_strips)
+                    ahead = std::async(std::launch::async, [this, j, &next] {read_strip(j + 1, next);});
+
+                update_strip(panel, pivots, current, pool);
+                commit(j, current, nullptr);
+
+                if (!ahead.valid())
+                {
+                    done++;
+                    break;
+                }
+                ahead.get();
+                std::swap(current, next);
+            }
+        }
+        return is_finished();
+    }
+
+    value_type determinant() const
+    {
+        check_finished();
+
+        auto tile = header_.tile;
+        value_type res {1};
+        std::vector<T> block (tile * tile);
+        for (size_type k = 0; k < strips_; k++)
+        {
+            detail::pread_all(fd_, block.data(), block.size() * sizeof(T), strip_offset(k) + k * tile * tile * sizeof(T));
+            auto pivots = read_pivots(k);
+            for (size_type c = 0; c < tile; c++)
+            {
+                res *= block[c * tile + c];
+                if (pivots[c] != k * tile + c)
+                    res = -res;
+            }
+        }
+        return res;
+    }
+
+    // strips are read one by one, so only rhs and one strip are in memory
+    std::vector<value_type> solve(const std::vector<value_type>& rhs) const
+    {
+        check_finished();
+        if (rhs.size() != size())
+            throw std::invalid_argument{"in solve: lhs.height() != rhs.height()"};
+
+        auto tile = header_.tile;
+        std::vector<T> x (padded_, T{}), strip;
+        std::copy(rhs.begin(), rhs.end(), x.begin());
+
+        // L: panel by panel in the same order as in factorize, rows inside panel are swapped all before elimination
+        for (size_type k = 0; k < strips_; k++)
+        {
+            read_strip(k, strip);
+            auto pivots = read_pivots(k);
+            auto k0 = k * tile;
+            for (size_type c = 0; c < tile; c++)
+                std::swap(x[k0 + c], x[pivots[c]]);
+            for (size_type c = 0; c < tile; c++)
+            {
+                for (auto i = k0 + c + 1; i < padded_; i++)
+                    x[i] -= strip[i * tile + c] * x[k0 + c];
+            }
+        }
+
+        // U: strip j gives column block j of U
+        for (auto j = strips_; j-- > 0;)
+        {
+            read_strip(j, strip);
+            auto j0 = j * tile;
+            for (auto c = tile; c-- > 0;)
+            {
+                auto diag = strip[(j0 + c) * tile + c];
+                if (diag == T{})
+                    throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+                x[j0 + c] /= diag;
+                for (size_type i = 0; i < j0 + c; i++)
+                    x[i] -= strip[i * tile + c] * x[j0 + c];
+            }
+        }
+
+        x.resize(size());
+        return x;
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class OutOfCoreLU
+
+} // namespace Matrix
@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Element-wise kernels over one contiguous range, f.e. one row of matrix.      |
+ * Loop body is written once with GCC vector extensions and instantiated for    |
+ * 16, 32 and 64 byte vectors, x86 builds pick widest one supported by CPU     |
+ * at runtime, so binary built without -march flags still uses AVX2/AVX-512.   |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T>
+concept is_simd_available = std::is_same_v<T, float> || std::is_same_v<T, double> ||
+                            (std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8));
+
+enum class ElementwiseOp
+{
+    add,  // dst += src
+    sub,  // dst -= src
+    neg,  // dst  = -src
+    mul,  // dst *= alpha
+    div,  // dst /= alpha
+    axpy  // dst += alpha * src
+};
+
+enum class SimdLevel
+{
+    sse2,
+    avx2,
+    avx512
+};
+
+inline SimdLevel simd_level()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const SimdLevel level = []
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return SimdLevel::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return SimdLevel::avx2;
+        return SimdLevel::sse2;
+    }();
+    return level;
+#else
+    return SimdLevel::sse2;
+#endif
+}
+
+template<ElementwiseOp Op>
+inline constexpr bool reads_src = Op == ElementwiseOp::add || Op == ElementwiseOp::sub ||
+                                  Op == ElementwiseOp::neg || Op == ElementwiseOp::axpy;
+
+// works both for scalars and for vectors of scalars, result goes to dst by reference
+// because passing wide vectors by value depends on enabled instruction set
+template<ElementwiseOp Op, typename V, typename T>
+[[gnu::always_inline]] inline void apply_op(V& dst, const V& src, const T& alpha)
+{
+    if constexpr (Op == ElementwiseOp::add)
+        dst += src;
+    else if constexpr (Op == ElementwiseOp::sub)
+        dst -= src;
+    else if constexpr (Op == ElementwiseOp::neg)
+        dst = -src;
+    else if constexpr (Op == ElementwiseOp::mul)
+        dst *= alpha;
+    else if constexpr (Op == ElementwiseOp::div)
+        dst /= alpha;
+    else
+        dst += alpha * src;
+}
+
+template<std::size_t Bytes, ElementwiseOp Op, typename T>
+[[gnu::always_inline]] inline void elementwise_loop(T* dst, const T* src, T alpha, std::size_t n)
+{
+    typedef T vec __attribute__((vector_size(Bytes)));
+    constexpr std::size_t vl = Bytes / sizeof(T);
+
+    std::size_t i = 0;
+    for (; i + vl <= n; i += vl)
+    {
+        vec dst_vec {}, src_vec {};
+        if constexpr (Op != ElementwiseOp::neg)
+            std::memcpy(&dst_vec, dst + i, Bytes);
+        if constexpr (reads_src<Op>)
+            std::memcpy(&src_vec, src + i, Bytes);
+        apply_op<Op>(dst_vec, src_vec, alpha);
+        std::memcpy(dst + i, &dst_vec, Bytes);
+    }
+
+    for (; i < n; i++)
+    {
+        T src_elem = reads_src<Op> ? src[i] : T{};
+        apply_op<Op>(dst[i], src_elem, alpha);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template<ElementwiseOp Op, typename T>
+__attribute__((target("avx512f"))) void elementwise_avx512(T* dst, const T* src, T alpha, std::size_t n)
+{
+    elementwise_loop<64, Op>(dst, src, alpha, n);
+}
+
+template<ElementwiseOp Op, typename T>
+__attribute__((target("avx2"))) void elementwise_avx2(T* dst, const T* src, T alpha, std::size_t n)
+{
+    elementwise_loop<32, Op>(dst, src, alpha, n);
+}
+#endif
+
+template<ElementwiseOp Op, typename T>
+void elementwise(T* dst, const T* src, T alpha, std::size_t n) requires is_simd_available<T>
+{
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level())
+    {
+        case SimdLevel::avx512: return elementwise_avx512<Op>(dst, src, alpha, n);
+        case SimdLevel::avx2:   return elementwise_avx2<Op>(dst, src, alpha, n);
+        default: break;
+    }
+#endif
+    elementwise_loop<16, Op>(dst, src, alpha, n);
+}
+
+// same for element of any type, used by algorithms that work with custom types too
+template<ElementwiseOp Op, typename T>
+void elementwise(T* dst, const T* src, const T& alpha, std::size_t n) requires (!is_simd_available<T>)
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        T src_elem = reads_src<Op> ? src[i] : T{};
+        apply_op<Op>(dst[i], src_elem, alpha);
+    }
+}
+
+} // namespace detail
+} // namespace Matrix
@@ -0,0 +1,595 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Sparse matrices: only nonzero elements are stored. SparseBuilder collects    |
+ * (i, j, value) triplets in any order (COO), BasicSparseMatrix keeps them      |
+ * compressed: CSR (by rows) or CSC (by columns). For CSR offsets()[i] ...      |
+ * offsets()[i + 1] are positions of row i in indices() (columns, ascending)    |
+ * and values(), for CSC the same with rows and columns exchanged.              |
+ *                                                                              |
+ * Template parameters after order mean the same as in MatrixArithmetic: Cmp   |
+ * finds zeros that are not stored and compares elements, dense matrices of    |
+ * the same parameters are made by to_dense() and taken by ctor.                |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+enum class SparseOrder
+{
+    row,  // CSR
+    col   // CSC
+};
+
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class SparseBuilder
+{
+public:
+    using size_type  = std::size_t;
+    using value_type = T;
+
+private:
+    size_type height_ = 0, width_ = 0;
+    std::vector<size_type> rows_, cols_;
+    std::vector<value_type> values_;
+
+public:
+    SparseBuilder(size_type h, size_type w)
+    :height_ {h}, width_ {w}
+    {}
+
+    void reserve(size_type nnz)
+    {
+        rows_.reserve(nnz);
+        cols_.reserve(nnz);
+        values_.reserve(nnz);
+    }
+
+    // elements with the same (i, j) are summed
+    void add(size_type i, size_type j, const value_type& val)
+    {
+        if (i >= height_ || j >= width_)
+            throw std::out_of_range{"try to add element of sparse matrix with index out of range"};
+        rows_.push_back(i);
+        cols_.push_back(j);
+        values_.push_back(val);
+    }
+
+    size_type height() const {return height_;}
+    size_type width()  const {return width_;}
+    size_type size()   const {return values_.size();}
+
+    std::span<const size_type>  rows()   const {return rows_;}
+    std::span<const size_type>  cols()   const {return cols_;}
+    std::span<const value_type> values() const {return values_;}
+};
+
+namespace detail
+{
+// rows of CSR product or SpMV for one chunk of parallel_for
+inline constexpr std::size_t sparse_min_grain = 256;
+
+template<typename T>
+struct CompressedArrays
+{
+    std::vector<std::size_t> offsets, indices;
+    std::vector<T> values;
+};
+
+template<typename T>
+struct CompressedView
+{
+    const std::size_t* offsets;
+    const std::size_t* indices;
+    const T* values;
+};
+
+/*
+ * The same elements compressed by other index (counting sort): CSR of A is
+ * CSC of A^T, so this is transposition and change of order at once. Outer
+ * indices go in ascending order, so indices of result are sorted.
+ */
+template<typename T>
+CompressedArrays<T> compressed_transpose(std::size_t outer_dim, std::size_t inner_dim, CompressedView<T> src)
+{
+    auto nnz = src.offsets[outer_dim];
+    CompressedArrays<T> res {std::vector<std::size_t>(inner_dim + 1, 0), std::vector<std::size_t>(nnz), std::vector<T>(nnz)};
+
+    for (std::size_t p = 0; p < nnz; p++)
+        res.offsets[src.indices[p] + 1]++;
+    std::partial_sum(res.offsets.begin(), res.offsets.end(), res.offsets.begin());
+
+    std::vector<std::size_t> next (res.offsets.begin(), res.offsets.end() - 1);
+    for (std::size_t outer = 0; outer < outer_dim; outer++)
+        for (auto p = src.offsets[outer]; p < src.offsets[outer + 1]; p++)
+        {
+            auto q = next[src.indices[p]]++;
+            res.indices[q] = outer;
+            res.values[q]  = src.values[p];
+        }
+    return res;
+}
+
+// Gustavson: row i of C is sum of rows of B with weights from row i of A, rows are counted first, then filled
+template<typename T>
+CompressedArrays<T> compressed_product(std::size_t a_outer, std::size_t b_inner, CompressedView<T> a, CompressedView<T> b,
+                                       ThreadPool& pool)
+{
+    constexpr auto none = static_cast<std::size_t>(-1);
+    auto grain = std::max((a_outer + 4 * pool.num_threads() - 1) / (4 * pool.num_threads()), sparse_min_grain);
+
+    CompressedArrays<T> res;
+    res.offsets.assign(a_outer + 1, 0);
+    pool.parallel_for(0, a_outer, grain, [&](std::size_t first, std::size_t last)
+    {
+        std::vector<std::size_t> marker (b_inner, none);
+        for (auto i = first; i < last; i++)
+        {
+            std::size_t count = 0;
+            for (auto p = a.offsets[i]; p < a.offsets[i + 1]; p++)
+            {
+                auto k = a.indices[p];
+                for (auto q = b.offsets[k]; q < b.offsets[k + 1]; q++)
+                    if (marker[b.indices[q]] != i)
+                    {
+                        marker[b.indices[q]] = i;
+                        count++;
+                    }
+            }
+            res.offsets[i + 1] = count;
+        }
+    });
+    std::partial_sum(res.offsets.begin(), res.offsets.end(), res.offsets.begin());
+
+    res.indices.resize(res.offsets[a_outer]);
+    res.values.resize(res.offsets[a_outer]);
+    pool.parallel_for(0, a_outer, grain, [&](std::size_t first, std::size_t last)
+    {
+        std::vector<std::size_t> marker (b_inner, none);
+        std::vector<T> acc (b_inner);
+        for (auto i = first; i < last; i++)
+        {
+            auto row_begin = res.indices.begin() + res.offsets[i];
+            auto row_end = row_begin;
+            for (auto p = a.offsets[i]; p < a.offsets[i + 1]; p++)
+            {
+                auto k = a.indices[p];
+                for (auto q = b.offsets[k]; q < b.offsets[k + 1]; q++)
+                {
+                    auto j = b.indices[q];
+                    if (marker[j] != i)
+                    {
+                        marker[j] = i;
+                        acc[j] = a.values[p] * b.values[q];
+                        *row_end++ = j;
+                    }
+                    else
+                        acc[j] += a.values[p] * b.values[q];
+                }
+            }
+
+            std::sort(row_begin, row_end);
+            for (auto pos = res.offsets[i]; pos < res.offsets[i + 1]; pos++)
+                res.values[pos] = acc[res.indices[pos]];
+        }
+    });
+    return res;
+}
+} // namespace detail
+
+template<SparseOrder Order, typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class BasicSparseMatrix
+{
+public:
+    using size_type    = std::size_t;
+    using value_type   = T;
+    using dense_type   = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+    using builder_type = SparseBuilder<T, IsDivArithm, Cmp, Abs>;
+
+    static constexpr SparseOrder order = Order;
+    static constexpr bool is_div_arithmetical = IsDivArithm;
+
+private:
+    template<SparseOrder, typename, bool, class, class> friend class BasicSparseMatrix;
+
+    size_type height_ = 0, width_ = 0;
+    std::vector<size_type> offsets_ = std::vector<size_type>(1, 0);
+    std::vector<size_type> indices_;
+    std::vector<value_type> values_;
+    Cmp cmp {};
+
+    static constexpr bool is_csr = Order == SparseOrder::row;
+
+    BasicSparseMatrix(size_type h, size_type w, detail::CompressedArrays<value_type>&& arrays)
+    :height_ {h}, width_ {w}, offsets_ {std::move(arrays.offsets)}, indices_ {std::move(arrays.indices)},
+     values_ {std::move(arrays.values)}
+    {}
+
+    // sums neighbour elements with the same index, drops zeros, indices must be sorted
+    void compact()
+    {
+        size_type pos = 0, begin = 0;
+        for (size_type outer = 0; outer < outer_dim(); outer++)
+        {
+            auto end = offsets_[outer + 1];
+            for (auto p = begin; p < end;)
+            {
+                auto val = values_[p];
+                auto q = p + 1;
+                for (; q < end && indices_[q] == indices_[p]; q++)
+                    val += values_[q];
+                if (!cmp(val, value_type{}))
+                {
+                    indices_[pos] = indices_[p];
+                    values_[pos++] = std::move(val);
+                }
+                p = q;
+            }
+            begin = end;
+            offsets_[outer + 1] = pos;
+        }
+        indices_.resize(pos);
+        values_.resize(pos);
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    BasicSparseMatrix() = default;
+
+    // zero matrix
+    BasicSparseMatrix(size_type h, size_type w)
+    :height_ {h}, width_ {w}, offsets_ ((is_csr ? h : w) + 1, 0)
+    {}
+
+    // ready compressed arrays, indices in each row (column for CSC) must be ascending
+    BasicSparseMatrix(size_type h, size_type w, std::vector<size_type> offsets, std::vector<size_type> indices,
+                      std::vector<value_type> values)
+    :height_ {h}, width_ {w}, offsets_ {std::move(offsets)}, indices_ {std::move(indices)}, values_ {std::move(values)}
+    {
+        if (offsets_.size() != outer_dim() + 1 || offsets_.front() != 0 || offsets_.back() != indices_.size() ||
+            indices_.size() != values_.size())
+            throw std::invalid_argument{"wrong sizes of compressed arrays of sparse matrix"};
+
+        for (size_type outer = 0; outer < outer_dim(); outer++)
+        {
+            if (offsets_[outer] > offsets_[outer + 1])
+                throw std::invalid_argument{"offsets of sparse matrix are not ascending"};
+            for (auto p = offsets_[outer]; p < offsets_[outer + 1]; p++)
+                if (indices_[p] >= inner_dim() || (p > offsets_[outer] && indices_[p] <= indices_[p - 1]))
+                    throw std::invalid_argument{"indices of sparse matrix are out of range or not ascending"};
+        }
+    }
+
+    explicit BasicSparseMatrix(const builder_type& builder)
+    :height_ {builder.height()}, width_ {builder.width()}
+    {
+        // compressed by inner index first, then transposition sorts elements by outer and inner indices
+        auto outer = is_csr ? builder.rows() : builder.cols();
+        auto inner = is_csr ? builder.cols() : builder.rows();
+
+        std::vector<size_type> by_inner_offsets (inner_dim() + 1, 0);
+        for (auto idx: inner)
+            by_inner_offsets[idx + 1]++;
+        std::partial_sum(by_inner_offsets.begin(), by_inner_offsets.end(), by_inner_offsets.begin());
+
+        std::vector<size_type> by_inner_indices (builder.size());
+        std::vector<value_type> by_inner_values (builder.size());
+        std::vector<size_type> next (by_inner_offsets.begin(), by_inner_offsets.end() - 1);
+        for (size_type p = 0; p < builder.size(); p++)
+        {
+            auto q = next[inner[p]]++;
+            by_inner_indices[q] = outer[p];
+            by_inner_values[q]  = builder.values()[p];
+        }
+
+        auto arrays = detail::compressed_transpose<value_type>(inner_dim(), outer_dim(),
+                          {by_inner_offsets.data(), by_inner_indices.data(), by_inner_values.data()});
+        offsets_ = std::move(arrays.offsets);
+        indices_ = std::move(arrays.indices);
+        values_  = std::move(arrays.values);
+        compact();
+    }
+
+    explicit BasicSparseMatrix(const MatrixContainer<value_type>& dense)
+    :height_ {dense.height()}, width_ {dense.width()}, offsets_ (outer_dim() + 1, 0)
+    {
+        for (size_type outer = 0; outer < outer_dim(); outer++)
+        {
+            for (size_type inner = 0; inner < inner_dim(); inner++)
+            {
+                const auto& elem = is_csr ? dense.to(outer, inner) : dense.to(inner, outer);
+                if (!cmp(elem, value_type{}))
+                {
+                    indices_.push_back(inner);
+                    values_.push_back(elem);
+                }
+            }
+            offsets_[outer + 1] = indices_.size();
+        }
+    }
+
+    // CSR <-> CSC
+    template<SparseOrder OtherOrder> requires (OtherOrder != Order)
+    explicit BasicSparseMatrix(const BasicSparseMatrix<OtherOrder, T, IsDivArithm, Cmp, Abs>& rhs)
+    :BasicSparseMatrix(rhs.height(), rhs.width(), detail::compressed_transpose(rhs.outer_dim(), rhs.inner_dim(), rhs.view()))
+    {}
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Acces start |=-----------------------------------------------------
+    size_type height() const {return height_;}
+    size_type width()  const {return width_;}
+    size_type nnz()    const {return values_.size();}
+
+    bool is_square() const {return height_ == width_;}
+
+    // number of rows for CSR, of columns for CSC
+    size_type outer_dim() const {return is_csr ? height_ : width_;}
+    size_type inner_dim() const {return is_csr ? width_ : height_;}
+
+    std::span<const size_type>  offsets() const {return offsets_;}
+    std::span<const size_type>  indices() const {return indices_;}
+    std::span<const value_type> values()  const {return values_;}
+    std::span<value_type>       values()        {return values_;}
+
+    detail::CompressedView<value_type> view() const {return {offsets_.data(), indices_.data(), values_.data()};}
+
+    // value_type{} for elements that are not stored
+    value_type at(size_type i, size_type j) const
+    {
+        if (i >= height_ || j >= width_)
+            throw std::out_of_range{"try to get element of sparse matrix with index out of range"};
+
+        auto outer = is_csr ? i : j, inner = is_csr ? j : i;
+        auto begin = indices_.begin() + offsets_[outer], end = indices_.begin() + offsets_[outer + 1];
+        auto it = std::lower_bound(begin, end, inner);
+        if (it == end || *it != inner)
+            return value_type{};
+        return values_[it - indices_.begin()];
+    }
+
+    dense_type to_dense() const
+    {
+        dense_type res (height_, width_);
+        for (size_type outer = 0; outer < outer_dim(); outer++)
+            for (auto p = offsets_[outer]; p < offsets_[outer + 1]; p++)
+                (is_csr ? res.to(outer, indices_[p]) : res.to(indices_[p], outer)) = values_[p];
+        return res;
+    }
+//--------------------------------=| Acces end |=-------------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    BasicSparseMatrix transpos() const
+    {
+        return BasicSparseMatrix(width_, height_, detail::compressed_transpose(outer_dim(), inner_dim(), view()));
+    }
+
+    /*
+     * y = (*this) * x, x has width() elements, y has height() elements.
+     * CSR rows are shared between threads, CSC columns go to partial sums of threads,
+     * they are kept in workspace: it only grows, so loop that gives the same one to every
+     * product allocates once. Without workspace it lives only for one call.
+     */
+    void multiply(const value_type* x, value_type* y, ThreadPool& pool = default_pool()) const
+    {
+        std::vector<value_type> workspace;
+        multiply(x, y, workspace, pool);
+    }
+
+    void multiply(const value_type* x, value_type* y, std::vector<value_type>& workspace, ThreadPool& pool = default_pool()) const
+    {
+        auto threads = pool.num_threads();
+        auto grain = std::max((outer_dim() + 4 * threads - 1) / (4 * threads), detail::sparse_min_grain);
+
+        if constexpr (is_csr)
+            pool.parallel_for(0, height_, grain, [&](size_type first, size_type last)
+            {
+                for (auto i = first; i < last; i++)
+                {
+                    value_type sum {};
+                    for (auto p = offsets_[i]; p < offsets_[i + 1]; p++)
+                        sum += values_[p] * x[indices_[p]];
+                    y[i] = sum;
+                }
+            });
+        else
+        {
+            std::fill(y, y + height_, value_type{});
+            auto chunks = std::min(threads, (width_ + detail::sparse_min_grain - 1) / detail::sparse_min_grain);
+            if (chunks <= 1)
+            {
+                for (size_type j = 0; j < width_; j++)
+                    for (auto p = offsets_[j]; p < offsets_[j + 1]; p++)
+                        y[indices_[p]] += values_[p] * x[j];
+                return;
+            }
+
+            if (workspace.size() < chunks * height_)
+                workspace.resize(chunks * height_);
+            value_type* partial = workspace.data();
+
+            auto cols = (width_ + chunks - 1) / chunks;
+            pool.parallel_for(0, chunks, 1, [&](size_type first, size_type last)
+            {
+                for (auto chunk = first; chunk < last; chunk++)
+                {
+                    auto part = partial + chunk * height_;
+                    std::fill(part, part + height_, value_type{});
+                    for (auto j = chunk * cols; j < std::min(width_, (chunk + 1) * cols); j++)
+                        for (auto p = offsets_[j]; p < offsets_[j + 1]; p++)
+                            part[indices_[p]] += values_[p] * x[j];
+                }
+            });
+            pool.parallel_for(0, height_, std::max(height_ / threads, detail::sparse_min_grain), [&](size_type first, size_type last)
+            {
+                for (size_type chunk = 0; chunk < chunks; chunk++)
+                    for (auto i = first; i < last; i++)
+                        y[i] += partial[chunk * height_ + i];
+            });
+        }
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+
+//--------------------------------=| Compare start |=---------------------------------------------------
+    // elements that are not stored are zeros
+    bool equal_to(const BasicSparseMatrix& rhs) const
+    {
+        if (height_ != rhs.height_ || width_ != rhs.width_)
+            return false;
+
+        for (size_type outer = 0; outer < outer_dim(); outer++)
+        {
+            auto p = offsets_[outer], q = rhs.offsets_[outer];
+            auto p_end = offsets_[outer + 1], q_end = rhs.offsets_[outer + 1];
+            while (p < p_end || q < q_end)
+            {
+                if (q == q_end || (p < p_end && indices_[p] < rhs.indices_[q]))
+                {
+                    if (!cmp(values_[p++], value_type{}))
+                        return false;
+                }
+                else if (p == p_end || rhs.indices_[q] < indices_[p])
+                {
+                    if (!cmp(rhs.values_[q++], value_type{}))
+                        return false;
+                }
+                else if (!cmp(values_[p++], rhs.values_[q++]))
+                    return false;
+            }
+        }
+        return true;
+    }
+//--------------------------------=| Compare end |=-----------------------------------------------------
+
+//--------------------------------=| Basic arithmetic start |=------------------------------------------
+    BasicSparseMatrix& operator*=(const value_type& rhs)
+    {
+        for (auto& val: values_)
+            val *= rhs;
+        return *this;
+    }
+
+    BasicSparseMatrix& operator/=(const value_type& rhs)
+    {
+        for (auto& val: values_)
+            val /= rhs;
+        return *this;
+    }
+//--------------------------------=| Basic arithmetic end |=--------------------------------------------
+}; // class BasicSparseMatrix
+
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+using CSRMatrix = BasicSparseMatrix<SparseOrder::row, T, IsDivArithm, Cmp, Abs>;
+
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+using CSCMatrix = BasicSparseMatrix<SparseOrder::col, T, IsDivArithm, Cmp, Abs>;
+
+//--------------------------------=| Wrappers arounf methods start |=-----------------------------------
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> transpos(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat)
+{
+    return mat.transpos();
+}
+//--------------------------------=| Wrappers arounf methods end |=-------------------------------------
+
+//--------------------------------=| Arrithmetical operators start |=-----------------------------------
+// sparse matrix * vector
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+std::vector<T> product(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& lhs, const std::vector<T>& rhs,
+                       ThreadPool& pool = default_pool())
+{
+    if (lhs.width() != rhs.size())
+        throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+
+    std::vector<T> res (lhs.height());
+    lhs.multiply(rhs.data(), res.data(), pool);
+    return res;
+}
+
+// sparse matrix * dense matrix: row i of result is sum of rows of rhs by element-wise axpy
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> product(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& lhs,
+                                                   const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs,
+                                                   ThreadPool& pool = default_pool())
+{
+    if constexpr (Order == SparseOrder::col)
+        return product(CSRMatrix<T, IsDivArithm, Cmp, Abs>(lhs), rhs, pool);
+    else
+    {
+        if (lhs.width() != rhs.height())
+            throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+
+        MatrixArithmetic<T, IsDivArithm, Cmp, Abs> res (lhs.height(), rhs.width());
+        auto offsets = lhs.offsets();
+        auto indices = lhs.indices();
+        auto values  = lhs.values();
+        auto grain = std::max((lhs.height() + 4 * pool.num_threads() - 1) / (4 * pool.num_threads()), detail::sparse_min_grain);
+        pool.parallel_for(0, lhs.height(), grain, [&](std::size_t first, std::size_t last)
+        {
+            for (auto i = first; i < last; i++)
+                for (auto p = offsets[i]; p < offsets[i + 1]; p++)
+                    detail::elementwise<detail::ElementwiseOp::axpy>(res[i].data(), rhs[indices[p]].data(), values[p], rhs.width());
+        });
+        return res;
+    }
+}
+
+// sparse * sparse, both CSR or both CSC (C^T = B^T * A^T for CSC), elements that cancel out stay stored
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> product(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& lhs,
+                                                           const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& rhs,
+                                                           ThreadPool& pool = default_pool())
+{
+    if (lhs.width() != rhs.height())
+        throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+
+    auto arrays = Order == SparseOrder::row ? detail::compressed_product(lhs.height(), rhs.width(), lhs.view(), rhs.view(), pool)
+                                            : detail::compressed_product(rhs.width(), lhs.height(), rhs.view(), lhs.view(), pool);
+    return {lhs.height(), rhs.width(), std::move(arrays.offsets), std::move(arrays.indices), std::move(arrays.values)};
+}
+
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+bool operator==(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& lhs, const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs.equal_to(rhs);
+}
+
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+bool operator!=(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& lhs, const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> operator*(BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> lhs,
+                                                             const std::type_identity_t<T>& rhs)
+{
+    return lhs *= rhs;
+}
+
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> operator*(const std::type_identity_t<T>& lhs,
+                                                             BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> rhs)
+{
+    return rhs *= lhs;
+}
+
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> operator/(BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> lhs,
+                                                             const std::type_identity_t<T>& rhs)
+{
+    return lhs /= rhs;
+}
+//--------------------------------=| Arrithmetical operators end |=-------------------------------------
+
+} // namespace Matrix
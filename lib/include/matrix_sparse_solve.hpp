@@ -0,0 +1,1081 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "matrix_sparse.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Solvers of sparse systems A * x = b, A never becomes dense.                  |
+ *                                                                              |
+ * Direct: SparseLU (any regular matrix, partial pivoting) and SparseCholesky  |
+ * (symmetric positive definite), both reorder A by reverse Cuthill-McKee      |
+ * first, so factors keep close to band of A and fill stays small.             |
+ *                                                                              |
+ * Iterative: conjugate_gradient (symmetric positive definite), bicgstab and  |
+ * gmres (any regular matrix) with JacobiPreconditioner or ILU0Preconditioner. |
+ * x is initial guess and answer, SolverReport tells if tolerance was reached,|
+ * number of iterations and time.                                              |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+enum class SparseOrdering
+{
+    natural,
+    rcm     // reverse Cuthill-McKee
+};
+
+//--------------------------------=| Ordering start |=--------------------------------------------------
+// max |i - j| over stored elements
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+std::size_t bandwidth(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat)
+{
+    std::size_t res = 0;
+    auto offsets = mat.offsets();
+    auto indices = mat.indices();
+    for (std::size_t outer = 0; outer < mat.outer_dim(); outer++)
+        for (auto p = offsets[outer]; p < offsets[outer + 1]; p++)
+            res = std::max(res, indices[p] > outer ? indices[p] - outer : outer - indices[p]);
+    return res;
+}
+
+/*
+ * perm[k] is old index of row and column k. Graph is pattern of A + A^T,
+ * every connected part starts from pseudo-peripheral vertex (end of longest
+ * found breadth-first search), neighbours are visited by ascending degree.
+ */
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+std::vector<std::size_t> reverse_cuthill_mckee(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat)
+{
+    if (!mat.is_square())
+        throw std::invalid_argument{"try to make reverse Cuthill-McKee ordering of no square matrix"};
+
+    auto n = mat.height();
+    auto transposed = detail::compressed_transpose(n, n, mat.view());
+
+    // adjacency lists: merge of sorted outer lists of A and A^T without diagonal
+    std::vector<std::size_t> adj_offsets (n + 1, 0), adj;
+    adj.reserve(2 * mat.nnz());
+    auto offsets = mat.offsets();
+    auto indices = mat.indices();
+    for (std::size_t v = 0; v < n; v++)
+    {
+        auto p = offsets[v], p_end = offsets[v + 1];
+        auto q = transposed.offsets[v], q_end = transposed.offsets[v + 1];
+        while (p < p_end || q < q_end)
+        {
+            std::size_t u;
+            if (q == q_end || (p < p_end && indices[p] < transposed.indices[q]))
+                u = indices[p++];
+            else if (p == p_end || transposed.indices[q] < indices[p])
+                u = transposed.indices[q++];
+            else
+            {
+                u = indices[p++];
+                q++;
+            }
+            if (u != v)
+                adj.push_back(u);
+        }
+        adj_offsets[v + 1] = adj.size();
+    }
+
+    auto degree = [&](std::size_t v) {return adj_offsets[v + 1] - adj_offsets[v];};
+
+    std::vector<std::size_t> perm;
+    perm.reserve(n);
+    std::vector<bool> visited (n, false);
+    std::vector<std::size_t> level (n), seen (n, 0);
+    std::size_t stamp = 0;
+
+    // breadth-first search from start without touching visited, returns vertex of last level with minimal degree and depth
+    auto eccentricity = [&](std::size_t start)
+    {
+        std::vector<std::size_t> queue {start};
+        seen[start] = ++stamp;
+        level[start] = 0;
+        for (std::size_t head = 0; head < queue.size(); head++)
+            for (auto p = adj_offsets[queue[head]]; p < adj_offsets[queue[head] + 1]; p++)
+                if (seen[adj[p]] != stamp)
+                {
+                    seen[adj[p]] = stamp;
+                    level[adj[p]] = level[queue[head]] + 1;
+                    queue.push_back(adj[p]);
+                }
+
+        auto depth = level[queue.back()];
+        auto far = queue.back();
+        for (auto v: queue)
+            if (level[v] == depth && degree(v) < degree(far))
+                far = v;
+        return std::pair {far, depth};
+    };
+
+    for (std::size_t root = 0; root < n; root++)
+    {
+        if (visited[root])
+            continue;
+
+        auto start = root;
+        auto [far, depth] = eccentricity(start);
+        for (;;)
+        {
+            auto [next_far, next_depth] = eccentricity(far);
+            if (next_depth <= depth)
+                break;
+            start = far;
+            far = next_far;
+            depth = next_depth;
+        }
+        if (degree(far) < degree(start))
+            start = far;
+
+        auto first = perm.size();
+        perm.push_back(start);
+        visited[start] = true;
+        for (auto head = first; head < perm.size(); head++)
+        {
+            auto level_begin = perm.size();
+            for (auto p = adj_offsets[perm[head]]; p < adj_offsets[perm[head] + 1]; p++)
+                if (!visited[adj[p]])
+                {
+                    visited[adj[p]] = true;
+                    perm.push_back(adj[p]);
+                }
+            std::stable_sort(perm.begin() + level_begin, perm.end(), [&](auto lhs, auto rhs) {return degree(lhs) < degree(rhs);});
+        }
+    }
+
+    std::reverse(perm.begin(), perm.end());
+    return perm;
+}
+
+// P * A * P^T: element (k, l) of result is mat(perm[k], perm[l])
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs> permute(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat,
+                                                           const std::vector<std::size_t>& perm)
+{
+    if (!mat.is_square() || perm.size() != mat.height())
+        throw std::invalid_argument{"in permute: wrong size of permutation"};
+
+    auto n = mat.height();
+    std::vector<std::size_t> inv (n, n);
+    for (std::size_t k = 0; k < n; k++)
+    {
+        if (perm[k] >= n || inv[perm[k]] != n)
+            throw std::invalid_argument{"in permute: perm is not permutation"};
+        inv[perm[k]] = k;
+    }
+
+    // outer lists are moved, inner indices renamed, then two transpositions sort them
+    auto offsets = mat.offsets();
+    auto indices = mat.indices();
+    auto values  = mat.values();
+    detail::CompressedArrays<T> moved {std::vector<std::size_t>(n + 1, 0), {}, {}};
+    moved.indices.reserve(mat.nnz());
+    moved.values.reserve(mat.nnz());
+    for (std::size_t k = 0; k < n; k++)
+    {
+        for (auto p = offsets[perm[k]]; p < offsets[perm[k] + 1]; p++)
+        {
+            moved.indices.push_back(inv[indices[p]]);
+            moved.values.push_back(values[p]);
+        }
+        moved.offsets[k + 1] = moved.indices.size();
+    }
+
+    auto once  = detail::compressed_transpose<T>(n, n, {moved.offsets.data(), moved.indices.data(), moved.values.data()});
+    auto twice = detail::compressed_transpose<T>(n, n, {once.offsets.data(), once.indices.data(), once.values.data()});
+    return {n, n, std::move(twice.offsets), std::move(twice.indices), std::move(twice.values)};
+}
+//--------------------------------=| Ordering end |=----------------------------------------------------
+
+namespace detail
+{
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+CSCMatrix<T, IsDivArithm, Cmp, Abs> ordered_csc(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat,
+                                                SparseOrdering ordering, std::vector<std::size_t>& perm)
+{
+    perm.resize(mat.height());
+    if (ordering == SparseOrdering::natural)
+    {
+        for (std::size_t k = 0; k < perm.size(); k++)
+            perm[k] = k;
+        if constexpr (Order == SparseOrder::col)
+            return mat;
+        else
+            return CSCMatrix<T, IsDivArithm, Cmp, Abs>(mat);
+    }
+
+    perm = reverse_cuthill_mckee(mat);
+    if constexpr (Order == SparseOrder::col)
+        return permute(mat, perm);
+    else
+        return CSCMatrix<T, IsDivArithm, Cmp, Abs>(permute(mat, perm));
+}
+
+// same for symmetric matrix given by upper triangle (lower one is skipped): element (i, j), i <= j,
+// goes to (min(inv[i], inv[j]), max(inv[i], inv[j])), so permutation doesnt move it under diagonal
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+CSCMatrix<T, IsDivArithm, Cmp, Abs> ordered_upper_csc(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat,
+                                                      SparseOrdering ordering, std::vector<std::size_t>& perm)
+{
+    if (ordering == SparseOrdering::natural)
+        return ordered_csc(mat, ordering, perm);
+
+    perm = reverse_cuthill_mckee(mat);
+    auto n = mat.height();
+    std::vector<std::size_t> inv (n);
+    for (std::size_t k = 0; k < n; k++)
+        inv[perm[k]] = k;
+
+    auto offsets = mat.offsets();
+    auto indices = mat.indices();
+    auto values  = mat.values();
+    auto position = [&](std::size_t outer, std::size_t p)
+    {
+        auto i = Order == SparseOrder::col ? indices[p] : outer;
+        auto j = Order == SparseOrder::col ? outer : indices[p];
+        return std::pair {std::min(inv[i], inv[j]), std::max(inv[i], inv[j])};
+    };
+    auto is_upper = [&](std::size_t outer, std::size_t p)
+    {
+        return Order == SparseOrder::col ? indices[p] <= outer : outer <= indices[p];
+    };
+
+    // counting sort by column of result, then two transpositions sort rows inside columns
+    CompressedArrays<T> moved {std::vector<std::size_t>(n + 1, 0), {}, {}};
+    for (std::size_t outer = 0; outer < n; outer++)
+        for (auto p = offsets[outer]; p < offsets[outer + 1]; p++)
+            if (is_upper(outer, p))
+                moved.offsets[position(outer, p).second + 1]++;
+    for (std::size_t k = 0; k < n; k++)
+        moved.offsets[k + 1] += moved.offsets[k];
+
+    auto next = moved.offsets;
+    moved.indices.resize(moved.offsets[n]);
+    moved.values.resize(moved.offsets[n]);
+    for (std::size_t outer = 0; outer < n; outer++)
+        for (auto p = offsets[outer]; p < offsets[outer + 1]; p++)
+            if (is_upper(outer, p))
+            {
+                auto [i, j] = position(outer, p);
+                auto q = next[j]++;
+                moved.indices[q] = i;
+                moved.values[q] = values[p];
+            }
+
+    auto once  = compressed_transpose<T>(n, n, {moved.offsets.data(), moved.indices.data(), moved.values.data()});
+    auto twice = compressed_transpose<T>(n, n, {once.offsets.data(), once.indices.data(), once.values.data()});
+    return {n, n, std::move(twice.offsets), std::move(twice.indices), std::move(twice.values)};
+}
+} // namespace detail
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * P * (Q A Q^T) = L * U, Q is fill reducing ordering, P is row pivoting.      |
+ * Columns are made one by one (Gilbert-Peierls): column of A is solved with   |
+ * L found so far, nonzeros of result are found by depth-first search in       |
+ * graph of L, so work is proportional to arithmetic, not to size of matrix.  |
+ * Diagonal element is taken as pivot while it is not less than 0.1 of the    |
+ * largest candidate, it keeps band made by ordering.                          |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T = double, bool IsDivArithm = true, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class SparseLU
+{
+    static_assert(IsDivArithm, "LU decomposition needs arithmetical correct division");
+
+public:
+    using size_type  = std::size_t;
+    using value_type = T;
+
+private:
+    static constexpr size_type none = static_cast<size_type>(-1);
+
+    size_type n_ = 0;
+    std::vector<size_type> perm_;   // Q
+    std::vector<size_type> pinv_;   // pinv_[i] is step where row i of Q A Q^T became pivot
+    std::vector<size_type> lp_, li_, up_, ui_;
+    std::vector<value_type> lx_, ux_;   // L by columns with unit diagonal first, U by columns with diagonal last
+    bool singular_ = false;
+    Cmp cmp {};
+
+    // rows reached from pattern of column k of A in graph of L, topological order in xi[top, n)
+    size_type reach(const CSCMatrix<T, IsDivArithm, Cmp, Abs>& mat, size_type k, std::vector<size_type>& xi,
+                    std::vector<size_type>& stack, std::vector<size_type>& pstack, std::vector<size_type>& mark) const
+    {
+        auto top = n_;
+        auto stamp = k + 1;
+        for (auto p = mat.offsets()[k]; p < mat.offsets()[k + 1]; p++)
+        {
+            if (mark[mat.indices()[p]] == stamp)
+                continue;
+
+            size_type head = 0;
+            stack[0] = mat.indices()[p];
+            for (;;)
+            {
+                auto j = stack[head];
+                auto col = pinv_[j];
+                if (mark[j] != stamp)
+                {
+                    mark[j] = stamp;
+                    pstack[head] = col == none ? 0 : lp_[col];
+                }
+
+                bool done = true;
+                auto end = col == none ? 0 : lp_[col + 1];
+                for (auto q = pstack[head]; q < end; q++)
+                    if (mark[li_[q]] != stamp)
+                    {
+                        pstack[head] = q;
+                        stack[++head] = li_[q];
+                        done = false;
+                        break;
+                    }
+
+                if (done)
+                {
+                    xi[--top] = j;
+                    if (head-- == 0)
+                        break;
+                }
+            }
+        }
+        return top;
+    }
+
+    void factorize(const CSCMatrix<T, IsDivArithm, Cmp, Abs>& mat)
+    {
+        Abs abs {};
+        pinv_.assign(n_, none);
+        lp_.assign(n_ + 1, 0);
+        up_.assign(n_ + 1, 0);
+        li_.reserve(mat.nnz() + n_);
+        lx_.reserve(mat.nnz() + n_);
+        ui_.reserve(mat.nnz() + n_);
+        ux_.reserve(mat.nnz() + n_);
+
+        std::vector<value_type> x (n_);
+        std::vector<size_type> xi (n_), stack (n_), pstack (n_), mark (n_, 0);
+        for (size_type k = 0; k < n_; k++)
+        {
+            // x is zero outside of pattern of current column
+            auto top = reach(mat, k, xi, stack, pstack, mark);
+            for (auto p = mat.offsets()[k]; p < mat.offsets()[k + 1]; p++)
+                x[mat.indices()[p]] = mat.values()[p];
+
+            // x = L \ A(:, k)
+            for (auto p = top; p < n_; p++)
+            {
+                auto j = xi[p];
+                auto col = pinv_[j];
+                if (col == none)
+                    continue;
+                for (auto q = lp_[col] + 1; q < lp_[col + 1]; q++)
+                    x[li_[q]] -= lx_[q] * x[j];
+            }
+
+            // pivotal rows go to U, others are candidates for pivot
+            auto pivot = none;
+            for (auto p = top; p < n_; p++)
+            {
+                auto i = xi[p];
+                if (pinv_[i] != none)
+                {
+                    ui_.push_back(pinv_[i]);
+                    ux_.push_back(x[i]);
+                }
+                else if (!cmp(x[i], value_type{}) && (pivot == none || abs(x[i]) > abs(x[pivot])))
+                    pivot = i;
+            }
+
+            if (pivot == none)
+            {
+                singular_ = true;
+                return;
+            }
+            if (pinv_[k] == none && !cmp(x[k], value_type{}) && abs(x[k]) * 10 >= abs(x[pivot]))
+                pivot = k;
+
+            auto diag = x[pivot];
+            ui_.push_back(k);
+            ux_.push_back(diag);
+            up_[k + 1] = ui_.size();
+
+            pinv_[pivot] = k;
+            li_.push_back(pivot);
+            lx_.push_back(value_type{1});
+            for (auto p = top; p < n_; p++)
+            {
+                auto i = xi[p];
+                if (pinv_[i] == none && !cmp(x[i], value_type{}))
+                {
+                    li_.push_back(i);
+                    lx_.push_back(x[i] / diag);
+                }
+                x[i] = value_type{};
+            }
+            lp_[k + 1] = li_.size();
+        }
+
+        // rows of L in order of pivots
+        for (auto& i: li_)
+            i = pinv_[i];
+    }
+
+    void check_regular() const
+    {
+        if (singular_)
+            throw std::invalid_argument{"try to solve system with matrix with determinant equal to zero"};
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    template<SparseOrder Order>
+    explicit SparseLU(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat, SparseOrdering ordering = SparseOrdering::rcm)
+    :n_ {mat.height()}
+    {
+        if (!mat.is_square())
+            throw std::invalid_argument{"try to make LU decomposition of no square matrix"};
+        factorize(detail::ordered_csc(mat, ordering, perm_));
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Factors start |=---------------------------------------------------
+    size_type size() const {return n_;}
+    bool is_singular() const {return singular_;}
+
+    // Q: row and column k of factorized matrix are row and column permutation()[k] of A
+    const std::vector<size_type>& permutation() const {return perm_;}
+
+    // number of stored elements of L and U together, diagonal of L included
+    size_type nnz() const {return li_.size() + ui_.size();}
+//--------------------------------=| Factors end |=-----------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    value_type determinant() const
+    {
+        if (singular_)
+            return value_type{};
+
+        // det(Q A Q^T) = det(A), sign of P is parity of its cycles
+        value_type res {1};
+        std::vector<bool> done (n_, false);
+        for (size_type i = 0; i < n_; i++)
+        {
+            if (done[i])
+                continue;
+            size_type len = 0;
+            for (auto j = i; !done[j]; j = pinv_[j], len++)
+                done[j] = true;
+            if (len % 2 == 0)
+                res = -res;
+        }
+
+        for (size_type k = 0; k < n_; k++)
+            res *= ux_[up_[k + 1] - 1];
+        return res;
+    }
+
+    std::vector<value_type> solve(const std::vector<value_type>& rhs) const
+    {
+        check_regular();
+        if (rhs.size() != n_)
+            throw std::invalid_argument{"in solve: lhs.height() != rhs.height()"};
+
+        std::vector<value_type> y (n_);
+        for (size_type k = 0; k < n_; k++)
+            y[pinv_[k]] = rhs[perm_[k]];
+
+        for (size_type j = 0; j < n_; j++)
+            for (auto p = lp_[j] + 1; p < lp_[j + 1]; p++)
+                y[li_[p]] -= lx_[p] * y[j];
+
+        for (auto j = n_; j-- > 0;)
+        {
+            y[j] /= ux_[up_[j + 1] - 1];
+            for (auto p = up_[j]; p + 1 < up_[j + 1]; p++)
+                y[ui_[p]] -= ux_[p] * y[j];
+        }
+
+        std::vector<value_type> res (n_);
+        for (size_type k = 0; k < n_; k++)
+            res[perm_[k]] = y[k];
+        return res;
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class SparseLU
+
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Q A Q^T = L * L^T for symmetric positive definite A, only upper triangle of |
+ * A is read. Rows of L are made one by one (up-looking): pattern of row k is  |
+ * found by climbing elimination tree from elements of column k of A, first   |
+ * pass only counts them, so L is allocated once.                              |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<std::floating_point T = double, bool IsDivArithm = true, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class SparseCholesky
+{
+public:
+    using size_type  = std::size_t;
+    using value_type = T;
+
+private:
+    static constexpr size_type none = static_cast<size_type>(-1);
+
+    size_type n_ = 0;
+    std::vector<size_type> perm_, lp_, li_;
+    std::vector<value_type> lx_;    // L by columns, diagonal first
+
+    // pattern of row k of L in s[top, n) in topological order
+    static size_type ereach(const CSCMatrix<T, IsDivArithm, Cmp, Abs>& mat, size_type k, const std::vector<size_type>& parent,
+                            std::vector<size_type>& s, std::vector<size_type>& mark)
+    {
+        auto top = mat.height();
+        auto stamp = k + 1;
+        mark[k] = stamp;
+        for (auto p = mat.offsets()[k]; p < mat.offsets()[k + 1]; p++)
+        {
+            auto i = mat.indices()[p];
+            if (i > k)
+                continue;
+
+            size_type len = 0;
+            for (; mark[i] != stamp; i = parent[i])
+            {
+                s[len++] = i;
+                mark[i] = stamp;
+            }
+            while (len > 0)
+                s[--top] = s[--len];
+        }
+        return top;
+    }
+
+    void factorize(const CSCMatrix<T, IsDivArithm, Cmp, Abs>& mat)
+    {
+        auto offsets = mat.offsets();
+        auto indices = mat.indices();
+        auto values  = mat.values();
+
+        std::vector<size_type> parent (n_, none), ancestor (n_, none);
+        for (size_type k = 0; k < n_; k++)
+            for (auto p = offsets[k]; p < offsets[k + 1]; p++)
+                for (auto i = indices[p]; i != none && i < k;)
+                {
+                    auto next = ancestor[i];
+                    ancestor[i] = k;
+                    if (next == none)
+                        parent[i] = k;
+                    i = next;
+                }
+
+        std::vector<size_type> s (n_), mark (n_, 0), next (n_ + 1, 0);
+        for (size_type k = 0; k < n_; k++)
+        {
+            next[k + 1]++;
+            for (auto top = ereach(mat, k, parent, s, mark); top < n_; top++)
+                next[s[top] + 1]++;
+        }
+        for (size_type k = 0; k < n_; k++)
+            next[k + 1] += next[k];
+        lp_ = next;
+        li_.resize(lp_[n_]);
+        lx_.resize(lp_[n_]);
+
+        std::fill(mark.begin(), mark.end(), 0);
+        std::vector<value_type> x (n_);
+        for (size_type k = 0; k < n_; k++)
+        {
+            auto top = ereach(mat, k, parent, s, mark);
+            x[k] = value_type{};
+            for (auto p = offsets[k]; p < offsets[k + 1]; p++)
+                if (indices[p] <= k)
+                    x[indices[p]] = values[p];
+
+            auto diag = x[k];
+            x[k] = value_type{};
+            for (; top < n_; top++)
+            {
+                auto i = s[top];
+                auto lki = x[i] / lx_[lp_[i]];
+                x[i] = value_type{};
+                for (auto p = lp_[i] + 1; p < next[i]; p++)
+                    x[li_[p]] -= lx_[p] * lki;
+                diag -= lki * lki;
+                auto p = next[i]++;
+                li_[p] = k;
+                lx_[p] = lki;
+            }
+
+            if (!(diag > 0))
+                throw std::invalid_argument{"try to make Cholesky decomposition of not positive definite matrix"};
+            auto p = next[k]++;
+            li_[p] = k;
+            lx_[p] = std::sqrt(diag);
+        }
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    template<SparseOrder Order>
+    explicit SparseCholesky(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat, SparseOrdering ordering = SparseOrdering::rcm)
+    :n_ {mat.height()}
+    {
+        if (!mat.is_square())
+            throw std::invalid_argument{"try to make Cholesky decomposition of no square matrix"};
+        factorize(detail::ordered_upper_csc(mat, ordering, perm_));
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Factors start |=---------------------------------------------------
+    size_type size() const {return n_;}
+    const std::vector<size_type>& permutation() const {return perm_;}
+    size_type nnz() const {return li_.size();}
+//--------------------------------=| Factors end |=-----------------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    value_type determinant() const
+    {
+        value_type res {1};
+        for (size_type k = 0; k < n_; k++)
+            res *= lx_[lp_[k]] * lx_[lp_[k]];
+        return res;
+    }
+
+    std::vector<value_type> solve(const std::vector<value_type>& rhs) const
+    {
+        if (rhs.size() != n_)
+            throw std::invalid_argument{"in solve: lhs.height() != rhs.height()"};
+
+        std::vector<value_type> y (n_);
+        for (size_type k = 0; k < n_; k++)
+            y[k] = rhs[perm_[k]];
+
+        for (size_type j = 0; j < n_; j++)
+        {
+            y[j] /= lx_[lp_[j]];
+            for (auto p = lp_[j] + 1; p < lp_[j + 1]; p++)
+                y[li_[p]] -= lx_[p] * y[j];
+        }
+        for (auto j = n_; j-- > 0;)
+        {
+            for (auto p = lp_[j] + 1; p < lp_[j + 1]; p++)
+                y[j] -= lx_[p] * y[li_[p]];
+            y[j] /= lx_[lp_[j]];
+        }
+
+        std::vector<value_type> res (n_);
+        for (size_type k = 0; k < n_; k++)
+            res[perm_[k]] = y[k];
+        return res;
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class SparseCholesky
+
+//--------------------------------=| Preconditioners start |=-------------------------------------------
+// z = M^-1 * r for preconditioner M
+template<typename P, typename T>
+concept sparse_preconditioner = requires(const P& precond, const std::vector<T>& r, std::vector<T>& z)
+{
+    precond.apply(r, z);
+};
+
+struct IdentityPreconditioner
+{
+    template<typename T>
+    void apply(const std::vector<T>& r, std::vector<T>& z) const {std::copy(r.begin(), r.end(), z.begin());}
+};
+
+// M = diag(A)
+template<std::floating_point T>
+class JacobiPreconditioner
+{
+    std::vector<T> inv_diag_;
+
+public:
+    template<SparseOrder Order, bool IsDivArithm, class Cmp, class Abs>
+    explicit JacobiPreconditioner(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat)
+    :inv_diag_ (mat.height())
+    {
+        if (!mat.is_square())
+            throw std::invalid_argument{"try to make preconditioner of no square matrix"};
+        for (std::size_t i = 0; i < mat.height(); i++)
+        {
+            auto diag = mat.at(i, i);
+            if (diag == T{})
+                throw std::invalid_argument{"try to make Jacobi preconditioner of matrix with zero on diagonal"};
+            inv_diag_[i] = T{1} / diag;
+        }
+    }
+
+    void apply(const std::vector<T>& r, std::vector<T>& z) const
+    {
+        for (std::size_t i = 0; i < inv_diag_.size(); i++)
+            z[i] = inv_diag_[i] * r[i];
+    }
+};
+
+// M = L * U with pattern of A (incomplete LU without fill), diagonal of A must be stored
+template<std::floating_point T>
+class ILU0Preconditioner
+{
+    std::vector<std::size_t> offsets_, indices_, diag_;
+    std::vector<T> values_;
+
+public:
+    template<SparseOrder Order, bool IsDivArithm, class Cmp, class Abs>
+    explicit ILU0Preconditioner(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat)
+    {
+        if (!mat.is_square())
+            throw std::invalid_argument{"try to make preconditioner of no square matrix"};
+
+        CSRMatrix<T, IsDivArithm, Cmp, Abs> csr (mat);
+        offsets_.assign(csr.offsets().begin(), csr.offsets().end());
+        indices_.assign(csr.indices().begin(), csr.indices().end());
+        values_.assign(csr.values().begin(), csr.values().end());
+
+        auto n = csr.height();
+        diag_.resize(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            auto it = std::lower_bound(indices_.begin() + offsets_[i], indices_.begin() + offsets_[i + 1], i);
+            if (it == indices_.begin() + offsets_[i + 1] || *it != i)
+                throw std::invalid_argument{"try to make ILU(0) preconditioner of matrix without diagonal element"};
+            diag_[i] = it - indices_.begin();
+        }
+
+        // row i = row i - l_ik * row k only where row i has elements
+        for (std::size_t i = 0; i < n; i++)
+            for (auto p = offsets_[i]; p < diag_[i]; p++)
+            {
+                auto k = indices_[p];
+                if (values_[diag_[k]] == T{})
+                    throw std::invalid_argument{"zero pivot in ILU(0) preconditioner"};
+                auto lik = values_[p] /= values_[diag_[k]];
+
+                auto q = p + 1, r = diag_[k] + 1;
+                while (q < offsets_[i + 1] && r < offsets_[k + 1])
+                {
+                    if (indices_[q] < indices_[r])
+                        q++;
+                    else if (indices_[r] < indices_[q])
+                        r++;
+                    else
+                        values_[q++] -= lik * values_[r++];
+                }
+            }
+        for (std::size_t i = 0; i < n; i++)
+            if (values_[diag_[i]] == T{})
+                throw std::invalid_argument{"zero pivot in ILU(0) preconditioner"};
+    }
+
+    void apply(const std::vector<T>& r, std::vector<T>& z) const
+    {
+        auto n = diag_.size();
+        for (std::size_t i = 0; i < n; i++)
+        {
+            auto sum = r[i];
+            for (auto p = offsets_[i]; p < diag_[i]; p++)
+                sum -= values_[p] * z[indices_[p]];
+            z[i] = sum;
+        }
+        for (auto i = n; i-- > 0;)
+        {
+            auto sum = z[i];
+            for (auto p = diag_[i] + 1; p < offsets_[i + 1]; p++)
+                sum -= values_[p] * z[indices_[p]];
+            z[i] = sum / values_[diag_[i]];
+        }
+    }
+};
+//--------------------------------=| Preconditioners end |=---------------------------------------------
+
+//--------------------------------=| Iterative solvers start |=-----------------------------------------
+struct SolverOptions
+{
+    double tolerance = 1e-10;           // stop when ||b - A * x|| <= tolerance * ||b||
+    std::size_t max_iterations = 1000;
+    std::size_t restart = 30;           // size of Krylov basis of gmres
+};
+
+struct SolverReport
+{
+    bool converged = false;
+    std::size_t iterations = 0;
+    double residual = 0;    // ||b - A * x|| / ||b|| on last iteration
+    double seconds = 0;
+
+    double seconds_per_iteration() const {return iterations ? seconds / iterations : 0;}
+};
+
+namespace detail
+{
+template<typename T>
+T sparse_dot(const std::vector<T>& lhs, const std::vector<T>& rhs, ThreadPool& pool)
+{
+    // partial sums are added in order of chunks, so result doesnt depend on threads
+    auto n = lhs.size();
+    auto grain = std::max(n / (4 * pool.num_threads()) + 1, 4 * sparse_min_grain);
+    std::vector<T> partial ((n + grain - 1) / grain);
+    pool.parallel_for(0, n, grain, [&](std::size_t first, std::size_t last)
+    {
+        T sum {};
+        for (auto i = first; i < last; i++)
+            sum += lhs[i] * rhs[i];
+        partial[first / grain] = sum;
+    });
+
+    T res {};
+    for (auto& sum: partial)
+        res += sum;
+    return res;
+}
+
+template<typename T>
+T sparse_norm(const std::vector<T>& vec, ThreadPool& pool) {return std::sqrt(sparse_dot(vec, vec, pool));}
+
+// dst += alpha * src
+template<typename T>
+void sparse_axpy(std::vector<T>& dst, T alpha, const std::vector<T>& src)
+{
+    elementwise<ElementwiseOp::axpy>(dst.data(), src.data(), alpha, dst.size());
+}
+
+// r = b - A * x, x is made zero vector if empty
+template<SparseOrder Order, typename T, bool IsDivArithm, class Cmp, class Abs>
+std::vector<T> start_residual(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat, const std::vector<T>& b,
+                              std::vector<T>& x, ThreadPool& pool)
+{
+    if (!mat.is_square() || b.size() != mat.height())
+        throw std::invalid_argument{"in solve: lhs.height() != rhs.height()"};
+    if (x.empty())
+        x.assign(b.size(), T{});
+    if (x.size() != b.size())
+        throw std::invalid_argument{"in solve: initial guess has wrong size"};
+
+    std::vector<T> r (b.size());
+    mat.multiply(x.data(), r.data(), pool);
+    for (std::size_t i = 0; i < r.size(); i++)
+        r[i] = b[i] - r[i];
+    return r;
+}
+
+class SolverTimer
+{
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+public:
+    SolverReport& finish(SolverReport& report) const
+    {
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        return report;
+    }
+};
+} // namespace detail
+
+// preconditioned conjugate gradients, A and preconditioner must be symmetric positive definite
+template<SparseOrder Order, std::floating_point T, bool IsDivArithm, class Cmp, class Abs, class Precond = IdentityPreconditioner>
+requires sparse_preconditioner<Precond, T>
+SolverReport conjugate_gradient(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat, const std::vector<T>& b,
+                                std::vector<T>& x, const Precond& precond = {}, const SolverOptions& options = {},
+                                ThreadPool& pool = default_pool())
+{
+    detail::SolverTimer timer;
+    SolverReport report;
+    auto r = detail::start_residual(mat, b, x, pool);
+    auto n = b.size();
+    auto b_norm = detail::sparse_norm(b, pool);
+    if (b_norm == T{})
+        b_norm = T{1};
+
+    std::vector<T> z (n), q (n), workspace;
+    precond.apply(r, z);
+    auto p = z;
+    auto rz = detail::sparse_dot(r, z, pool);
+    report.residual = detail::sparse_norm(r, pool) / b_norm;
+    while (report.residual > options.tolerance && report.iterations < options.max_iterations)
+    {
+        mat.multiply(p.data(), q.data(), workspace, pool);
+        auto alpha = rz / detail::sparse_dot(p, q, pool);
+        detail::sparse_axpy(x, alpha, p);
+        detail::sparse_axpy(r, -alpha, q);
+        report.iterations++;
+        report.residual = detail::sparse_norm(r, pool) / b_norm;
+
+        precond.apply(r, z);
+        auto rz_next = detail::sparse_dot(r, z, pool);
+        auto beta = rz_next / rz;
+        rz = rz_next;
+        for (std::size_t i = 0; i < n; i++)
+            p[i] = z[i] + beta * p[i];
+    }
+
+    report.converged = report.residual <= options.tolerance;
+    return timer.finish(report);
+}
+
+// stabilized biconjugate gradients with right preconditioning
+template<SparseOrder Order, std::floating_point T, bool IsDivArithm, class Cmp, class Abs, class Precond = IdentityPreconditioner>
+requires sparse_preconditioner<Precond, T>
+SolverReport bicgstab(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat, const std::vector<T>& b,
+                      std::vector<T>& x, const Precond& precond = {}, const SolverOptions& options = {},
+                      ThreadPool& pool = default_pool())
+{
+    detail::SolverTimer timer;
+    SolverReport report;
+    auto r = detail::start_residual(mat, b, x, pool);
+    auto n = b.size();
+    auto b_norm = detail::sparse_norm(b, pool);
+    if (b_norm == T{})
+        b_norm = T{1};
+
+    auto r0 = r;
+    std::vector<T> p (n), v (n), p_hat (n), s (n), s_hat (n), t (n), workspace;
+    T rho {1}, alpha {1}, omega {1};
+    report.residual = detail::sparse_norm(r, pool) / b_norm;
+    while (report.residual > options.tolerance && report.iterations < options.max_iterations)
+    {
+        auto rho_next = detail::sparse_dot(r0, r, pool);
+        if (rho_next == T{})
+            break;      // breakdown, r is orthogonal to r0
+        auto beta = (rho_next / rho) * (alpha / omega);
+        rho = rho_next;
+        for (std::size_t i = 0; i < n; i++)
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+
+        precond.apply(p, p_hat);
+        mat.multiply(p_hat.data(), v.data(), workspace, pool);
+        alpha = rho / detail::sparse_dot(r0, v, pool);
+        for (std::size_t i = 0; i < n; i++)
+            s[i] = r[i] - alpha * v[i];
+        report.iterations++;
+
+        auto s_norm = detail::sparse_norm(s, pool) / b_norm;
+        if (s_norm <= options.tolerance)
+        {
+            detail::sparse_axpy(x, alpha, p_hat);
+            report.residual = s_norm;
+            break;
+        }
+
+        precond.apply(s, s_hat);
+        mat.multiply(s_hat.data(), t.data(), workspace, pool);
+        auto tt = detail::sparse_dot(t, t, pool);
+        omega = tt == T{} ? T{} : detail::sparse_dot(t, s, pool) / tt;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            x[i] += alpha * p_hat[i] + omega * s_hat[i];
+            r[i] = s[i] - omega * t[i];
+        }
+        report.residual = detail::sparse_norm(r, pool) / b_norm;
+        if (omega == T{})
+            break;
+    }
+
+    report.converged = report.residual <= options.tolerance;
+    return timer.finish(report);
+}
+
+// restarted generalized minimal residual with right preconditioning, basis of options.restart vectors
+template<SparseOrder Order, std::floating_point T, bool IsDivArithm, class Cmp, class Abs, class Precond = IdentityPreconditioner>
+requires sparse_preconditioner<Precond, T>
+SolverReport gmres(const BasicSparseMatrix<Order, T, IsDivArithm, Cmp, Abs>& mat, const std::vector<T>& b,
+                   std::vector<T>& x, const Precond& precond = {}, const SolverOptions& options = {},
+                   ThreadPool& pool = default_pool())
+{
+    detail::SolverTimer timer;
+    SolverReport report;
+    auto r = detail::start_residual(mat, b, x, pool);
+    auto n = b.size();
+    auto m = std::max<std::size_t>(options.restart, 1);
+    auto b_norm = detail::sparse_norm(b, pool);
+    if (b_norm == T{})
+        b_norm = T{1};
+
+    std::vector<std::vector<T>> basis (m + 1, std::vector<T>(n));
+    std::vector<std::vector<T>> hess (m + 1, std::vector<T>(m));   // hess[i][j], Givens rotations make it upper triangular
+    std::vector<T> cs (m), sn (m), g (m + 1), z (n), workspace;
+
+    auto beta = detail::sparse_norm(r, pool);
+    report.residual = beta / b_norm;
+    while (report.residual > options.tolerance && report.iterations < options.max_iterations)
+    {
+        for (std::size_t i = 0; i < n; i++)
+            basis[0][i] = r[i] / beta;
+        std::fill(g.begin(), g.end(), T{});
+        g[0] = beta;
+
+        std::size_t j = 0;
+        while (j < m && report.iterations < options.max_iterations)
+        {
+            auto& w = basis[j + 1];
+            precond.apply(basis[j], z);
+            mat.multiply(z.data(), w.data(), workspace, pool);
+            for (std::size_t i = 0; i <= j; i++)
+            {
+                hess[i][j] = detail::sparse_dot(w, basis[i], pool);
+                detail::sparse_axpy(w, -hess[i][j], basis[i]);
+            }
+            auto h = detail::sparse_norm(w, pool);
+            if (h != T{})
+                for (auto& val: w)
+                    val /= h;
+
+            for (std::size_t i = 0; i < j; i++)
+            {
+                auto tmp = cs[i] * hess[i][j] + sn[i] * hess[i + 1][j];
+                hess[i + 1][j] = -sn[i] * hess[i][j] + cs[i] * hess[i + 1][j];
+                hess[i][j] = tmp;
+            }
+            auto denom = std::hypot(hess[j][j], h);
+            cs[j] = hess[j][j] / denom;
+            sn[j] = h / denom;
+            hess[j][j] = denom;
+            g[j + 1] = -sn[j] * g[j];
+            g[j] *= cs[j];
+
+            j++;
+            report.iterations++;
+            report.residual = std::abs(g[j]) / b_norm;
+            if (report.residual <= options.tolerance || h == T{})
+                break;
+        }
+
+        // x += M^-1 * V * y, H * y = g
+        std::vector<T> y (g.begin(), g.begin() + j);
+        for (auto i = j; i-- > 0;)
+        {
+            for (auto k = i + 1; k < j; k++)
+                y[i] -= hess[i][k] * y[k];
+            y[i] /= hess[i][i];
+        }
+        std::fill(r.begin(), r.end(), T{});
+        for (std::size_t i = 0; i < j; i++)
+            detail::sparse_axpy(r, y[i], basis[i]);
+        precond.apply(r, z);
+        detail::sparse_axpy(x, T{1}, z);
+
+        r = detail::start_residual(mat, b, x, pool);
+        beta = detail::sparse_norm(r, pool);
+        report.residual = beta / b_norm;
+        if (beta == T{})
+            break;
+    }
+
+    report.converged = report.residual <= options.tolerance;
+    return timer.finish(report);
+}
+//--------------------------------=| Iterative solvers end |=-------------------------------------------
+
+} // namespace Matrix
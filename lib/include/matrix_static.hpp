@@ -0,0 +1,440 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "matrix_arithmetic.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Matrix with sizes known at compile time: elements are stored inside object  |
+ * (no heap), all loops have constant bounds and are unrolled, so 2 x 2 ... 4  |
+ * x 4 transforms are computed in registers. Sizes of operands are checked by  |
+ * types: product of 2 x 3 and 2 x 3 or determinant of 2 x 3 does not compile.|
+ *                                                                              |
+ * determinant and inverse have closed forms for sizes up to 4, bigger ones    |
+ * go through MatrixArithmetic. Template parameters after sizes mean the same  |
+ * as in MatrixArithmetic, StaticMatrix converts to it and back.                |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm = false,
+         class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+class StaticMatrix
+{
+public:
+    using size_type        = std::size_t;
+    using value_type       = T;
+    using reference        = T&;
+    using const_reference  = const T&;
+    using pointer          = T*;
+    using const_pointer    = const T*;
+
+    using Row = std::array<value_type, W>;
+
+    using iterator       = typename std::array<Row, H>::iterator;
+    using const_iterator = typename std::array<Row, H>::const_iterator;
+
+    using matrix_type = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+
+    static constexpr bool is_div_arithmetical = IsDivArithm;
+
+private:
+    std::array<Row, H> rows_ {};
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    constexpr StaticMatrix() = default;
+
+    // all elements are val
+    constexpr explicit StaticMatrix(const_reference val)
+    {
+        for (auto& row: rows_)
+            row.fill(val);
+    }
+
+    // missing elements are value_type{} like in MatrixContainer
+    constexpr StaticMatrix(std::initializer_list<std::initializer_list<value_type>> twodim_list)
+    {
+        if (twodim_list.size() > H)
+            throw std::invalid_argument{"too many rows in initializer list of StaticMatrix"};
+
+        size_type i = 0;
+        for (auto& row: twodim_list)
+        {
+            if (row.size() > W)
+                throw std::invalid_argument{"too many elements in row of initializer list of StaticMatrix"};
+            size_type j = 0;
+            for (auto& elem: row)
+                rows_[i][j++] = elem;
+            i++;
+        }
+    }
+
+    explicit StaticMatrix(const MatrixContainer<value_type>& mat)
+    {
+        if (mat.height() != H || mat.width() != W)
+            throw std::invalid_argument{"Try to make StaticMatrix from matrix with different height() * width()"};
+
+        for (size_type i = 0; i < H; i++)
+            for (size_type j = 0; j < W; j++)
+                rows_[i][j] = mat.to(i, j);
+    }
+
+    operator matrix_type() const
+    {
+        matrix_type res (H, W);
+        for (size_type i = 0; i < H; i++)
+            std::copy(rows_[i].begin(), rows_[i].end(), res[i].begin());
+        return res;
+    }
+
+    static constexpr StaticMatrix eye() requires (H == W)
+    {
+        StaticMatrix res;
+        for (size_type i = 0; i < H; i++)
+            res.rows_[i][i] = value_type{1};
+        return res;
+    }
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Acces start |=-----------------------------------------------------
+    static constexpr size_type height() {return H;}
+    static constexpr size_type width()  {return W;}
+    static constexpr size_type ld()     {return W;}
+
+    static constexpr bool is_row()    {return H == 1;}
+    static constexpr bool is_column() {return W == 1;}
+    static constexpr bool is_scalar() {return H == 1 && W == 1;}
+    static constexpr bool is_square() {return H == W;}
+
+    constexpr pointer       data()       noexcept {return rows_.data()->data();}
+    constexpr const_pointer data() const noexcept {return rows_.data()->data();}
+
+    constexpr reference       to(size_type i, size_type j)       noexcept {return rows_[i][j];}
+    constexpr const_reference to(size_type i, size_type j) const noexcept {return rows_[i][j];}
+
+    constexpr Row&       operator[](size_type ind)       noexcept {return rows_[ind];}
+    constexpr const Row& operator[](size_type ind) const noexcept {return rows_[ind];}
+
+    constexpr Row& at(size_type ind)
+    {
+        if (ind >= H)
+            throw std::out_of_range{"try to get row with index out of range"};
+        return rows_[ind];
+    }
+
+    constexpr const Row& at(size_type ind) const
+    {
+        if (ind >= H)
+            throw std::out_of_range{"try to get row with index out of range"};
+        return rows_[ind];
+    }
+
+    constexpr iterator begin() {return rows_.begin();}
+    constexpr iterator end()   {return rows_.end();}
+
+    constexpr const_iterator begin() const {return rows_.begin();}
+    constexpr const_iterator end()   const {return rows_.end();}
+//--------------------------------=| Acces end |=-------------------------------------------------------
+
+//--------------------------------=| Compare start |=---------------------------------------------------
+    constexpr bool equal_to(const StaticMatrix& rhs) const
+    {
+        for (size_type i = 0; i < H; i++)
+            for (size_type j = 0; j < W; j++)
+                if (!Cmp{}(rows_[i][j], rhs.rows_[i][j]))
+                    return false;
+        return true;
+    }
+//--------------------------------=| Compare end |=-----------------------------------------------------
+
+//--------------------------------=| Basic arithmetic start |=------------------------------------------
+    constexpr StaticMatrix& operator+=(const StaticMatrix& rhs)
+    {
+        #pragma GCC unroll 16
+        for (size_type i = 0; i < H; i++)
+            #pragma GCC unroll 16
+            for (size_type j = 0; j < W; j++)
+                rows_[i][j] += rhs.rows_[i][j];
+        return *this;
+    }
+
+    constexpr StaticMatrix& operator-=(const StaticMatrix& rhs)
+    {
+        #pragma GCC unroll 16
+        for (size_type i = 0; i < H; i++)
+            #pragma GCC unroll 16
+            for (size_type j = 0; j < W; j++)
+                rows_[i][j] -= rhs.rows_[i][j];
+        return *this;
+    }
+
+    constexpr StaticMatrix& operator*=(const_reference rhs)
+    {
+        #pragma GCC unroll 16
+        for (size_type i = 0; i < H; i++)
+            #pragma GCC unroll 16
+            for (size_type j = 0; j < W; j++)
+                rows_[i][j] *= rhs;
+        return *this;
+    }
+
+    constexpr StaticMatrix& operator/=(const_reference rhs)
+    {
+        #pragma GCC unroll 16
+        for (size_type i = 0; i < H; i++)
+            #pragma GCC unroll 16
+            for (size_type j = 0; j < W; j++)
+                rows_[i][j] /= rhs;
+        return *this;
+    }
+//--------------------------------=| Basic arithmetic end |=--------------------------------------------
+
+//--------------------------------=| Public methods start |=--------------------------------------------
+    constexpr StaticMatrix<T, W, H, IsDivArithm, Cmp, Abs> transpos() const
+    {
+        StaticMatrix<T, W, H, IsDivArithm, Cmp, Abs> res;
+        #pragma GCC unroll 16
+        for (size_type i = 0; i < H; i++)
+            #pragma GCC unroll 16
+            for (size_type j = 0; j < W; j++)
+                res[j][i] = rows_[i][j];
+        return res;
+    }
+
+    // only + - * for sizes up to 4, so closed form is exact for integers too
+    constexpr value_type determinant() const requires (H == W)
+    {
+        const auto& a = rows_;
+        if constexpr (H == 0)
+            return value_type{1};
+        else if constexpr (H == 1)
+            return a[0][0];
+        else if constexpr (H == 2)
+            return a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        else if constexpr (H == 3)
+            return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+                 - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+                 + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+        else if constexpr (H == 4)
+        {
+            // Laplace expansion by 2 x 2 minors of two upper and two lower rows
+            auto s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+            auto s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+            auto s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+            auto s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+            auto s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+            auto s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+            auto c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+            auto c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+            auto c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+            auto c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+            auto c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+            auto c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+            return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        }
+        else
+            return matrix_type(*this).determinant();
+    }
+
+    constexpr StaticMatrix inverse() const requires (H == W) && IsDivArithm
+    {
+        if constexpr (H > 4)
+            return StaticMatrix(matrix_type(*this).inverse());
+        else
+        {
+            auto det = determinant();
+            if (Cmp{}(det, value_type{}))
+                throw std::invalid_argument{"try to get inverse matrix for matrix with determinant equal to zero"};
+
+            auto res = adjugate();
+            if constexpr (std::is_floating_point_v<value_type>)
+                res *= value_type{1} / det;
+            else
+                res /= det;
+            return res;
+        }
+    }
+
+private:
+    // transposed matrix of cofactors: A * adjugate() = det(A) * E
+    constexpr StaticMatrix adjugate() const requires (H == W) && (H <= 4)
+    {
+        const auto& a = rows_;
+        StaticMatrix res;
+        if constexpr (H == 1)
+            res.rows_[0][0] = value_type{1};
+        else if constexpr (H == 2)
+            res.rows_ = {{{ a[1][1], -a[0][1]},
+                          {-a[1][0],  a[0][0]}}};
+        else if constexpr (H == 3)
+            res.rows_ = {{{a[1][1] * a[2][2] - a[1][2] * a[2][1],
+                           a[0][2] * a[2][1] - a[0][1] * a[2][2],
+                           a[0][1] * a[1][2] - a[0][2] * a[1][1]},
+                          {a[1][2] * a[2][0] - a[1][0] * a[2][2],
+                           a[0][0] * a[2][2] - a[0][2] * a[2][0],
+                           a[0][2] * a[1][0] - a[0][0] * a[1][2]},
+                          {a[1][0] * a[2][1] - a[1][1] * a[2][0],
+                           a[0][1] * a[2][0] - a[0][0] * a[2][1],
+                           a[0][0] * a[1][1] - a[0][1] * a[1][0]}}};
+        else if constexpr (H == 4)
+        {
+            // the same 2 x 2 minors as in determinant()
+            auto s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+            auto s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+            auto s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+            auto s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+            auto s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+            auto s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+            auto c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+            auto c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+            auto c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+            auto c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+            auto c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+            auto c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+            res.rows_ = {{{ a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3,
+                           -a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3,
+                            a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3,
+                           -a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3},
+                          {-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1,
+                            a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1,
+                           -a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1,
+                            a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1},
+                          { a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0,
+                           -a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0,
+                            a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0,
+                           -a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0},
+                          {-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0,
+                            a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0,
+                           -a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0,
+                            a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0}}};
+        }
+        return res;
+    }
+//--------------------------------=| Public methods end |=----------------------------------------------
+}; // class StaticMatrix
+
+//--------------------------------=| Wrappers arounf methods start |=-----------------------------------
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr T scalar_cast(const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& mat) requires (H == 1 && W == 1)
+{
+    return mat.to(0, 0);
+}
+
+template<typename T, std::size_t N, bool IsDivArithm, class Cmp, class Abs>
+constexpr T determinant(const StaticMatrix<T, N, N, IsDivArithm, Cmp, Abs>& mat)
+{
+    return mat.determinant();
+}
+
+template<typename T, std::size_t N, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, N, N, IsDivArithm, Cmp, Abs> inverse(const StaticMatrix<T, N, N, IsDivArithm, Cmp, Abs>& mat) requires IsDivArithm
+{
+    return mat.inverse();
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, W, H, IsDivArithm, Cmp, Abs> transpos(const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& mat)
+{
+    return mat.transpos();
+}
+//--------------------------------=| Wrappers arounf methods end |=-------------------------------------
+
+//--------------------------------=| Arrithmetical operators start |=-----------------------------------
+// i-k-j order with constant bounds: rows of res are updated by whole vectors
+template<typename T, std::size_t H, std::size_t K, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> product(const StaticMatrix<T, H, K, IsDivArithm, Cmp, Abs>& lhs,
+                                                               const StaticMatrix<T, K, W, IsDivArithm, Cmp, Abs>& rhs)
+{
+    StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> res;
+    #pragma GCC unroll 16
+    for (std::size_t i = 0; i < H; i++)
+        #pragma GCC unroll 16
+        for (std::size_t k = 0; k < K; k++)
+        {
+            auto elem = lhs.to(i, k);
+            #pragma GCC unroll 16
+            for (std::size_t j = 0; j < W; j++)
+                res.to(i, j) += elem * rhs.to(k, j);
+        }
+    return res;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr bool operator==(const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& lhs, const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs.equal_to(rhs);
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr bool operator!=(const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& lhs, const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> operator+(StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> lhs,
+                                                                 const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs += rhs;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> operator-(StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> lhs,
+                                                                 const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& rhs)
+{
+    return lhs -= rhs;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> operator-(StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> arg)
+{
+    for (auto& row: arg)
+        for (auto& elem: row)
+            elem = -elem;
+    return arg;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> operator*(StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> lhs, const std::type_identity_t<T>& rhs)
+{
+    return lhs *= rhs;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> operator*(const std::type_identity_t<T>& lhs, StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> rhs)
+{
+    return rhs *= lhs;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+constexpr StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> operator/(StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs> lhs, const std::type_identity_t<T>& rhs)
+{
+    return lhs /= rhs;
+}
+
+template<typename T, std::size_t H, std::size_t W, bool IsDivArithm, class Cmp, class Abs>
+std::ostream& operator<<(std::ostream& os, const StaticMatrix<T, H, W, IsDivArithm, Cmp, Abs>& mat)
+{
+    os << '{';
+    for (std::size_t i = 0; i < H; i++)
+    {
+        os << '{';
+        for (std::size_t j = 0; j < W; j++)
+            os << mat.to(i, j) << (j + 1 < W ? " " : "");
+        os << '}';
+    }
+    return os << '}';
+}
+//--------------------------------=| Arrithmetical operators end |=-------------------------------------
+
+} // namespace Matrix
@@ -0,0 +1,321 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "matrix_arithmetic.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Strassen-Winograd product: C = A * B by 7 products of halves and 15 sums     |
+ * instead of 8 products, recursion goes while all sizes are at least           |
+ * crossover, then product() kernel on threads of pool does the rest.           |
+ * Temporaries of all levels are cut from one buffer made before recursion:     |
+ * level needs only X (A-sized half) and Y (B-sized half), quarters of C hold   |
+ * other partial products (schedule of Douglas, Heroux, Slishman, Smith).       |
+ * Odd sizes are peeled: last row / column is added by rank-1 and vector        |
+ * products after recursion on even part.                                       |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+
+// sizes below which classical kernel is faster, measured on AVX2 machine
+inline constexpr std::size_t strassen_crossover = 1024;
+
+namespace detail
+{
+// rows[i] + col is row i of block, quarters of block share row table of whole matrix
+template<typename T>
+struct StrassenBlock
+{
+    T* const* rows;
+    std::size_t col;
+
+    T* row(std::size_t i) const {return rows[i] + col;}
+    StrassenBlock sub(std::size_t i, std::size_t j) const {return {rows + i, col + j};}
+
+    operator StrassenBlock<const T>() const requires (!std::is_const_v<T>) {return {rows, col};}
+};
+
+inline bool strassen_recurses(std::size_t m, std::size_t k, std::size_t n, std::size_t crossover)
+{
+    return std::min({m, k, n}) >= std::max<std::size_t>(crossover, 2);
+}
+
+inline std::size_t strassen_levels(std::size_t m, std::size_t k, std::size_t n, std::size_t crossover)
+{
+    std::size_t levels = 0;
+    for (; strassen_recurses(m, k, n, crossover); m /= 2, k /= 2, n /= 2)
+        levels++;
+    return levels;
+}
+
+// X and Y of every level, row starts aligned to cache line
+template<typename T>
+class StrassenWorkspace
+{
+public:
+    struct Level
+    {
+        StrassenBlock<T> x, y;
+    };
+
+private:
+    AlignedBuffer<T> elems_;
+    std::vector<T*> rows_;
+    std::vector<Level> levels_;
+
+    static std::size_t padded(std::size_t w)
+    {
+        constexpr std::size_t align_elems = AlignedBuffer<T>::alignment % sizeof(T) == 0 ? AlignedBuffer<T>::alignment / sizeof(T) : 1;
+        return (w + align_elems - 1) / align_elems * align_elems;
+    }
+
+public:
+    StrassenWorkspace(std::size_t m, std::size_t k, std::size_t n, std::size_t crossover)
+    {
+        std::size_t elems = 0, rows = 0;
+        for (auto [mi, ki, ni] = std::array {m, k, n}; strassen_recurses(mi, ki, ni, crossover); mi /= 2, ki /= 2, ni /= 2)
+        {
+            // X holds halves of A and then m/2 x n/2 product
+            elems += mi / 2 * padded(std::max(ki, ni) / 2) + ki / 2 * padded(ni / 2);
+            rows  += mi / 2 + ki / 2;
+        }
+
+        elems_ = AlignedBuffer<T>(elems);
+        rows_.resize(rows);
+
+        T* elem = elems_.data();
+        T** row = rows_.data();
+        auto carve = [&elem, &row](std::size_t h, std::size_t ld)
+        {
+            StrassenBlock<T> block {row, 0};
+            for (std::size_t i = 0; i < h; i++, elem += ld)
+                *row++ = elem;
+            return block;
+        };
+        for (auto [mi, ki, ni] = std::array {m, k, n}; strassen_recurses(mi, ki, ni, crossover); mi /= 2, ki /= 2, ni /= 2)
+        {
+            auto x = carve(mi / 2, padded(std::max(ki, ni) / 2));
+            auto y = carve(ki / 2, padded(ni / 2));
+            levels_.push_back({x, y});
+        }
+    }
+
+    const Level* levels() const {return levels_.data();}
+};
+
+// dst op= src for h x w blocks, rows are split between threads
+template<ElementwiseOp Op, typename T>
+void strassen_apply(std::size_t h, std::size_t w, StrassenBlock<T> dst, std::type_identity_t<StrassenBlock<const T>> src, ThreadPool& pool)
+{
+    auto grain = std::max<std::size_t>(1, (1 << 14) / std::max<std::size_t>(w, 1));
+    pool.parallel_for(0, h, grain, [=](std::size_t lo, std::size_t hi)
+    {
+        for (auto i = lo; i < hi; i++)
+            elementwise<Op>(dst.row(i), src.row(i), T{}, w);
+    });
+}
+
+template<typename T>
+void strassen_copy(std::size_t h, std::size_t w, StrassenBlock<T> dst, std::type_identity_t<StrassenBlock<const T>> src, ThreadPool& pool)
+{
+    auto grain = std::max<std::size_t>(1, (1 << 14) / std::max<std::size_t>(w, 1));
+    pool.parallel_for(0, h, grain, [=](std::size_t lo, std::size_t hi)
+    {
+        for (auto i = lo; i < hi; i++)
+            std::copy(src.row(i), src.row(i) + w, dst.row(i));
+    });
+}
+
+// c = a * b, a is m x k, b is k x n, c is not read
+template<typename T>
+void winograd(std::size_t m, std::size_t k, std::size_t n, StrassenBlock<const T> a, StrassenBlock<const T> b, StrassenBlock<T> c,
+              const typename StrassenWorkspace<T>::Level* level, std::size_t crossover, ThreadPool& pool)
+{
+    using size_type = std::size_t;
+    using Op = ElementwiseOp;
+
+    if (!strassen_recurses(m, k, n, crossover))
+    {
+        tiled_product<T>(m, n, k, [a](size_type i) {return a.row(i);}, [b](size_type i) {return b.row(i);},
+                         [c](size_type i) {return c.row(i);}, n, &pool);
+        return;
+    }
+
+    auto m2 = m / 2, k2 = k / 2, n2 = n / 2;
+    auto a11 = a.sub(0, 0), a12 = a.sub(0, k2), a21 = a.sub(m2, 0), a22 = a.sub(m2, k2);
+    auto b11 = b.sub(0, 0), b12 = b.sub(0, n2), b21 = b.sub(k2, 0), b22 = b.sub(k2, n2);
+    auto c11 = c.sub(0, 0), c12 = c.sub(0, n2), c21 = c.sub(m2, 0), c22 = c.sub(m2, n2);
+    auto x = level->x, y = level->y;
+
+    auto next = [&](StrassenBlock<const T> lhs, StrassenBlock<const T> rhs, StrassenBlock<T> res)
+    {
+        winograd<T>(m2, k2, n2, lhs, rhs, res, level + 1, crossover, pool);
+    };
+
+    strassen_copy(m2, k2, x, a11, pool);                   // X = A11 - A21
+    strassen_apply<Op::sub>(m2, k2, x, a21, pool);
+    strassen_copy(k2, n2, y, b22, pool);                   // Y = B22 - B12
+    strassen_apply<Op::sub>(k2, n2, y, b12, pool);
+    next(x, y, c21);                                       // C21 = P7
+    strassen_copy(m2, k2, x, a21, pool);                   // X = A21 + A22 = S1
+    strassen_apply<Op::add>(m2, k2, x, a22, pool);
+    strassen_copy(k2, n2, y, b12, pool);                   // Y = B12 - B11 = T1
+    strassen_apply<Op::sub>(k2, n2, y, b11, pool);
+    next(x, y, c22);                                       // C22 = P5 = S1 * T1
+    strassen_apply<Op::sub>(m2, k2, x, a11, pool);         // X = S1 - A11 = S2
+    strassen_apply<Op::neg>(k2, n2, y, y, pool);           // Y = B22 - T1 = T2
+    strassen_apply<Op::add>(k2, n2, y, b22, pool);
+    next(x, y, c12);                                       // C12 = P6 = S2 * T2
+    strassen_apply<Op::neg>(m2, k2, x, x, pool);           // X = A12 - S2 = S4
+    strassen_apply<Op::add>(m2, k2, x, a12, pool);
+    next(x, b22, c11);                                     // C11 = P3 = S4 * B22
+    next(a11, b11, x);                                     // X = P1
+    strassen_apply<Op::add>(m2, n2, c12, x, pool);         // C12 = P1 + P6 = U2
+    strassen_apply<Op::add>(m2, n2, c21, c12, pool);       // C21 = U2 + P7 = U3
+    strassen_apply<Op::add>(m2, n2, c12, c22, pool);       // C12 = U2 + P5 = U4
+    strassen_apply<Op::add>(m2, n2, c22, c21, pool);       // C22 = U3 + P5 = U7
+    strassen_apply<Op::add>(m2, n2, c12, c11, pool);       // C12 = U4 + P3 = U5
+    strassen_apply<Op::sub>(k2, n2, y, b21, pool);         // Y = T2 - B21 = T4
+    next(a22, y, c11);                                     // C11 = P4 = A22 * T4
+    strassen_apply<Op::sub>(m2, n2, c21, c11, pool);       // C21 = U3 - P4 = U6
+    next(a12, b21, c11);                                   // C11 = P2
+    strassen_apply<Op::add>(m2, n2, c11, x, pool);         // C11 = P1 + P2 = U1
+
+    // peeling: last column of A and row of B, then last column and row of C
+    if (k % 2)
+        for (size_type i = 0; i < 2 * m2; i++)
+            elementwise<Op::axpy>(c.row(i), b.row(k - 1), a.row(i)[k - 1], 2 * n2);
+    if (n % 2)
+        for (size_type i = 0; i < 2 * m2; i++)
+        {
+            T sum {};
+            for (size_type p = 0; p < k; p++)
+                sum += a.row(i)[p] * b.row(p)[n - 1];
+            c.row(i)[n - 1] = sum;
+        }
+    if (m % 2)
+    {
+        std::fill(c.row(m - 1), c.row(m - 1) + n, T{});
+        for (size_type p = 0; p < k; p++)
+            elementwise<Op::axpy>(c.row(m - 1), b.row(p), a.row(m - 1)[p], n);
+    }
+}
+
+template<typename T>
+std::vector<const T*> strassen_rows(const MatrixContainer<T>& mat)
+{
+    std::vector<const T*> rows (mat.height());
+    for (std::size_t i = 0; i < mat.height(); i++)
+        rows[i] = mat[i].data();
+    return rows;
+}
+} // namespace detail
+
+// lhs * rhs by Strassen-Winograd recursion down to crossover, small products go to product() as they are
+template<typename T = int, bool IsDivArithm = false, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+MatrixArithmetic<T, IsDivArithm, Cmp, Abs> strassen_product(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs,
+                                                            const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs,
+                                                            ThreadPool& pool = default_pool(), std::size_t crossover = strassen_crossover)
+{
+    using MatrixT = MatrixArithmetic<T, IsDivArithm, Cmp, Abs>;
+
+    if (lhs.is_scalar() || rhs.is_scalar() || !detail::strassen_recurses(lhs.height(), lhs.width(), rhs.width(), crossover))
+        return product(lhs, rhs, pool);
+    if (lhs.width() != rhs.height())
+        throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+
+    auto m = lhs.height(), k = lhs.width(), n = rhs.width();
+    // flops of classical product, so rates of both ways can be compared
+    detail::OperationScope scope {Operation::strassen, std::max({m, k, n}), detail::product_flops(m, n, k)};
+    auto res = detail::product_result<MatrixT>(m, n);
+    std::vector<T*> res_rows (m);
+    for (std::size_t i = 0; i < m; i++)
+    {
+        res_rows[i] = res[i].data();
+        std::fill(res_rows[i] + n, res_rows[i] + res.ld(), T{});
+    }
+    auto lhs_rows = detail::strassen_rows(lhs), rhs_rows = detail::strassen_rows(rhs);
+
+    detail::StrassenWorkspace<T> workspace (m, k, n, crossover);
+    detail::winograd<T>(m, k, n, {lhs_rows.data(), 0}, {rhs_rows.data(), 0}, {res_rows.data(), 0},
+                        workspace.levels(), crossover, pool);
+    return res;
+}
+
+template<typename L, typename R> requires detail::are_same_matrix_operands<L, R> &&
+                                          (detail::is_matrix_expression<L> || detail::is_matrix_expression<R>)
+detail::operand_matrix_t<L> strassen_product(const L& lhs, const R& rhs, ThreadPool& pool = default_pool(),
+                                             std::size_t crossover = strassen_crossover)
+{
+    return strassen_product(detail::evaluated(lhs), detail::evaluated(rhs), pool, crossover);
+}
+
+/*
+ * Errors of Strassen-Winograd product of given matrices, relative to max|A| * max|B|.
+ * Bounds are first order bounds of max|C - computed C| (Higham, Accuracy and Stability
+ * of Numerical Algorithms, ch. 23): k^2 u for classical product and
+ * (18^l (k0^2 + 6 k0) - 6k) u for l levels of Winograd variant, k0 = k / 2^l.
+ * measured is max difference from classical product of the same matrices.
+ */
+struct StrassenErrorReport
+{
+    std::size_t levels = 0;
+    double measured = 0;
+    double strassen_bound = 0;
+    double classical_bound = 0;
+
+    // growth of error against classical product, bound / classical bound
+    double growth() const {return classical_bound > 0 ? strassen_bound / classical_bound : 1;}
+
+    // Strassen-Winograd is as accurate as needed for this data
+    bool is_safe(double tolerance) const {return measured <= tolerance;}
+};
+
+template<std::floating_point T = double, bool IsDivArithm = true, class Cmp = std::equal_to<T>, class Abs = detail::DefaultAbs<T>>
+StrassenErrorReport strassen_error(const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& lhs, const MatrixArithmetic<T, IsDivArithm, Cmp, Abs>& rhs,
+                                   ThreadPool& pool = default_pool(), std::size_t crossover = strassen_crossover)
+{
+    if (lhs.width() != rhs.height())
+        throw std::invalid_argument{"in product: lhs.width() != rhs.height()"};
+
+    StrassenErrorReport report;
+    auto k = static_cast<double>(lhs.width());
+    report.levels = detail::strassen_levels(lhs.height(), lhs.width(), rhs.width(), crossover);
+
+    auto u = std::numeric_limits<T>::epsilon() / 2;
+    auto k0 = k / std::ldexp(1.0, static_cast<int>(report.levels));
+    report.classical_bound = k * k * u;
+    report.strassen_bound = (std::pow(18.0, static_cast<double>(report.levels)) * (k0 * k0 + 6 * k0) - 6 * k) * u;
+    if (report.levels == 0)
+        report.strassen_bound = report.classical_bound;
+
+    auto max_abs = [](const auto& mat)
+    {
+        double res = 0;
+        for (const auto& row: mat)
+            for (const auto& elem: row)
+                res = std::max(res, static_cast<double>(std::abs(elem)));
+        return res;
+    };
+    auto scale = max_abs(lhs) * max_abs(rhs);
+    if (scale == 0)
+        return report;
+
+    auto fast = strassen_product(lhs, rhs, pool, crossover);
+    auto classical = product(lhs, rhs, pool);
+    for (std::size_t i = 0; i < fast.height(); i++)
+        for (std::size_t j = 0; j < fast.width(); j++)
+            report.measured = std::max(report.measured, static_cast<double>(std::abs(fast.to(i, j) - classical.to(i, j))) / scale);
+    return report;
+}
+
+} // namespace Matrix
@@ -0,0 +1,321 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Fixed set of worker threads for parallel algorithms of the library.          |
+ * num_threads() counts the calling thread too: pool of N threads has N - 1     |
+ * workers and caller of parallel_for executes chunks itself, so nested calls   |
+ * from worker never wait for free worker and cant deadlock.                     |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+class ThreadPool
+{
+public:
+    using size_type = std::size_t;
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::counting_semaphore<> pending_ {0};
+
+    void worker_loop()
+    {
+        for (;;)
+        {
+            pending_.acquire();
+            std::function<void()> task;
+            {
+                std::lock_guard lock {mutex_};
+                if (tasks_.empty())
+                    return;     // released by join()
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    void start(size_type num_threads)
+    {
+        for (size_type i = 1; i < num_threads; i++)
+            workers_.emplace_back([this] {worker_loop();});
+    }
+
+    // one extra permit for every worker: queued tasks are finished first, then each worker meets empty queue
+    void join()
+    {
+        pending_.release(static_cast<std::ptrdiff_t>(workers_.size()));
+        for (auto& worker: workers_)
+            worker.join();
+        workers_.clear();
+    }
+
+    struct ForState
+    {
+        std::atomic<size_type> next {0};
+        size_type chunks;
+        std::latch remaining;
+        std::exception_ptr error;
+        std::mutex mutex;
+
+        explicit ForState(size_type num)
+        :chunks {num}, remaining {static_cast<std::ptrdiff_t>(num)}
+        {}
+    };
+
+    // chunks [lo, hi) of one participant packed as hi << 32 | lo, owner takes from front, thieves from back
+    struct alignas(64) StealRange
+    {
+        std::atomic<std::uint64_t> bounds {0};
+
+        static std::uint64_t pack(std::uint64_t lo, std::uint64_t hi) {return hi << 32 | lo;}
+        static size_type lo(std::uint64_t bounds) {return bounds & 0xffffffffu;}
+        static size_type hi(std::uint64_t bounds) {return bounds >> 32;}
+    };
+
+    struct StealState
+    {
+        std::unique_ptr<StealRange[]> ranges;
+        size_type parts;
+        std::atomic<size_type> next_part {0};
+        std::latch remaining;
+        std::exception_ptr error;
+        std::mutex mutex;
+
+        StealState(size_type num, size_type num_parts)
+        :ranges {new StealRange[num_parts]}, parts {num_parts}, remaining {static_cast<std::ptrdiff_t>(num)}
+        {
+            for (size_type i = 0; i < parts; i++)
+                ranges[i].bounds.store(StealRange::pack(num * i / parts, num * (i + 1) / parts));
+        }
+
+        // next chunk of own range, false if it is empty
+        bool pop(size_type part, size_type& chunk)
+        {
+            auto& range = ranges[part].bounds;
+            auto bounds = range.load();
+            while (StealRange::lo(bounds) < StealRange::hi(bounds))
+                if (range.compare_exchange_weak(bounds, StealRange::pack(StealRange::lo(bounds) + 1, StealRange::hi(bounds))))
+                {
+                    chunk = StealRange::lo(bounds);
+                    return true;
+                }
+            return false;
+        }
+
+        // moves back half of the longest range of other participants to own (empty) range
+        bool steal(size_type part)
+        {
+            for (;;)
+            {
+                size_type victim = parts, longest = 0;
+                std::uint64_t bounds = 0;
+                for (size_type i = 0; i < parts; i++)
+                {
+                    auto cur = ranges[i].bounds.load();
+                    if (i != part && StealRange::hi(cur) - StealRange::lo(cur) > longest &&
+                        StealRange::lo(cur) < StealRange::hi(cur))
+                    {
+                        victim = i;
+                        longest = StealRange::hi(cur) - StealRange::lo(cur);
+                        bounds = cur;
+                    }
+                }
+                if (victim == parts)
+                    return false;
+
+                auto lo = StealRange::lo(bounds), hi = StealRange::hi(bounds);
+                auto mid = lo + (hi - lo) / 2;
+                if (ranges[victim].bounds.compare_exchange_strong(bounds, StealRange::pack(lo, mid)))
+                {
+                    ranges[part].bounds.store(StealRange::pack(mid, hi));
+                    return true;
+                }
+            }
+        }
+    };
+
+public:
+    explicit ThreadPool(size_type num_threads = std::thread::hardware_concurrency())
+    {
+        start(std::max<size_type>(num_threads, 1));
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {join();}
+
+    size_type num_threads() const {return workers_.size() + 1;}
+
+    // BE CAREFUL: no parallel_for may run on this pool during resize
+    void resize(size_type num_threads)
+    {
+        join();
+        start(std::max<size_type>(num_threads, 1));
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock {mutex_};
+            tasks_.push(std::move(task));
+        }
+        pending_.release();
+    }
+
+    // calls func(lo, hi) for chunks of [begin, end) no longer than grain, returns when all chunks are done
+    template<typename F>
+    void parallel_for(size_type begin, size_type end, size_type grain, F&& func)
+    {
+        if (begin >= end)
+            return;
+        grain = std::max<size_type>(grain, 1);
+        size_type chunks = (end - begin + grain - 1) / grain;
+
+        if (chunks == 1 || workers_.empty())
+        {
+            for (size_type lo = begin; lo < end; lo += grain)
+                func(lo, std::min(lo + grain, end));
+            return;
+        }
+
+        auto state = std::make_shared<ForState>(chunks);
+
+        auto run = [state, begin, end, grain, &func]
+        {
+            for (;;)
+            {
+                auto chunk = state->next.fetch_add(1);
+                if (chunk >= state->chunks)
+                    return;
+                auto lo = begin + chunk * grain;
+                try {func(lo, std::min(lo + grain, end));}
+                catch (...)
+                {
+                    std::lock_guard lock {state->mutex};
+                    if (!state->error)
+                        state->error = std::current_exception();
+                }
+                state->remaining.count_down();
+            }
+        };
+
+        auto helpers = std::min(workers_.size(), chunks - 1);
+        for (size_type i = 0; i < helpers; i++)
+            submit(run);
+        run();
+
+        state->remaining.wait();
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+    /*
+     * Same as parallel_for, but chunks are scheduled by work stealing: every participant
+     * starts with its own contiguous run of chunks and takes back half of the longest
+     * run of others when its run is over. Neighbouring chunks stay on one thread, so
+     * data they share or that was first touched by this thread stays in its cache and
+     * on its NUMA node, and a late or busy worker doesnt hold chunks nobody else takes.
+     */
+    template<typename F>
+    void parallel_for_stealing(size_type begin, size_type end, size_type grain, F&& func)
+    {
+        if (begin >= end)
+            return;
+        grain = std::max<size_type>(grain, 1);
+        size_type chunks = (end - begin + grain - 1) / grain;
+
+        if (chunks == 1 || workers_.empty() || chunks > 0xffffffffu)
+        {
+            parallel_for(begin, end, grain, std::forward<F>(func));
+            return;
+        }
+
+        auto parts = std::min(num_threads(), chunks);
+        auto state = std::make_shared<StealState>(chunks, parts);
+
+        auto run = [state, begin, end, grain, &func]
+        {
+            // worker that starts late finds its run stolen and leaves without touching func
+            auto part = state->next_part.fetch_add(1);
+            size_type chunk = 0;
+            while (state->pop(part, chunk) || (state->steal(part) && state->pop(part, chunk)))
+            {
+                auto lo = begin + chunk * grain;
+                try {func(lo, std::min(lo + grain, end));}
+                catch (...)
+                {
+                    std::lock_guard lock {state->mutex};
+                    if (!state->error)
+                        state->error = std::current_exception();
+                }
+                state->remaining.count_down();
+            }
+        };
+
+        for (size_type i = 1; i < parts; i++)
+            submit(run);
+        run();
+
+        state->remaining.wait();
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+};
+
+namespace detail
+{
+inline std::size_t default_num_threads()
+{
+    if (const char* env = std::getenv("MATRIX_NUM_THREADS"))
+    {
+        auto num = std::strtoul(env, nullptr, 10);
+        if (num > 0)
+            return num;
+    }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+} // namespace detail
+
+// pool used by parallel algorithms when caller doesnt give own one, size is taken from
+// MATRIX_NUM_THREADS environment variable or number of hardware threads
+inline ThreadPool& default_pool()
+{
+    static ThreadPool pool {detail::default_num_threads()};
+    return pool;
+}
+
+namespace detail
+{
+// pool without workers, parallel_for on it runs every chunk on calling thread, so it may be
+// shared by any number of threads and small problems dont start default_pool() at all
+inline ThreadPool& calling_thread_pool()
+{
+    static ThreadPool pool {1};
+    return pool;
+}
+} // namespace detail
+
+inline std::size_t num_threads() {return default_pool().num_threads();}
+
+inline void set_num_threads(std::size_t num) {default_pool().resize(num);}
+
+} // namespace Matrix
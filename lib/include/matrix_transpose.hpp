@@ -0,0 +1,289 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix_simd.hpp"
+
+namespace Matrix
+{
+namespace detail
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Transposition kernels. Rows are given by functions returning pointer to row, |
+ * like in gemm, so permuted rows of MatrixContainer are read as they are.      |
+ *   recursion - larger side of block is halved until block is one tile, so    |
+ *               both source and destination stay in cache on every level      |
+ *               without knowing its size (cache-oblivious)                     |
+ *   tile      - transpose_tile x transpose_tile elements, walked by blocks of  |
+ *               vector registers: 4 x 4 floats / 2 x 2 doubles with SSE2,      |
+ *               8 x 8 floats / 4 x 4 doubles with AVX2 (picked at runtime)     |
+ *   block     - lanes rows are loaded to registers, log2(lanes) rounds of     |
+ *               shuffles transpose them, columns are stored as rows           |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+
+// side of tile, tiles of source and destination take 16 KiB of L1 for doubles
+inline constexpr std::size_t transpose_tile = 32;
+
+template<std::size_t Bytes, typename T>
+struct TransposeBlock
+{
+    static constexpr std::size_t lanes = Bytes / sizeof(T);
+
+    using index_type = std::conditional_t<sizeof(T) == 4, std::int32_t, std::int64_t>;
+    typedef T vec __attribute__((vector_size(Bytes)));
+    typedef index_type mask __attribute__((vector_size(Bytes)));
+
+    /*
+     * Rows r and r + S (r & S == 0) exchange their S x S sub-blocks: first one takes first halves
+     * of all 2S wide column groups of both rows, second one takes second halves. Round with
+     * S = lanes / 2 swaps off-diagonal quadrants, next rounds do the same inside every quadrant.
+     */
+    template<std::size_t S, bool Second>
+    static constexpr auto mask_indices = []
+    {
+        std::array<index_type, lanes> res {};
+        for (std::size_t j = 0; j < lanes; j++)
+        {
+            auto group = j / (2 * S) * (2 * S), pos = j % (2 * S);
+            if (pos < S)
+                res[j] = static_cast<index_type>(Second ? group + S + pos : group + pos);
+            else
+                res[j] = static_cast<index_type>(Second ? lanes + group + pos : lanes + group + pos - S);
+        }
+        return res;
+    }();
+
+    template<std::size_t S = lanes / 2>
+    [[gnu::always_inline]] static void transpose(vec (&rows)[lanes])
+    {
+        if constexpr (S >= 1)
+        {
+            // masks are constants after inlining, vectors never cross function boundary
+            mask first_mask, second_mask;
+            std::memcpy(&first_mask, mask_indices<S, false>.data(), Bytes);
+            std::memcpy(&second_mask, mask_indices<S, true>.data(), Bytes);
+            for (std::size_t r = 0; r < lanes; r++)
+                if (!(r & S))
+                {
+                    vec first = rows[r], second = rows[r + S];
+                    rows[r]     = __builtin_shuffle(first, second, first_mask);
+                    rows[r + S] = __builtin_shuffle(first, second, second_mask);
+                }
+            transpose<S / 2>(rows);
+        }
+    }
+
+    template<typename Row>
+    [[gnu::always_inline]] static void load(vec (&rows)[lanes], Row& row, std::size_t i0, std::size_t j0)
+    {
+        for (std::size_t r = 0; r < lanes; r++)
+            std::memcpy(&rows[r], row(i0 + r) + j0, Bytes);
+    }
+
+    template<typename Row>
+    [[gnu::always_inline]] static void store(const vec (&rows)[lanes], Row& row, std::size_t i0, std::size_t j0)
+    {
+        for (std::size_t r = 0; r < lanes; r++)
+            std::memcpy(row(i0 + r) + j0, &rows[r], Bytes);
+    }
+};
+
+// dst(j, i) = src(i, j) for i in [i0, i1), j in [j0, j1); Bytes == 0 - element by element
+template<std::size_t Bytes, typename T, typename SrcRow, typename DstRow>
+[[gnu::always_inline]] inline void transpose_tile_to(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                                                     SrcRow& src_row, DstRow& dst_row)
+{
+    auto i = i0;
+    if constexpr (Bytes != 0)
+    {
+        using Block = TransposeBlock<Bytes, T>;
+        constexpr auto lanes = Block::lanes;
+        for (; i + lanes <= i1; i += lanes)
+        {
+            auto j = j0;
+            for (; j + lanes <= j1; j += lanes)
+            {
+                typename Block::vec rows[lanes];
+                Block::load(rows, src_row, i, j);
+                Block::transpose(rows);
+                Block::store(rows, dst_row, j, i);
+            }
+            for (; j < j1; j++)
+                for (auto r = i; r < i + lanes; r++)
+                    dst_row(j)[r] = src_row(r)[j];
+        }
+    }
+    for (; i < i1; i++)
+    {
+        const T* src = src_row(i);
+        for (auto j = j0; j < j1; j++)
+            dst_row(j)[i] = src[j];
+    }
+}
+
+/*
+ * Swaps block [i0, i1) x [j0, j1) with transposed block [j0, j1) x [i0, i1). Blocks must not
+ * overlap or must be the same diagonal block (i0 == j0, i1 == j1), which is transposed in place.
+ */
+template<std::size_t Bytes, typename T, typename Row>
+[[gnu::always_inline]] inline void swap_transposed_tile(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1, Row& row)
+{
+    bool diagonal = i0 == j0;
+    auto i_full = i0, j_full = j0;
+    if constexpr (Bytes != 0)
+    {
+        using Block = TransposeBlock<Bytes, T>;
+        constexpr auto lanes = Block::lanes;
+        i_full = i0 + (i1 - i0) / lanes * lanes;
+        j_full = j0 + (j1 - j0) / lanes * lanes;
+        for (auto i = i0; i < i_full; i += lanes)
+            for (auto j = diagonal ? i : j0; j < j_full; j += lanes)
+            {
+                typename Block::vec lhs[lanes], rhs[lanes];
+                Block::load(lhs, row, i, j);
+                Block::load(rhs, row, j, i);
+                Block::transpose(lhs);
+                Block::transpose(rhs);
+                Block::store(lhs, row, j, i);
+                Block::store(rhs, row, i, j);
+            }
+    }
+    for (auto i = i0; i < i1; i++)
+        for (auto j = diagonal ? i + 1 : j0; j < j1; j++)
+            if (i >= i_full || j >= j_full)
+                std::swap(row(i)[j], row(j)[i]);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template<typename T, typename SrcRow, typename DstRow>
+__attribute__((target("avx2"))) void transpose_tile_to_avx2(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1,
+                                                           SrcRow& src_row, DstRow& dst_row)
+{
+    transpose_tile_to<32, T>(i0, i1, j0, j1, src_row, dst_row);
+}
+
+template<typename T, typename Row>
+__attribute__((target("avx2"))) void swap_transposed_tile_avx2(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1, Row& row)
+{
+    swap_transposed_tile<32, T>(i0, i1, j0, j1, row);
+}
+#endif
+
+// tile boundaries stay multiples of transpose_tile, so only tiles at the edge are partial
+inline std::size_t transpose_split(std::size_t begin, std::size_t end)
+{
+    auto half = ((end - begin) / 2 + transpose_tile - 1) / transpose_tile * transpose_tile;
+    return begin + half;
+}
+
+template<typename F>
+void transpose_recursive(std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1, F& tile)
+{
+    if (i1 - i0 <= transpose_tile && j1 - j0 <= transpose_tile)
+        return tile(i0, i1, j0, j1);
+
+    if (i1 - i0 >= j1 - j0)
+    {
+        auto mid = transpose_split(i0, i1);
+        transpose_recursive(i0, mid, j0, j1, tile);
+        transpose_recursive(mid, i1, j0, j1, tile);
+    }
+    else
+    {
+        auto mid = transpose_split(j0, j1);
+        transpose_recursive(i0, i1, j0, mid, tile);
+        transpose_recursive(i0, i1, mid, j1, tile);
+    }
+}
+
+// diagonal blocks are transposed in place, pairs of blocks above and below diagonal are swapped
+template<typename F>
+void transpose_square_recursive(std::size_t i0, std::size_t i1, F& tile)
+{
+    if (i1 - i0 <= transpose_tile)
+        return tile(i0, i1, i0, i1);
+
+    auto mid = transpose_split(i0, i1);
+    transpose_square_recursive(i0, mid, tile);
+    transpose_square_recursive(mid, i1, tile);
+    transpose_recursive(i0, mid, mid, i1, tile);
+}
+
+// dst is w x h: dst_row(j)[i] = src_row(i)[j]
+template<typename T, typename SrcRow, typename DstRow>
+void transpose_to(std::size_t h, std::size_t w, SrcRow src_row, DstRow dst_row)
+{
+    auto tile = [&src_row, &dst_row](std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1)
+    {
+        if constexpr (is_simd_available<T>)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            if (simd_level() != SimdLevel::sse2)
+                return transpose_tile_to_avx2<T>(i0, i1, j0, j1, src_row, dst_row);
+#endif
+            transpose_tile_to<16, T>(i0, i1, j0, j1, src_row, dst_row);
+        }
+        else
+            transpose_tile_to<0, T>(i0, i1, j0, j1, src_row, dst_row);
+    };
+    transpose_recursive(0, h, 0, w, tile);
+}
+
+// n x n matrix is transposed in place through its rows
+template<typename T, typename Row>
+void transpose_square_inplace(std::size_t n, Row row)
+{
+    auto tile = [&row](std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1)
+    {
+        if constexpr (is_simd_available<T>)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            if (simd_level() != SimdLevel::sse2)
+                return swap_transposed_tile_avx2<T>(i0, i1, j0, j1, row);
+#endif
+            swap_transposed_tile<16, T>(i0, i1, j0, j1, row);
+        }
+        else
+            swap_transposed_tile<0, T>(i0, i1, j0, j1, row);
+    };
+    transpose_square_recursive(0, n, tile);
+}
+
+/*
+ * Dense h x w array becomes dense w x h array in place: element k = i * w + j goes to
+ * j * h + i = k * h mod (h * w - 1), so elements move along cycles of this permutation,
+ * one bit per element marks moved ones. Every element is moved once, but by jumps over
+ * whole array, so it is much slower than transpose_to and is for memory that cant be doubled.
+ */
+template<typename T>
+void transpose_dense_inplace(T* data, std::size_t h, std::size_t w)
+{
+    if (h <= 1 || w <= 1)
+        return;
+
+    auto n = h * w;
+    std::vector<bool> moved (n);
+    for (std::size_t start = 1; start + 1 < n; start++)
+    {
+        if (moved[start])
+            continue;
+        T val = std::move(data[start]);
+        auto k = start;
+        do
+        {
+            k = k % w * h + k / w;
+            std::swap(val, data[k]);
+            moved[k] = true;
+        } while (k != start);
+    }
+}
+
+} // namespace detail
+} // namespace Matrix
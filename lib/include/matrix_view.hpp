@@ -0,0 +1,268 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "matrix_expression.hpp"
+
+namespace Matrix
+{
+/*
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ * Non-owning window into matrix M: block of it, every k-th row or column,      |
+ * transposed matrix, or any combination of them. Nothing is copied, view       |
+ * goes through row handles of matrix, so it follows swap_row of matrix and     |
+ * is invalidated when matrix is reallocated or moved (view keeps address of    |
+ * matrix). Small matrix with elements inside object (is_inline()) moves its    |
+ * elements too, so move of it invalidates row references and pointers also.    |
+ *                                                                              |
+ * View is leaf of lazy expressions, so it can be used in A + B, assigned to    |
+ * matrix and passed to functions that take matrices. Copy of view is new       |
+ * handle to the same elements and assignment to MatrixView copies elements     |
+ * (MatrixRow has the same assignment, but can't be copied).                    |
+ *++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+ */
+template<typename M, bool IsConst>
+class BasicMatrixView : public detail::ExpressionTag
+{
+public:
+    using matrix_type     = M;
+    using value_type      = typename M::value_type;
+    using size_type       = typename M::size_type;
+    using reference       = std::conditional_t<IsConst, const value_type&, value_type&>;
+    using const_reference = const value_type&;
+    using Row             = typename M::Row;
+
+private:
+    using owner_pointer = std::conditional_t<IsConst, const M*, M*>;
+    using row_handle    = std::conditional_t<IsConst, const Row*, Row*>;
+
+    template<typename, bool> friend class BasicMatrixView;
+
+    // frame is view without transposition: frame_height_ handles of matrix from rows_ with step row_step_,
+    // frame_width_ elements in each of them from col0_ with step col_step_
+    owner_pointer owner_ = nullptr;
+    row_handle rows_ = nullptr;
+    size_type frame_height_ = 0, frame_width_ = 0;
+    size_type row_step_ = 1, col0_ = 0, col_step_ = 1;
+    bool transposed_ = false;
+
+    BasicMatrixView frame_slice(size_type row_first, size_type row_count, size_type row_step,
+                                size_type col_first, size_type col_count, size_type col_step) const
+    {
+        if (row_step == 0 || col_step == 0)
+            throw std::invalid_argument{"step of view must be positive"};
+        if ((row_count && row_first + (row_count - 1) * row_step >= frame_height_) ||
+            (col_count && col_first + (col_count - 1) * col_step >= frame_width_))
+            throw std::out_of_range{"view is out of matrix"};
+
+        BasicMatrixView res (*this);
+        res.rows_ = row_count ? rows_ + row_first * row_step_ : rows_;
+        res.frame_height_ = row_count;
+        res.frame_width_  = col_count;
+        res.row_step_ = row_step_ * row_step;
+        res.col0_     = col0_ + col_first * col_step_;
+        res.col_step_ = col_step_ * col_step;
+        return res;
+    }
+
+public:
+//--------------------------------=| Ctors start |=-----------------------------------------------------
+    BasicMatrixView() = default;
+
+    // whole matrix
+    explicit BasicMatrixView(std::conditional_t<IsConst, const M&, M&> owner)
+    :owner_ {&owner}, rows_ {owner.begin()}, frame_height_ {owner.height()}, frame_width_ {owner.width()}
+    {}
+
+    // h rows of w elements that dont belong to any matrix (MappedMatrix), rows must live while view is used
+    BasicMatrixView(row_handle rows, size_type h, size_type w)
+    :rows_ {rows}, frame_height_ {h}, frame_width_ {w}
+    {}
+
+    BasicMatrixView(const BasicMatrixView&) = default;
+
+    // MatrixView -> ConstMatrixView
+    BasicMatrixView(const BasicMatrixView<M, false>& rhs) requires IsConst
+    :owner_ {rhs.owner_}, rows_ {rhs.rows_}, frame_height_ {rhs.frame_height_}, frame_width_ {rhs.frame_width_},
+     row_step_ {rhs.row_step_}, col0_ {rhs.col0_}, col_step_ {rhs.col_step_}, transposed_ {rhs.transposed_}
+    {}
+//--------------------------------=| Ctors end |=-------------------------------------------------------
+
+//--------------------------------=| Acces start |=-----------------------------------------------------
+    size_type height() const {return transposed_ ? frame_width_ : frame_height_;}
+    size_type width()  const {return transposed_ ? frame_height_ : frame_width_;}
+
+    bool is_square() const {return height() == width();}
+    bool is_scalar() const {return height() == 1 && width() == 1;}
+    bool is_transposed() const {return transposed_;}
+
+    owner_pointer owner() const {return owner_;}
+
+    // rows of view are pieces of rows of matrix, row_data(i) points to row i of view
+    bool is_rowwise() const {return !transposed_ && col_step_ == 1;}
+
+    std::conditional_t<IsConst, const value_type*, value_type*> row_data(size_type i) const
+    {
+        return rows_[i * row_step_].data() + col0_;
+    }
+
+    reference to(size_type i, size_type j) const noexcept
+    {
+        if (transposed_)
+            std::swap(i, j);
+        return rows_[i * row_step_].data()[col0_ + j * col_step_];
+    }
+
+    reference at(size_type i, size_type j) const
+    {
+        if (i >= height() || j >= width())
+            throw std::out_of_range{"try to get element out of view"};
+        return to(i, j);
+    }
+//--------------------------------=| Acces end |=-------------------------------------------------------
+
+//--------------------------------=| Slices start |=----------------------------------------------------
+    BasicMatrixView submatrix(size_type i, size_type j, size_type h, size_type w) const
+    {
+        if (transposed_)
+            return frame_slice(j, w, 1, i, h, 1);
+        return frame_slice(i, h, 1, j, w, 1);
+    }
+
+    // count rows from first with step between them
+    BasicMatrixView rows(size_type first, size_type count, size_type step = 1) const
+    {
+        if (transposed_)
+            return frame_slice(0, frame_height_, 1, first, count, step);
+        return frame_slice(first, count, step, 0, frame_width_, 1);
+    }
+
+    BasicMatrixView cols(size_type first, size_type count, size_type step = 1) const
+    {
+        if (transposed_)
+            return frame_slice(first, count, step, 0, frame_width_, 1);
+        return frame_slice(0, frame_height_, 1, first, count, step);
+    }
+
+    BasicMatrixView row(size_type i) const {return rows(i, 1);}
+    BasicMatrixView col(size_type j) const {return cols(j, 1);}
+
+    BasicMatrixView transposed() const
+    {
+        BasicMatrixView res (*this);
+        res.transposed_ = !transposed_;
+        return res;
+    }
+//--------------------------------=| Slices end |=------------------------------------------------------
+
+//--------------------------------=| Assignment start |=------------------------------------------------
+private:
+    template<typename E>
+    BasicMatrixView& assign(const E& expr)
+    {
+        if (height() != expr.height() || width() != expr.width())
+            throw std::invalid_argument{"Try to assign to view matrix with different height() * width()"};
+
+        if (expr.aliases(*this))
+        {
+            M tmp (expr);
+            return assign(detail::ExprLeaf<M, false>{tmp});
+        }
+
+        for (size_type i = 0; i < height(); i++)
+            if (is_rowwise())
+                detail::expression_row(row_data(i), expr.row_eval(i), width());
+            else
+            {
+                auto src = expr.row_eval(i);
+                for (size_type j = 0; j < width(); j++)
+                {
+                    value_type val;
+                    src.load(val, j);
+                    to(i, j) = std::move(val);
+                }
+            }
+        return *this;
+    }
+
+public:
+    // copies elements, sizes must be equal
+    BasicMatrixView& operator=(const BasicMatrixView& rhs) requires (!IsConst)
+    {
+        return assign(rhs);
+    }
+
+    BasicMatrixView& operator=(const BasicMatrixView&) requires IsConst = delete;
+
+    BasicMatrixView& operator=(const M& rhs) requires (!IsConst)
+    {
+        return assign(detail::ExprLeaf<M, false>{rhs});
+    }
+
+    template<detail::is_matrix_expression E>
+    BasicMatrixView& operator=(const E& expr) requires (!IsConst) && std::is_same_v<typename E::matrix_type, M>
+    {
+        return assign(expr);
+    }
+//--------------------------------=| Assignment end |=--------------------------------------------------
+
+//--------------------------------=| Expression leaf start |=-------------------------------------------
+    // view of the whole dst in the same order can be evaluated in place
+    template<typename D>
+    bool aliases(const D& dst) const
+    {
+        if constexpr (std::is_same_v<D, M>)
+            if (owner_ == &dst && rows_ == dst.begin() && row_step_ == 1 && col0_ == 0 && col_step_ == 1 &&
+                !transposed_ && frame_height_ == dst.height() && frame_width_ == dst.width())
+                return false;
+        return owner_ && detail::storage_overlaps(*owner_, dst);
+    }
+
+    bool donate(M&) {return false;}
+
+    struct RowEval
+    {
+        const value_type* row;  // row of matrix, nullptr for transposed view
+        const Row* rows;        // rows of matrix for transposed view
+        size_type step, col;
+
+        const value_type& at(size_type j) const {return row ? row[j * step] : rows[j * step][col];}
+
+        template<typename V>
+        [[gnu::always_inline]] void load(V& out, size_type j) const
+        {
+            if constexpr (std::is_same_v<V, value_type>)
+                out = at(j);
+            else if (row && step == 1)
+                std::memcpy(&out, row + j, sizeof(V));
+            else
+            {
+                constexpr size_type vl = sizeof(V) / sizeof(value_type);
+                value_type buf[vl];
+                for (size_type k = 0; k < vl; k++)
+                    buf[k] = at(j + k);
+                std::memcpy(&out, buf, sizeof(V));
+            }
+        }
+    };
+
+    RowEval row_eval(size_type i) const
+    {
+        if (transposed_)
+            return {nullptr, rows_, row_step_, col0_ + i * col_step_};
+        return {rows_[i * row_step_].data() + col0_, nullptr, col_step_, 0};
+    }
+
+    M eval() const {return M(*this);}
+//--------------------------------=| Expression leaf end |=---------------------------------------------
+}; // class BasicMatrixView
+
+template<typename M>
+using MatrixView = BasicMatrixView<M, false>;
+
+template<typename M>
+using ConstMatrixView = BasicMatrixView<M, true>;
+
+} // namespace Matrix
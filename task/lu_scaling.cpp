@@ -0,0 +1,53 @@
+#include "matrix_arithmetic.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+using namespace Matrix;
+using MatrixT = MatrixArithmetic<double, true>;
+
+// lu_scaling [SIZE] [MAX_THREADS] - time of blocked LU determinant for 1, 2, 4 ... MAX_THREADS threads
+int main(int argc, char** argv)
+{
+    std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+    std::size_t max_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    max_threads = std::max<std::size_t>(max_threads, 1);
+
+    std::mt19937_64 gen {42};
+    std::uniform_real_distribution<double> dist {-1.0, 1.0};
+    // E + noise keeps determinant far from overflow for any size
+    std::vector<double> data (size * size);
+    for (auto& elem: data)
+        elem = dist(gen) / std::sqrt(static_cast<double>(size));
+    for (std::size_t i = 0; i < size; i++)
+        data[i * size + i] += 1.0;
+    MatrixT matrix {MatrixT::square(size, data.cbegin(), data.cend())};
+
+    double flops = 2.0 / 3.0 * static_cast<double>(size) * size * size;
+    double base_time = 0;
+
+    std::cout << "size " << size << std::endl;
+    std::cout << "threads\ttime, s\tspeedup\tGFLOP/s\tdeterminant" << std::endl;
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    for (auto threads: thread_counts)
+    {
+        ThreadPool pool {threads};
+        auto start = std::chrono::steady_clock::now();
+        double det = matrix.determinant(pool);
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1)
+            base_time = time;
+
+        std::cout << threads << '\t' << time << '\t' << base_time / time << '\t'
+                  << flops / time * 1e-9 << '\t' << det << std::endl;
+    }
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include "matrix_arithmetic.hpp"
+#include "matrix_io.hpp"
+#include <fstream>
 #include <vector>
+#include <cstdlib>
 
 struct DblCmp
 {
@@ -12,24 +15,46 @@ struct DblCmp
 using namespace Matrix;
 using MatrixT = MatrixArithmetic<double, true, DblCmp>;
 
-int main()
+static MatrixT read_matrix(const char* path)
 {
-    std::size_t mat_height = 0;
-    std::cin >> mat_height;
-    std::size_t mat_sz = mat_height * mat_height;
+    if (!path)
+        return read_text<MatrixT>(std::cin);
 
-    try
+    // binary file is mapped and copied once into matrix, text file is parsed straight into matrix
+    if (is_binary_matrix_file(path))
     {
-        std::vector<double> mat_data (mat_sz);
-        for (auto& elem: mat_data)
-            std::cin >> elem;
+        MappedMatrix<double> mapped {path};
+        return MatrixT {mapped.view<MatrixT>()};
+    }
+
+    std::ifstream in {path};
+    if (!in)
+        throw std::runtime_error{std::string{"cant open matrix file "} + path};
+    return read_text<MatrixT>(in);
+}
+
+// optional arguments - number of threads for big matrices and file with matrix (text or binary),
+// without file text of matrix is read from standard input
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+        set_num_threads(std::strtoul(argv[1], nullptr, 10));
 
-        MatrixT matrix {MatrixT::square(mat_height, mat_data.cbegin(), mat_data.cend())};
+    try
+    {
+        MatrixT matrix = read_matrix(argc > 2 ? argv[2] : nullptr);
+        if (!matrix.is_square())
+            throw std::invalid_argument{"matrix in file is not square"};
         std::cout << matrix.determinant() << std::endl;
     }
-    catch (std::bad_alloc)
+    catch (const std::bad_alloc&)
     {
         std::cout << "Bad size" << std::endl;
     }
+    catch (const std::exception& err)
+    {
+        std::cerr << err.what() << std::endl;
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "matrix_arithmetic.hpp"
+#include "matrix_strassen.hpp"
+
+using namespace Matrix;
+
+namespace
+{
+MatrixArithmetic<double, true> test_matrix(std::size_t sz)
+{
+    MatrixArithmetic<double, true> mat (sz, sz);
+    for (std::size_t i = 0; i < sz; i++)
+        for (std::size_t j = 0; j < sz; j++)
+            mat[i][j] = i == j ? static_cast<double>(sz) : static_cast<double>((i * 7 + j * 3) % 5) - 2;
+    return mat;
+}
+} // namespace
+
+TEST(Instrument, counters)
+{
+    static_assert(instrument_enabled);
+    auto lhs = test_matrix(20), rhs = test_matrix(20);
+    instrument_reset();
+
+    auto res = product(lhs, rhs);
+    auto det = lhs.determinant();
+    auto inv = lhs.inverse();
+    auto cpy = res;
+    MatrixArithmetic<double, true> sum = lhs + rhs;
+    auto sq = power(lhs, 5);
+
+    auto snapshot = instrument_snapshot();
+    auto bucket = InstrumentSnapshot::bucket_of(20);
+    EXPECT_EQ(bucket, 5u);
+    EXPECT_EQ(InstrumentSnapshot::bucket_size(bucket), 16u);
+
+    const auto& prod = snapshot.at(Operation::product, bucket);
+    EXPECT_EQ(prod.calls, 1u);
+    EXPECT_EQ(prod.flops, 2u * 20 * 20 * 20);
+    EXPECT_GE(prod.bytes_allocated, 20u * 20 * sizeof(double));
+    EXPECT_EQ(prod.bytes_copied, 0u);
+    EXPECT_EQ(snapshot.total(Operation::product).calls, 1u);
+
+    EXPECT_EQ(snapshot.at(Operation::determinant, bucket).calls, 1u);
+    EXPECT_EQ(snapshot.at(Operation::determinant, bucket).bytes_copied, 20u * 20 * sizeof(double));
+    EXPECT_EQ(snapshot.at(Operation::inverse, bucket).calls, 1u);
+    EXPECT_EQ(snapshot.at(Operation::inverse, bucket).bytes_copied, 20u * 20 * sizeof(double));
+    EXPECT_EQ(snapshot.at(Operation::expression, bucket).calls, 1u);
+    EXPECT_EQ(snapshot.at(Operation::other, 0).bytes_copied, 20u * 20 * sizeof(double));
+
+    // 5 = 101b: two squarings and one multiplication, none of them is counted as product
+    EXPECT_EQ(snapshot.at(Operation::power, bucket).calls, 1u);
+    EXPECT_EQ(snapshot.at(Operation::power, bucket).flops, 3u * 2 * 20 * 20 * 20);
+    EXPECT_EQ(snapshot.total(Operation::transpos).calls, 0u);
+
+    instrument_reset();
+    EXPECT_EQ(instrument_snapshot().total(Operation::product).calls, 0u);
+
+    std::ostringstream os;
+    instrument_snapshot().print(os);
+    EXPECT_EQ(os.str().find("product"), std::string::npos);
+
+    (void)det; (void)inv; (void)cpy; (void)sum; (void)sq;
+}
+
+// small matrices live inline and allocate nothing
+TEST(Instrument, allocations)
+{
+    auto small = test_matrix(2), big = test_matrix(64);
+    instrument_reset();
+
+    auto small_res = product(small, small);
+    auto big_res = product(big, big);
+    auto snapshot = instrument_snapshot();
+    if (small_res.is_inline())
+    {
+        EXPECT_EQ(snapshot.at(Operation::product, InstrumentSnapshot::bucket_of(2)).bytes_allocated, 0u);
+    }
+
+    const auto& prod = snapshot.at(Operation::product, InstrumentSnapshot::bucket_of(64));
+    EXPECT_GE(prod.bytes_allocated, 64u * 64 * sizeof(double));
+    EXPECT_GT(prod.nanoseconds, 0u);
+    (void)small_res; (void)big_res;
+}
+
+// counters of finished threads are kept
+TEST(Instrument, threads)
+{
+    auto mat = test_matrix(8);
+    instrument_reset();
+
+    std::thread worker {[&mat] {auto res = mat.transpos(); (void)res;}};
+    worker.join();
+    auto res = mat.transpos();
+
+    EXPECT_EQ(instrument_snapshot().total(Operation::transpos).calls, 2u);
+    (void)res;
+}
+
+TEST(Instrument, chrome_trace)
+{
+    auto lhs = test_matrix(40), rhs = test_matrix(40);
+    instrument_reset();
+
+    auto untraced = product(lhs, rhs);
+    start_trace();
+    auto res = strassen_product(lhs, rhs, default_pool(), 20);
+    std::thread worker {[&lhs] {auto inv = lhs.inverse(); (void)inv;}};
+    worker.join();
+    stop_trace();
+    auto after = lhs.transpos();
+
+    std::ostringstream os;
+    write_chrome_trace(os);
+    auto trace = os.str();
+
+    EXPECT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(trace.find("\"name\":\"strassen\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\":\"inverse\""), std::string::npos);
+    EXPECT_NE(trace.find("\"flops\":128000"), std::string::npos);
+    EXPECT_EQ(trace.find("\"name\":\"transpos\""), std::string::npos);
+    EXPECT_EQ(trace.find("\"name\":\"product\""), std::string::npos);
+    EXPECT_EQ(instrument_snapshot().total(Operation::product).calls, 1u);
+
+    (void)untraced; (void)res; (void)after;
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
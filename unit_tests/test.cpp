@@ -4,13 +4,86 @@
 #include <vector>
 #include <set>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <filesystem>
+#include <sstream>
 
 #include "matrix_arithmetic.hpp"
+#include "matrix_lu_decomposition.hpp"
+#include "matrix_cholesky.hpp"
+#include "matrix_modular.hpp"
+#include "matrix_static.hpp"
+#include "matrix_batch.hpp"
+#include "matrix_strassen.hpp"
+#include "matrix_sparse.hpp"
+#include "matrix_sparse_solve.hpp"
+#include "matrix_io.hpp"
+#include "matrix_out_of_core.hpp"
 
 //#define PRINT
 
 using namespace Matrix;
 
+// every allocation of test binary is counted to check that operators dont make temporaries
+static std::atomic<std::size_t> allocations_num {0};
+
+// all replacements below go through this pair: aligned_alloc memory is released by free too,
+// and compiler doesn't see malloc / free through inlined new / delete, so it has nothing to mismatch
+[[gnu::noinline]] static void* counted_alloc(std::size_t sz, std::size_t align) noexcept
+{
+    allocations_num++;
+    align = std::max(align, alignof(std::max_align_t));
+    return std::aligned_alloc(align, (std::max<std::size_t>(sz, 1) + align - 1) / align * align);
+}
+
+[[gnu::noinline]] static void counted_free(void* ptr) noexcept {std::free(ptr);}
+
+static void* counted_alloc_or_throw(std::size_t sz, std::size_t align)
+{
+    if (void* ptr = counted_alloc(sz, align))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t sz) {return counted_alloc_or_throw(sz, 0);}
+void* operator new[](std::size_t sz) {return counted_alloc_or_throw(sz, 0);}
+void* operator new(std::size_t sz, std::align_val_t al) {return counted_alloc_or_throw(sz, static_cast<std::size_t>(al));}
+void* operator new[](std::size_t sz, std::align_val_t al) {return counted_alloc_or_throw(sz, static_cast<std::size_t>(al));}
+
+void* operator new(std::size_t sz, const std::nothrow_t&) noexcept {return counted_alloc(sz, 0);}
+void* operator new[](std::size_t sz, const std::nothrow_t&) noexcept {return counted_alloc(sz, 0);}
+void* operator new(std::size_t sz, std::align_val_t al, const std::nothrow_t&) noexcept {return counted_alloc(sz, static_cast<std::size_t>(al));}
+void* operator new[](std::size_t sz, std::align_val_t al, const std::nothrow_t&) noexcept {return counted_alloc(sz, static_cast<std::size_t>(al));}
+
+void operator delete(void* ptr) noexcept {counted_free(ptr);}
+void operator delete[](void* ptr) noexcept {counted_free(ptr);}
+void operator delete(void* ptr, std::size_t) noexcept {counted_free(ptr);}
+void operator delete[](void* ptr, std::size_t) noexcept {counted_free(ptr);}
+void operator delete(void* ptr, std::align_val_t) noexcept {counted_free(ptr);}
+void operator delete[](void* ptr, std::align_val_t) noexcept {counted_free(ptr);}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {counted_free(ptr);}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {counted_free(ptr);}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {counted_free(ptr);}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {counted_free(ptr);}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {counted_free(ptr);}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {counted_free(ptr);}
+
+template<typename F>
+std::size_t count_allocations(F func)
+{
+    std::size_t before = allocations_num;
+    func();
+    return allocations_num - before;
+}
+
 TEST(Constructors, by_1_val)
 {
     MatrixArithmetic<int> mat1 (1, 1, 1);
@@ -154,6 +227,150 @@ TEST(Methods, swap_row)
         EXPECT_EQ(bigmat.to(2, i), origin_row2[i]);
 }
 
+TEST(Methods, row_handle)
+{
+    using Row = MatrixArithmetic<int>::Row;
+    // auto r = mat[0] would share elements with mat while looking like copy,
+    // and std::swap(mat[0], mat[1]) needs move ctor, so neither compiles
+    static_assert(!std::is_copy_constructible_v<Row>);
+    static_assert(!std::is_move_constructible_v<Row>);
+    static_assert(std::is_swappable_v<Row>);
+
+    MatrixArithmetic<int> mat {{1, 2}, {3, 4}};
+    using std::swap;
+    swap(mat[0], mat[1]);
+    EXPECT_EQ(mat, (MatrixArithmetic<int>{{3, 4}, {1, 2}}));
+    swap(mat[0], mat[0]);
+    EXPECT_EQ(mat, (MatrixArithmetic<int>{{3, 4}, {1, 2}}));
+
+    auto& row = mat[0];
+    std::vector<int> copy (row.begin(), row.end());
+    copy[0] = 100;
+    EXPECT_EQ(mat.to(0, 0), 3);
+    row[0] = 100;
+    EXPECT_EQ(mat.to(0, 0), 100);
+
+    mat[1] = mat[0];
+    EXPECT_EQ(mat, (MatrixArithmetic<int>{{100, 4}, {100, 4}}));
+    MatrixArithmetic<int> wide {{1, 2, 3}};
+    EXPECT_THROW(swap(mat[0], wide[0]), std::invalid_argument);
+}
+
+TEST(Methods, contiguous_storage)
+{
+    MatrixArithmetic<double> mat (5, 13, 1.0);
+
+    EXPECT_GE(mat.ld(), mat.width());
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mat.data()) % MatrixArithmetic<double>::alignment, 0);
+    for (std::size_t i = 0; i < mat.height(); i++)
+        EXPECT_EQ(mat[i].data(), mat.data() + i * mat.ld());
+    EXPECT_TRUE(mat.is_contiguous());
+}
+
+TEST(Methods, make_contiguous)
+{
+    MatrixArithmetic<int> mat = {{1, 2}, {3, 4}, {5, 6}, {7, 8}};
+    MatrixArithmetic<int> permuted = {{5, 6}, {1, 2}, {7, 8}, {3, 4}};
+
+    mat.swap_row(0, 2);
+    mat.swap_row(1, 2);
+    mat.swap_row(2, 3);
+    EXPECT_FALSE(mat.is_contiguous());
+    EXPECT_EQ(mat, permuted);
+
+    mat.make_contiguous();
+    EXPECT_TRUE(mat.is_contiguous());
+    EXPECT_EQ(mat, permuted);
+
+    MatrixArithmetic<int> cpy {mat};
+    EXPECT_TRUE(cpy.is_contiguous());
+}
+
+// sizes go over tiles, register blocks and their edges
+TEST(Methods, transpose)
+{
+    auto filled = []<typename T>(std::size_t h, std::size_t w, T)
+    {
+        MatrixArithmetic<T> mat (h, w);
+        for (std::size_t i = 0; i < h; i++)
+            for (std::size_t j = 0; j < w; j++)
+                mat.to(i, j) = static_cast<T>(i * 1000 + j);
+        return mat;
+    };
+
+    auto dbl = filled(37, 70, 0.0);
+    dbl.swap_row(0, 36);
+    EXPECT_EQ(dbl.transpos(), dbl.transposed_view());
+    auto flt = filled(100, 9, 0.0f);
+    EXPECT_EQ(flt.transpos(), flt.transposed_view());
+    auto ints = filled(33, 33, 0);
+    EXPECT_EQ(ints.transpos(), ints.transposed_view());
+    auto lds = filled(5, 3, 0.0L);
+    EXPECT_EQ(lds.transpos(), lds.transposed_view());
+
+    // square one swaps elements through permuted rows and allocates nothing
+    auto sq = filled(45, 45, 0.0);
+    sq.swap_row(3, 40);
+    auto sq_expected = sq.transpos();
+    auto sq_data = sq.data();
+    EXPECT_EQ(count_allocations([&sq] {sq.transpose_inplace();}), 0);
+    EXPECT_EQ(sq, sq_expected);
+    EXPECT_EQ(sq.data(), sq_data);
+
+    // rectangular one keeps its elements, wide one takes only bigger row table; padding of new rows is zeroed
+    for (auto [h, w]: {std::pair<std::size_t, std::size_t>{200, 3}, {40, 10}, {3, 200}, {10, 40}})
+    {
+        auto rect = filled(h, w, 0.0);
+        rect.swap_row(0, 1);
+        auto expected = rect.transpos();
+        auto data = rect.data();
+        rect.transpose_inplace();
+        EXPECT_EQ(rect, expected);
+        EXPECT_EQ(rect.height(), w);
+        EXPECT_TRUE(rect.ld() == expected.ld() || rect.ld() == rect.width());
+        EXPECT_TRUE(rect.is_contiguous());
+        EXPECT_EQ(rect.data(), data);
+        for (std::size_t i = 0; i < rect.height(); i++)
+            for (std::size_t j = rect.width(); j < rect.ld(); j++)
+                EXPECT_EQ(rect[i].data()[j], 0.0);
+
+        // back and forth again over the same elements, handles left after tall shape are not used by wide one
+        rect.transpose_inplace();
+        EXPECT_EQ(rect.height(), h);
+        EXPECT_EQ(rect.end() - rect.begin(), static_cast<std::ptrdiff_t>(h));
+        rect.transpose_inplace();
+        EXPECT_EQ(rect, expected);
+        EXPECT_EQ(rect.data(), data);
+    }
+
+    // small wide matrix keeps elements inside object, row table grows apart and goes with moves
+    // (move allocates nothing and target stays inline), tall one leaves empty handles after wide shape
+    MatrixArithmetic<double> wide (1, 16), tall {{1, 2}, {3, 4}, {5, 6}, {7, 8}};
+    for (std::size_t j = 0; j < 16; j++)
+        wide.to(0, j) = j;
+    for (auto* small: {&wide, &tall})
+    {
+        auto expected = small->transpos();
+        bool small_inline = small->is_inline();
+        small->transpose_inplace();
+        MatrixArithmetic<double> small_moved;
+        EXPECT_EQ(count_allocations([&] {small_moved = std::move(*small);}), 0);
+        EXPECT_EQ(small_moved.is_inline(), small_inline);
+        EXPECT_EQ(small_moved, expected);
+        small_moved.transpose_inplace();
+        EXPECT_EQ(count_allocations([&] {*small = std::move(small_moved);}), 0);
+        EXPECT_EQ(small->is_inline(), small_inline);
+        EXPECT_EQ(*small, transpos(expected));
+        small->transpose_inplace();
+        EXPECT_EQ(*small, expected);
+    }
+
+    MatrixArithmetic<double> empty (0, 4);
+    empty.transpose_inplace();
+    EXPECT_EQ(empty.height(), 4);
+    EXPECT_EQ(empty.width(), 0);
+}
+
 TEST(Methods, operator_eq)
 {
     MatrixArithmetic<int> mat1 = {{1, 1, 2}, {23, 56, 78}, {24, 7, -9}};
@@ -200,6 +417,10 @@ struct DblCmp {
     }
 };
 
+struct AbsCmp {
+    bool operator()(double lhs, double rhs) const {return std::abs(lhs - rhs) <= 1e-9;}
+};
+
 TEST(Methods, det_for_double)
 {
     DblCmp dbl_cmp {};
@@ -229,6 +450,95 @@ TEST(Methods, det_for_double)
     EXPECT_TRUE(dbl_cmp(mat7.determinant(), -0.0));
 }
 
+TEST(Methods, det_blocked_lu)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    const std::size_t sz = 300;
+
+    // det(E + u * v^T) = 1 + v^T * u
+    MatrixT mat = MatrixT::eye(sz);
+    double det_example = 1;
+    for (std::size_t i = 0; i < sz; i++)
+    {
+        double u_i = (static_cast<double>(i % 7) - 3) * 0.1;
+        det_example += u_i * (static_cast<double>(i % 5) - 2) * 0.1;
+        for (std::size_t j = 0; j < sz; j++)
+            mat.to(i, j) += u_i * (static_cast<double>(j % 5) - 2) * 0.1;
+    }
+
+    ThreadPool one {1}, four {4};
+    double det1 = mat.determinant(one);
+    double det4 = mat.determinant(four);
+
+    EXPECT_NEAR(det1, det_example, 1e-9);
+    EXPECT_EQ(det1, det4);
+    EXPECT_EQ(det1, mat.determinant());
+
+    mat.swap_row(0, 1);
+    EXPECT_NEAR(mat.determinant(four), -det_example, 1e-9);
+
+    MatrixT singular (sz, sz, 1.0);
+    EXPECT_EQ(singular.determinant(four), 0.0);
+}
+
+TEST(Methods, blocked_lu_same_as_unblocked)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    const std::size_t sz = 200;
+    MatrixT mat (sz, sz);
+    for (std::size_t i = 0; i < sz; i++)
+        for (std::size_t j = 0; j < sz; j++)
+            mat.to(i, j) = static_cast<double>((i * 31 + j * 17) % 29) - 14 + (i == j ? 50 : 0);
+
+    ThreadPool four {4};
+    std::vector<std::size_t> pivots_unblocked, pivots_blocked;
+    MatrixT unblocked {mat}, blocked {mat};
+    auto sign_unblocked = detail::blocked_lu(unblocked, pivots_unblocked, detail::DefaultAbs<double>{}, DblCmp{}, four, sz);
+    auto sign_blocked   = detail::blocked_lu(blocked,   pivots_blocked,   detail::DefaultAbs<double>{}, DblCmp{}, four, 24);
+
+    EXPECT_EQ(sign_unblocked, sign_blocked);
+    EXPECT_EQ(pivots_unblocked, pivots_blocked);
+    for (std::size_t i = 0; i < sz; i++)
+        for (std::size_t j = 0; j < sz; j++)
+            EXPECT_NEAR(unblocked.to(i, j), blocked.to(i, j), 1e-9 * (1 + std::abs(unblocked.to(i, j))));
+}
+
+TEST(ThreadPool, parallel_for)
+{
+    ThreadPool pool {4};
+    std::vector<int> data (1000, 0);
+    pool.parallel_for(0, data.size(), 7, [&data](std::size_t lo, std::size_t hi)
+    {
+        for (auto i = lo; i < hi; i++)
+            data[i] += static_cast<int>(i);
+    });
+    for (std::size_t i = 0; i < data.size(); i++)
+        EXPECT_EQ(data[i], static_cast<int>(i));
+
+    EXPECT_THROW(pool.parallel_for(0, 100, 1, [](std::size_t lo, std::size_t) {if (lo == 50) throw std::runtime_error{"chunk"};}),
+                 std::runtime_error);
+    EXPECT_EQ(pool.num_threads(), 4);
+}
+
+TEST(ThreadPool, parallel_for_stealing)
+{
+    ThreadPool pool {4};
+    std::vector<std::atomic<int>> hits (1000);
+    pool.parallel_for_stealing(0, hits.size(), 3, [&hits](std::size_t lo, std::size_t hi)
+    {
+        // uneven chunks make idle threads steal
+        if (lo < 30)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (auto i = lo; i < hi; i++)
+            hits[i]++;
+    });
+    for (const auto& hit: hits)
+        EXPECT_EQ(hit.load(), 1);
+
+    EXPECT_THROW(pool.parallel_for_stealing(0, 100, 1, [](std::size_t lo, std::size_t) {if (lo == 50) throw std::runtime_error{"chunk"};}),
+                 std::runtime_error);
+}
+
 TEST(Methods, inverse)
 {
     MatrixArithmetic<double, true, DblCmp> mat1 = {{1, 12, 3}, {23, 56.8, 78}, {43, 32, 7}};
@@ -238,6 +548,340 @@ TEST(Methods, inverse)
     EXPECT_EQ(mat1.inverse().inverse(), mat1);
     EXPECT_EQ(mat2.inverse().inverse(), mat2);
     EXPECT_EQ(eye_mat.inverse(), eye_mat);
+
+    // small matrices are eliminated on calling thread, pool gives the same result
+    ThreadPool pool {2};
+    EXPECT_EQ(mat1.inverse_pair(pool).second, mat1.inverse());
+
+    // singularity is decided by cmp of matrix, not by exact zero
+    MatrixArithmetic<double, true, AbsCmp> almost_singular = {{1, 2}, {1, 2 + 1e-12}};
+    EXPECT_FALSE(almost_singular.inverse_pair().first);
+    EXPECT_FALSE(almost_singular.inverse_pair(pool).first);
+}
+
+TEST(LUDecomposition, determinant_solve_inverse)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    DblCmp dbl_cmp {};
+    MatrixT mat = {{1, 12, 4.7, -0.3}, {-78, 0.8, 9.6, 87}, {-5, -0.9, 4.7, 21.8}, {0, 2, 7, 9}};
+    LUDecomposition lu {mat};
+
+    EXPECT_FALSE(lu.is_singular());
+    EXPECT_TRUE(dbl_cmp(lu.determinant(), -57462.22));
+
+    MatrixT permuted = mat;
+    for (std::size_t k = 0; k < lu.size(); k++)
+        permuted.swap_row(k, lu.pivots()[k]);
+    EXPECT_EQ(product(lu.lower(), lu.upper()), permuted);
+
+    MatrixT rhs = {{1, 2}, {3, 4}, {5, 6}, {7, 8}};
+    EXPECT_EQ(product(mat, lu.solve(rhs)), rhs);
+
+    std::vector<double> rhs_vec = {1, -1, 2, 0.5};
+    auto x = lu.solve(rhs_vec);
+    MatrixT x_mat (4, 1, x.begin(), x.end());
+    EXPECT_EQ(product(mat, x_mat), MatrixT(4, 1, rhs_vec.begin(), rhs_vec.end()));
+
+    auto must_be_eye = product(mat, lu.inverse());
+    for (std::size_t i = 0; i < 4; i++)
+        for (std::size_t j = 0; j < 4; j++)
+            EXPECT_NEAR(must_be_eye.to(i, j), i == j ? 1.0 : 0.0, 1e-12);
+    EXPECT_EQ(lu.inverse(), mat.inverse());
+
+    // solves run on pool given to ctor
+    ThreadPool serial {1};
+    LUDecomposition lu_serial (mat, serial);
+    EXPECT_EQ(lu_serial.solve(rhs), lu.solve(rhs));
+    EXPECT_EQ(lu_serial.solve(rhs_vec), x);
+}
+
+TEST(LUDecomposition, singular)
+{
+    MatrixArithmetic<double, true, DblCmp> mat = {{1, 2, 3}, {2, 4, 6}, {1, 0, 1}};
+    LUDecomposition lu {mat};
+
+    EXPECT_TRUE(lu.is_singular());
+    EXPECT_EQ(lu.determinant(), 0.0);
+    EXPECT_THROW(lu.inverse(), std::invalid_argument);
+    EXPECT_THROW(lu.solve(std::vector<double>{1, 2, 3}), std::invalid_argument);
+    EXPECT_FALSE(mat.inverse_pair().first);
+}
+
+TEST(Cholesky, determinant_solve_inverse)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    MatrixT mat = {{4, 12, -16}, {12, 37, -43}, {-16, -43, 98}};
+    CholeskyDecomposition chol {mat};
+
+    EXPECT_EQ(chol.lower(), MatrixT({{2, 0, 0}, {6, 1, 0}, {-8, 5, 3}}));
+    EXPECT_NEAR(chol.determinant(), 36, 1e-9);
+    EXPECT_NEAR(chol.log_determinant(), std::log(36.0), 1e-12);
+
+    MatrixT rhs = {{1, 2}, {3, 4}, {5, 6}};
+    EXPECT_EQ(product(mat, chol.solve(rhs)), rhs);
+    EXPECT_EQ(chol.inverse(), mat.inverse());
+    EXPECT_THROW(chol.solve(std::vector<double>{1, 2}), std::invalid_argument);
+
+    EXPECT_THROW(CholeskyDecomposition(MatrixT{{1, 2}, {2, 1}}), std::invalid_argument);
+    EXPECT_THROW(CholeskyDecomposition(MatrixT(2, 3)), std::invalid_argument);
+}
+
+TEST(Cholesky, blocked)
+{
+    // several panels on threads, B * B^T + n * I is positive definite
+    const std::size_t n = 300;
+    MatrixArithmetic<double, true> b (n, n);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < n; j++)
+            b.to(i, j) = double(std::rand() % 2001 - 1000) / 1000;
+    MatrixArithmetic<double, true> mat = product(b, b.transpos()) + MatrixArithmetic<double, true>::eye(n) * double(n);
+
+    ThreadPool pool {4};
+    CholeskyDecomposition chol (mat, pool);
+    LUDecomposition lu (mat, pool);
+    // determinant itself overflows double
+    double log_det = 0;
+    auto u = lu.upper();
+    for (std::size_t i = 0; i < n; i++)
+        log_det += std::log(std::abs(u.to(i, i)));
+    EXPECT_TRUE(std::isinf(lu.determinant()));
+    EXPECT_NEAR(chol.log_determinant(), log_det, 1e-8);
+
+    auto l = chol.lower();
+    auto restored = product(l, l.transpos());
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < n; j++)
+            EXPECT_NEAR(restored.to(i, j), mat.to(i, j), 1e-9);
+
+    std::vector<double> rhs (n);
+    for (std::size_t i = 0; i < n; i++)
+        rhs[i] = double(i % 7) - 3;
+    auto x = chol.solve(rhs), expected = lu.solve(rhs);
+    for (std::size_t i = 0; i < n; i++)
+        EXPECT_NEAR(x[i], expected[i], 1e-12);
+
+    // lower triangle is enough
+    auto upper_garbage = mat;
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = i + 1; j < n; j++)
+            upper_garbage.to(i, j) = -1e6;
+    EXPECT_NEAR(CholeskyDecomposition(std::move(upper_garbage), pool).log_determinant(), chol.log_determinant(), 1e-9);
+
+    mat.to(n - 1, n - 1) = -1;
+    EXPECT_THROW(CholeskyDecomposition(mat, pool), std::invalid_argument);
+}
+
+TEST(LDLT, indefinite)
+{
+    using MatrixT = MatrixArithmetic<double, true>;
+    // zero diagonal needs 2 x 2 pivots
+    MatrixT small = {{0, 1, 2}, {1, 0, 3}, {2, 3, 0}};
+    LDLTDecomposition ldlt_small {small};
+    EXPECT_NEAR(ldlt_small.determinant(), 12, 1e-12);
+
+    const std::size_t n = 200;
+    MatrixT mat (n, n);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j <= i; j++)
+            mat.to(i, j) = mat.to(j, i) = double(std::rand() % 2001 - 1000) / 1000;
+
+    LDLTDecomposition ldlt (mat);
+    LUDecomposition lu (mat);
+    EXPECT_FALSE(ldlt.is_singular());
+    auto [sign, log_abs] = ldlt.sign_log_determinant();
+    EXPECT_EQ(sign, lu.determinant() < 0 ? -1 : 1);
+    EXPECT_NEAR(log_abs, std::log(std::abs(lu.determinant())), 1e-8);
+
+    // P * A * P^T = L * D * L^T
+    auto perm = ldlt.permutation();
+    auto restored = product(product(ldlt.lower(), ldlt.block_diagonal()), ldlt.lower().transpos());
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < n; j++)
+            EXPECT_NEAR(restored.to(i, j), mat.to(perm[i], perm[j]), 1e-9);
+
+    MatrixT rhs (n, 3);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < 3; j++)
+            rhs.to(i, j) = double((i + j) % 5) - 2;
+    auto x = ldlt.solve(rhs), expected = lu.solve(rhs);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < 3; j++)
+            EXPECT_NEAR(x.to(i, j), expected.to(i, j), 1e-8);
+
+    LDLTDecomposition singular {MatrixT{{1, 2}, {2, 4}}};
+    EXPECT_TRUE(singular.is_singular());
+    EXPECT_EQ(singular.sign_log_determinant().first, 0);
+    EXPECT_THROW(singular.inverse(), std::invalid_argument);
+}
+
+TEST(Cholesky, packed)
+{
+    using MatrixT = MatrixArithmetic<double, true>;
+    const std::size_t n = 50;
+    MatrixT mat (n, n);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j <= i; j++)
+            mat.to(i, j) = mat.to(j, i) = i == j ? double(n) : double(std::rand() % 2001 - 1000) / 1000;
+
+    PackedSymmetricMatrix packed {mat};
+    EXPECT_EQ(packed.packed_size(), n * (n + 1) / 2);
+    EXPECT_EQ(packed.to(3, 7), mat.to(7, 3));
+    EXPECT_EQ(packed.to_dense(), mat);
+
+    PackedCholesky chol {packed};
+    CholeskyDecomposition dense {mat};
+    EXPECT_NEAR(chol.log_determinant(), dense.log_determinant(), 1e-10);
+    EXPECT_NEAR(chol.factor().to(n - 1, 2), dense.lower().to(n - 1, 2), 1e-12);
+
+    std::vector<double> rhs (n, 1.0);
+    auto x = chol.solve(rhs), expected = dense.solve(rhs);
+    for (std::size_t i = 0; i < n; i++)
+        EXPECT_NEAR(x[i], expected[i], 1e-12);
+
+    auto inv = chol.inverse();
+    auto inv_dense = dense.inverse();
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < n; j++)
+            EXPECT_NEAR(inv.to(i, j), inv_dense.to(i, j), 1e-12);
+
+    packed.to(0, 0) = -1;
+    EXPECT_THROW(PackedCholesky{std::move(packed)}, std::invalid_argument);
+}
+
+TEST(Modular, mod_int)
+{
+    using Mod = ModInt<998244353>;
+    EXPECT_EQ(Mod{-1}.value(), 998244352u);
+    EXPECT_EQ((Mod{3} * Mod{3}.inverse()).value(), 1u);
+    EXPECT_EQ(Mod{2}.pow(998244352), Mod{1});
+    EXPECT_EQ((Mod{7} / Mod{2} * Mod{2}).value(), 7u);
+    EXPECT_EQ(Mod{1u << 31}.value(), (1u << 31) % 998244353);
+    EXPECT_THROW(Mod{}.inverse(), std::invalid_argument);
+
+    // zero on diagonal needs pivot, Gauss and LU take the first nonzero element
+    using MatrixT = MatrixArithmetic<Mod, true>;
+    MatrixT mat = {{0, 2, 1}, {3, 0, 5}, {1, 4, 0}};
+    MatrixArithmetic<long long> exact = {{0, 2, 1}, {3, 0, 5}, {1, 4, 0}};
+    EXPECT_EQ(mat.determinant(), Mod{exact.determinant()});
+    EXPECT_EQ(product(mat, mat.inverse()), MatrixT::eye(3));
+
+    std::vector<Mod> rhs_vec {1, 2, 3};
+    MatrixT rhs (3, 1, rhs_vec.begin(), rhs_vec.end());
+    EXPECT_EQ(product(mat, mat.solve(rhs)), rhs);
+}
+
+TEST(Modular, determinant)
+{
+    // Vandermonde matrix of 1 ... 12: det = 0! * 1! * ... * 11!
+    const std::size_t n = 12;
+    MatrixArithmetic<long long> vandermonde (n, n);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < n; j++)
+            vandermonde.to(i, j) = j == 0 ? 1 : vandermonde.to(i, j - 1) * static_cast<long long>(i + 1);
+    auto det = modular_determinant(vandermonde);
+    EXPECT_EQ(det.to_string(), "265790267296391946810949632000000000");
+    EXPECT_EQ(det.sign(), 1);
+    EXPECT_THROW(det.to<long long>(), std::overflow_error);
+
+    // rows exchanged: -(10^9)^5
+    MatrixArithmetic<int> upper (5, 5);
+    for (std::size_t i = 0; i < 5; i++)
+        for (std::size_t j = i; j < 5; j++)
+            upper.to(i, j) = i == j ? 1000000000 : int(i * 7 + j) - 10;
+    upper.swap_row(1, 3);
+    auto big = modular_determinant(upper);
+    EXPECT_EQ(big.to_string(), "-1" + std::string(45, '0'));
+    EXPECT_NEAR(big.to_double(), -1e45, 1e31);
+
+    // small values go through Bareiss on long long without overflow
+    MatrixArithmetic<int> mat (8, 8);
+    MatrixArithmetic<long long> exact (8, 8);
+    for (std::size_t i = 0; i < 8; i++)
+        for (std::size_t j = 0; j < 8; j++)
+            exact.to(i, j) = mat.to(i, j) = std::rand() % 19 - 9;
+    ThreadPool pool {4};
+    EXPECT_EQ(modular_determinant(mat, pool).to<long long>(), exact.determinant());
+    EXPECT_EQ(modular_determinant(mat).to<int>(), exact.determinant());
+
+    MatrixArithmetic<int> singular = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    EXPECT_TRUE(modular_determinant(singular).is_zero());
+    EXPECT_TRUE(modular_determinant(MatrixArithmetic<int>(3, 3)).is_zero());
+    EXPECT_EQ(modular_determinant(MatrixArithmetic<unsigned>{{2, 1}, {1, 1}}).to<unsigned>(), 1u);
+    EXPECT_THROW(modular_determinant(MatrixArithmetic<int>{{0, 1}, {1, 0}}).to<unsigned>(), std::overflow_error);
+    EXPECT_THROW(modular_determinant(MatrixArithmetic<int>(2, 3)), std::invalid_argument);
+}
+
+TEST(Modular, rank)
+{
+    MatrixArithmetic<int> singular = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    MatrixArithmetic<int> wide = {{1, 2, 3, 4}, {2, 4, 6, 8}, {0, 0, 0, 1}};
+    MatrixArithmetic<int> tall = {{0, 0}, {0, 3}, {0, 6}, {1, 0}};
+    EXPECT_EQ(modular_rank(singular), 2);
+    EXPECT_EQ(modular_rank(wide), 2);
+    EXPECT_EQ(modular_rank(tall), 2);
+    EXPECT_EQ(modular_rank(MatrixArithmetic<int>(4, 5)), 0);
+    EXPECT_EQ(modular_rank(MatrixArithmetic<long long>::eye(6)), 6);
+}
+
+TEST(Methods, solve)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    MatrixT mat = {{1, 12, 3}, {23, 56.8, 78}, {43, 32, 7}};
+    MatrixT rhs = {{1, 0.5}, {-2, 3}, {7, 1}};
+
+    EXPECT_EQ(product(mat, solve(mat, rhs)), rhs);
+    EXPECT_EQ(solve(MatrixT{mat}, rhs), mat.solve(rhs));
+    EXPECT_EQ(mat.solve(MatrixT::eye(3)), mat.inverse());
+
+    MatrixT singular = {{1, 2, 3}, {2, 4, 6}, {1, 0, 1}};
+    EXPECT_THROW(singular.solve(rhs), std::invalid_argument);
+    EXPECT_THROW(mat.solve(MatrixT(2, 1, 1.0)), std::invalid_argument);
+}
+
+TEST(Methods, solve_blocked)
+{
+    // more rows than one block and enough right-hand sides for GEMM update
+    const std::size_t n = 300, m = 11;
+    MatrixArithmetic<double, true> mat (n, n);
+    MatrixArithmetic<double, true> expected (n, m);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        for (std::size_t j = 0; j < n; j++)
+            mat.to(i, j) = static_cast<double>((i * 7 + j * 13) % 17) - 8.0;
+        mat.to(i, i) += 4.0 * n;
+        for (std::size_t j = 0; j < m; j++)
+            expected.to(i, j) = static_cast<double>((i + 3 * j) % 5) - 2.0;
+    }
+    mat.swap_row(0, n - 1);
+
+    ThreadPool pool {4};
+    auto res = mat.solve(product(mat, expected), pool);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < m; j++)
+            EXPECT_NEAR(res.to(i, j), expected.to(i, j), 1e-10);
+
+    // without pool big system goes to default_pool(), small one stays on calling thread
+    EXPECT_EQ(mat.solve(product(mat, expected)), res);
+    MatrixArithmetic<double, true> small = {{2, 1}, {1, 3}};
+    EXPECT_EQ(small.solve(MatrixArithmetic<double, true>{3, 4}), small.solve(MatrixArithmetic<double, true>{3, 4}, pool));
+}
+
+TEST(Methods, solve_fraction_free)
+{
+    MatrixArithmetic<long long> mat = {{2, 1}, {1, 3}};
+    MatrixArithmetic<long long> rhs = {1, 2};
+    auto [num, denom] = solve_fraction_free(mat, rhs);
+    EXPECT_EQ(denom, 5);
+    EXPECT_EQ(num, (MatrixArithmetic<long long>{1, 3}));
+
+    MatrixArithmetic<long long> mat3 = {{0, 3, -1}, {4, 1, 2}, {-2, 5, 7}};
+    MatrixArithmetic<long long> rhs3 = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    auto [num3, denom3] = mat3.solve_fraction_free(rhs3);
+    EXPECT_EQ(denom3, std::abs(mat3.determinant()));
+    EXPECT_EQ(product(mat3, num3), rhs3 * denom3);
+
+    MatrixArithmetic<long long> singular = {{1, 2}, {2, 4}};
+    EXPECT_THROW(singular.solve_fraction_free(rhs), std::invalid_argument);
 }
 
 TEST(Methods, det_for_other)
@@ -357,6 +1001,149 @@ TEST(Operators, operator_div)
     EXPECT_EQ(half_mat, mat / 2);
 }
 
+TEST(Operators, elementwise_wide)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    std::vector<double> lhs_data (7 * 37), rhs_data (7 * 37);
+    for (std::size_t i = 0; i < lhs_data.size(); i++)
+    {
+        lhs_data[i] = static_cast<double>(i) * 0.5;
+        rhs_data[i] = 3.0 - static_cast<double>(i % 11);
+    }
+    MatrixT lhs (7, 37, lhs_data.begin(), lhs_data.end());
+    MatrixT rhs (7, 37, rhs_data.begin(), rhs_data.end());
+    rhs.swap_row(1, 5);
+
+    MatrixT sum = lhs + rhs, diff = lhs - rhs, neg = -lhs, twice = lhs * 2.0, half = lhs / 2.0;
+    for (std::size_t i = 0; i < 7; i++)
+        for (std::size_t j = 0; j < 37; j++)
+        {
+            EXPECT_DOUBLE_EQ(sum.to(i, j),   lhs.to(i, j) + rhs.to(i, j));
+            EXPECT_DOUBLE_EQ(diff.to(i, j),  lhs.to(i, j) - rhs.to(i, j));
+            EXPECT_DOUBLE_EQ(neg.to(i, j),   -lhs.to(i, j));
+            EXPECT_DOUBLE_EQ(twice.to(i, j), lhs.to(i, j) * 2.0);
+            EXPECT_DOUBLE_EQ(half.to(i, j),  lhs.to(i, j) / 2.0);
+        }
+}
+
+TEST(Operators, axpy)
+{
+    MatrixArithmetic lhs = {{12, -3, 4, 5, 6, 7, 8, 9, 10}, {31, -5, 8}};
+    MatrixArithmetic rhs = {{1, 0, 3, 1, 1, 1, 1, 1, 1}, {12, 3, 4}};
+    MatrixArithmetic example = lhs + 3 * rhs;
+
+    EXPECT_EQ(axpy(lhs, 3, rhs), example);
+    EXPECT_EQ(lhs, example);
+    EXPECT_THROW(lhs.axpy(1, MatrixArithmetic{1}), std::invalid_argument);
+}
+
+TEST(Operators, lazy_expression)
+{
+    using MatrixT = MatrixArithmetic<double>;
+    MatrixT a (5, 21), b (5, 21), c (5, 21);
+    for (std::size_t i = 0; i < 5; i++)
+        for (std::size_t j = 0; j < 21; j++)
+        {
+            a.to(i, j) = static_cast<double>(i * 21 + j);
+            b.to(i, j) = static_cast<double>(j % 4) - 1.5;
+            c.to(i, j) = static_cast<double>(i) * 0.25;
+        }
+    a.swap_row(0, 3);
+
+    MatrixT res = a + b - c * 2.0;
+    MatrixT neg = -(a - b) / 4.0;
+    for (std::size_t i = 0; i < 5; i++)
+        for (std::size_t j = 0; j < 21; j++)
+        {
+            EXPECT_DOUBLE_EQ(res.to(i, j), a.to(i, j) + b.to(i, j) - c.to(i, j) * 2.0);
+            EXPECT_DOUBLE_EQ(neg.to(i, j), -(a.to(i, j) - b.to(i, j)) / 4.0);
+        }
+
+    // temporary matrix is kept inside expression
+    auto expr = MatrixT(5, 21, 1.0) + b;
+    EXPECT_EQ(eval(expr), b + MatrixT(5, 21, 1.0));
+    EXPECT_EQ(expr.eval(), expr);
+
+    MatrixT acc = a;
+    acc += b * 3.0 - c;
+    EXPECT_EQ(acc, a + 3.0 * b - c);
+
+    // destination is operand too
+    MatrixT self = a;
+    self = self + self * 2.0;
+    EXPECT_EQ(self, a * 3.0);
+    self = MatrixT{1.0} + MatrixT{2.0};
+    EXPECT_EQ(scalar_cast(self), 3.0);
+
+    EXPECT_THROW(a + MatrixT(2, 2), std::invalid_argument);
+    EXPECT_THROW(acc -= MatrixT(2, 2) * 2.0, std::invalid_argument);
+}
+
+namespace
+{
+struct Derived : MatrixArithmetic<double>
+{
+    using MatrixArithmetic<double>::MatrixArithmetic;
+};
+} // namespace
+
+TEST(Operators, derived_operands)
+{
+    using MatrixT = MatrixArithmetic<double>;
+    Derived a {{1, 2}, {3, 4}};
+    MatrixT b {{10, 20}, {30, 40}};
+
+    // operators take derived matrices as their MatrixArithmetic base
+    MatrixT sum = a + b;
+    EXPECT_EQ(sum, (MatrixT{{11, 22}, {33, 44}}));
+    EXPECT_EQ(a - a, MatrixT(2, 2));
+    EXPECT_EQ(-a * 2.0, (MatrixT{{-2, -4}, {-6, -8}}));
+    EXPECT_EQ((Derived{{2, 4}} / 2.0), (MatrixT{{1, 2}}));
+    EXPECT_TRUE(a == a);
+    EXPECT_TRUE(a != b);
+    EXPECT_EQ(product(a + b, a), product(sum, static_cast<const MatrixT&>(a)));
+}
+
+TEST(Operators, rvalue_operands_reuse_buffers)
+{
+    using MatrixT = MatrixArithmetic<double>;
+    MatrixT a (20, 30, 1.0), b (20, 30, 2.0), c (20, 30, 3.0), res;
+    const std::size_t one_matrix = count_allocations([] {MatrixT tmp (20, 30);});
+
+    // one matrix for result, nothing for a + b and (a + b) + c
+    EXPECT_EQ(count_allocations([&] {res = a + b + c - a * 2.0;}), one_matrix);
+    EXPECT_EQ(res, MatrixT(20, 30, 4.0));
+
+    // same size: written in place
+    EXPECT_EQ(count_allocations([&] {res = b - c / 2.0;}), 0);
+    EXPECT_EQ(res, MatrixT(20, 30, 0.5));
+
+    // rvalue operand gives its buffer to result
+    MatrixT x (a), y (a), z (a);
+    EXPECT_EQ(count_allocations([&] {res = std::move(x) + b + c;}), 0);
+    EXPECT_EQ(res, MatrixT(20, 30, 6.0));
+    EXPECT_EQ(count_allocations([&] {MatrixT tmp = c - std::move(y) * 2.0; res = std::move(tmp);}), 0);
+    EXPECT_EQ(res, MatrixT(20, 30, 1.0));
+    // 1 x 1 matrix is inline
+    const std::size_t scalar_matrix = detail::MatrixStorage<double>::inline_bytes ? 0 : one_matrix;
+    EXPECT_EQ(count_allocations([&] {res = product(std::move(z), MatrixT{3.0});}), scalar_matrix);
+    EXPECT_EQ(res, MatrixT(20, 30, 3.0));
+
+    // result of product is reused for sum
+    MatrixT big (30, 30, 1.0);
+    EXPECT_EQ(count_allocations([&] {MatrixT tmp = product(a, big) + c;}), one_matrix);
+}
+
+TEST(Operators, lazy_expression_other_types)
+{
+    MatrixArithmetic<int> imat = {{1, 2, 3}, {4, 5, 6}};
+    EXPECT_EQ(imat * 2 - imat / 2, (MatrixArithmetic<int>{{2, 3, 5}, {6, 8, 9}}));
+
+    MatrixArithmetic<long double> lmat = {{1.5L, -2}, {0, 4}};
+    EXPECT_EQ(-lmat + lmat * 2.0L, lmat);
+    EXPECT_EQ(transpos(lmat + lmat), (MatrixArithmetic<long double>{{3, 0}, {-4, 8}}));
+}
+
 TEST(Operators, cast_to_scalar)
 {
     MatrixArithmetic scalar_mat {4};
@@ -364,16 +1151,34 @@ TEST(Operators, cast_to_scalar)
 
     EXPECT_EQ(scalar_cast(scalar_mat) + 5, 9);
     EXPECT_EQ(scalar_cast(MatrixArithmetic<int>(5) + scalar_mat), 9);  
-    EXPECT_THROW(auto var = scalar_cast(mat) + 5, std::invalid_argument);
+    EXPECT_THROW([[maybe_unused]] auto var = scalar_cast(mat) + 5, std::invalid_argument);
 }
 
 TEST(Methods, power)
 {
     MatrixArithmetic eye_mat {MatrixArithmetic<double, true, DblCmp>::eye(10)};
     try {EXPECT_EQ(power(eye_mat, -5), eye_mat);}
-    catch (std::invalid_argument) {std::cerr << "first" << std::endl; throw;}
+    catch (const std::invalid_argument&) {std::cerr << "first" << std::endl; throw;}
     try {EXPECT_EQ(power(eye_mat, 5), eye_mat);}
-    catch (std::invalid_argument) {std::cerr << "second" << std::endl; throw;}
+    catch (const std::invalid_argument&) {std::cerr << "second" << std::endl; throw;}
+}
+
+TEST(Methods, power_by_squaring)
+{
+    // [[1, 1], [1, 0]]^n = [[F(n + 1), F(n)], [F(n), F(n - 1)]]
+    MatrixArithmetic<long long> fib = {{1, 1}, {1, 0}};
+    EXPECT_EQ(power(fib, 1), fib);
+    EXPECT_EQ(power(fib, 10), (MatrixArithmetic<long long>{{89, 55}, {55, 34}}));
+    EXPECT_EQ(power(fib, 90).to(0, 1), 2880067194370816120ll);
+    EXPECT_THROW(power(fib, -1), std::invalid_argument);
+
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    MatrixT mat = {{1, 0.5, 0}, {0.25, 1, -0.5}, {0, 0.125, 1}};
+    MatrixT naive = mat;
+    for (int i = 1; i < 13; i++)
+        naive = product(naive, mat);
+    EXPECT_EQ(power(mat, 13), naive);
+    EXPECT_EQ(power(mat, -13), naive.inverse());
 }
 
 TEST(Methods, product)
@@ -389,12 +1194,878 @@ TEST(Methods, product)
     EXPECT_EQ(product(MatrixArithmetic{-4}, mat2), (-4) * mat2);
 }
 
+template<typename MatrixT>
+MatrixT naive_product(const MatrixT& lhs, const MatrixT& rhs)
+{
+    MatrixT res (lhs.height(), rhs.width());
+    for (std::size_t i = 0; i < lhs.height(); i++)
+        for (std::size_t j = 0; j < rhs.width(); j++)
+            for (std::size_t k = 0; k < lhs.width(); k++)
+                res.to(i, j) += lhs.to(i, k) * rhs.to(k, j);
+    return res;
+}
+
+TEST(Methods, product_blocked)
+{
+    std::vector<int> lhs_data (131 * 301), rhs_data (301 * 259);
+    for (std::size_t i = 0; i < lhs_data.size(); i++)
+        lhs_data[i] = static_cast<int>(i * 7 % 23) - 11;
+    for (std::size_t i = 0; i < rhs_data.size(); i++)
+        rhs_data[i] = static_cast<int>(i * 5 % 17) - 8;
+
+    MatrixArithmetic<int> lhs (131, 301, lhs_data.begin(), lhs_data.end());
+    MatrixArithmetic<int> rhs (301, 259, rhs_data.begin(), rhs_data.end());
+    EXPECT_EQ(product(lhs, rhs), naive_product(lhs, rhs));
+
+    lhs.swap_row(0, 100);
+    rhs.swap_row(3, 300);
+    EXPECT_EQ(product(lhs, rhs), naive_product(lhs, rhs));
+}
+
+TEST(Methods, product_blocked_double)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    std::vector<double> data (97 * 97);
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<double>(i % 13) * 0.25 - 1.5;
+
+    MatrixT mat = MatrixT::square(97, data.begin(), data.end());
+    auto res = product(mat, mat);
+    auto example = naive_product(mat, mat);
+    for (std::size_t i = 0; i < 97; i++)
+        for (std::size_t j = 0; j < 97; j++)
+            EXPECT_NEAR(res.to(i, j), example.to(i, j), 1e-9);
+}
+
+TEST(Methods, product_parallel)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    std::vector<double> lhs_data (301 * 257), rhs_data (257 * 263);
+    for (std::size_t i = 0; i < lhs_data.size(); i++)
+        lhs_data[i] = static_cast<double>(i * 7 % 23) * 0.5 - 5;
+    for (std::size_t i = 0; i < rhs_data.size(); i++)
+        rhs_data[i] = static_cast<double>(i * 5 % 17) * 0.25 - 2;
+
+    MatrixT lhs (301, 257, lhs_data.begin(), lhs_data.end());
+    MatrixT rhs (257, 263, rhs_data.begin(), rhs_data.end());
+    auto example = naive_product(lhs, rhs);
+
+    ThreadPool four {4};
+    for (std::size_t tile: {0, 64, 100, 1000})
+    {
+        auto res = product(lhs, rhs, four, tile);
+        for (std::size_t i = 0; i < res.height(); i++)
+            for (std::size_t j = 0; j < res.width(); j++)
+                EXPECT_NEAR(res.to(i, j), example.to(i, j), 1e-9);
+    }
+
+    // products inside tasks of the same pool run on its threads
+    MatrixArithmetic<int> ints (200, 200);
+    for (std::size_t i = 0; i < 200; i++)
+        for (std::size_t j = 0; j < 200; j++)
+            ints.to(i, j) = static_cast<int>((i * 7 + j * 3) % 11) - 5;
+    auto ints_example = naive_product(ints, ints);
+    std::vector<MatrixArithmetic<int>> results (4);
+    four.parallel_for(0, results.size(), 1, [&](std::size_t lo, std::size_t)
+    {
+        results[lo] = product(ints, ints, four, 50);
+    });
+    for (const auto& res: results)
+        EXPECT_EQ(res, ints_example);
+}
+
+TEST(Methods, strassen_product)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    // odd sizes on every level go through peeling
+    std::vector<double> lhs_data (203 * 171), rhs_data (171 * 187);
+    for (std::size_t i = 0; i < lhs_data.size(); i++)
+        lhs_data[i] = static_cast<double>(i * 7 % 23) * 0.1 - 1.1;
+    for (std::size_t i = 0; i < rhs_data.size(); i++)
+        rhs_data[i] = static_cast<double>(i * 5 % 17) * 0.25 - 2;
+    MatrixT lhs (203, 171, lhs_data.begin(), lhs_data.end());
+    MatrixT rhs (171, 187, rhs_data.begin(), rhs_data.end());
+    lhs.swap_row(0, 202);
+
+    ThreadPool four {4};
+    auto example = naive_product(lhs, rhs);
+    auto res = strassen_product(lhs, rhs, four, 20);
+    for (std::size_t i = 0; i < res.height(); i++)
+        for (std::size_t j = 0; j < res.width(); j++)
+            EXPECT_NEAR(res.to(i, j), example.to(i, j), 1e-9);
+    EXPECT_EQ(strassen_product(lhs, rhs, four), product(lhs, rhs));
+
+    std::vector<int> ints (67 * 67);
+    for (std::size_t i = 0; i < ints.size(); i++)
+        ints[i] = static_cast<int>(i * 11 % 19) - 9;
+    auto int_mat = MatrixArithmetic<int>::square(67, ints.begin(), ints.end());
+    EXPECT_EQ(strassen_product(int_mat, int_mat.transposed_view(), four, 8), naive_product(int_mat, int_mat.transpos()));
+    EXPECT_THROW(strassen_product(lhs, lhs, four, 20), std::invalid_argument);
+
+    auto report = strassen_error(lhs, rhs, four, 20);
+    EXPECT_EQ(report.levels, 4);
+    EXPECT_GT(report.measured, 0);
+    EXPECT_LE(report.measured, report.strassen_bound);
+    EXPECT_GT(report.growth(), 1);
+    EXPECT_TRUE(report.is_safe(1e-12));
+    EXPECT_EQ(strassen_error(lhs, rhs, four).levels, 0);
+}
+
 TEST(Iterators, Iterator_and_ConstIterator)
 {
     static_assert(std::random_access_iterator<MatrixArithmetic<>::iterator>);
     static_assert(std::random_access_iterator<MatrixArithmetic<>::const_iterator>);
 }
 
+TEST(Views, slices)
+{
+    MatrixArithmetic<int> mat = {{1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12}};
+
+    auto block = mat.submatrix(1, 1, 2, 3);
+    EXPECT_EQ(block.height(), 2);
+    EXPECT_EQ(block.width(), 3);
+    EXPECT_EQ(block, (MatrixArithmetic<int>{{6, 7, 8}, {10, 11, 12}}));
+    EXPECT_EQ(block.transposed(), (MatrixArithmetic<int>{{6, 10}, {7, 11}, {8, 12}}));
+    EXPECT_EQ(mat.transposed_view().submatrix(1, 0, 2, 2), (MatrixArithmetic<int>{{2, 6}, {3, 7}}));
+    EXPECT_EQ(mat.view().cols(0, 2, 2), (MatrixArithmetic<int>{{1, 3}, {5, 7}, {9, 11}}));
+    EXPECT_EQ(mat.view().rows(0, 2, 2).col(3), (MatrixArithmetic<int>{4, 12}));
+    EXPECT_EQ(mat.view().transposed().row(2), (MatrixArithmetic<int>{{3, 7, 11}}));
+    EXPECT_EQ(transpos(mat), mat.transposed_view());
+
+    // view goes through row handles
+    mat.swap_row(0, 2);
+    EXPECT_EQ(block.to(1, 0), 2);
+    EXPECT_EQ(mat.view().at(0, 0), 9);
+
+    EXPECT_THROW(mat.submatrix(2, 0, 2, 1), std::out_of_range);
+    EXPECT_THROW(block.at(0, 3), std::out_of_range);
+    EXPECT_THROW(mat.view().rows(0, 2, 0), std::invalid_argument);
+}
+
+TEST(Views, assignment)
+{
+    MatrixArithmetic<double> mat (4, 5, 1.0);
+    MatrixArithmetic<double> rhs = {{1, 2}, {3, 4}};
+
+    mat.submatrix(1, 2, 2, 2) = rhs;
+    EXPECT_EQ(mat.to(2, 3), 4.0);
+    mat.submatrix(0, 0, 2, 2) = rhs.transposed_view() * 2.0 + rhs;
+    EXPECT_EQ(mat.submatrix(0, 0, 2, 2), (MatrixArithmetic<double>{{3, 8}, {7, 12}}));
+    mat.view().cols(4, 1) = mat.view().col(0);
+    EXPECT_EQ(mat.view().col(4), mat.view().col(0));
+
+    // overlapping blocks of one matrix are read before write
+    MatrixArithmetic<double> seq = {{1, 2, 3, 4}};
+    seq.submatrix(0, 1, 1, 3) = seq.submatrix(0, 0, 1, 3);
+    EXPECT_EQ(seq, (MatrixArithmetic<double>{{1, 1, 2, 3}}));
+    MatrixArithmetic<double> sq = {{1, 2}, {3, 4}};
+    sq = sq.transposed_view() + sq;
+    EXPECT_EQ(sq, (MatrixArithmetic<double>{{2, 5}, {5, 8}}));
+
+    EXPECT_THROW(mat.submatrix(0, 0, 2, 2) = mat.submatrix(0, 0, 3, 2), std::invalid_argument);
+}
+
+TEST(Views, algorithms)
+{
+    using MatrixT = MatrixArithmetic<double, true, DblCmp>;
+    const std::size_t n = 70;
+    MatrixT big (n + 3, n + 5);
+    for (std::size_t i = 0; i < big.height(); i++)
+        for (std::size_t j = 0; j < big.width(); j++)
+            big.to(i, j) = static_cast<double>((i * 5 + j * 3) % 11) - 5.0 + (i == j + 2 ? 30.0 : 0.0);
+
+    auto a = big.submatrix(2, 0, n, n);
+    auto b = big.submatrix(1, 3, n, n);
+    MatrixT a_cpy (a), b_cpy (b);
+
+    EXPECT_EQ(product(a, b), product(a_cpy, b_cpy));
+    EXPECT_EQ(product(a.transposed(), b), product(transpos(a_cpy), b_cpy));
+    EXPECT_EQ(product(a_cpy, b.cols(0, 4)), product(a_cpy, MatrixT(b_cpy.view().cols(0, 4))));
+    EXPECT_EQ(determinant(a), a_cpy.determinant());
+
+    LUDecomposition lu {a};
+    EXPECT_TRUE(DblCmp{}(lu.determinant(), a_cpy.determinant()));
+    EXPECT_EQ(solve(a, b.cols(0, 3)), a_cpy.solve(MatrixT(b.cols(0, 3))));
+}
+
+
+TEST(Memory, arena)
+{
+    using MatrixT = MatrixArithmetic<double>;
+    MatrixT a (40, 30, 1.0), b (30, 20, 2.0);
+    const MatrixT expected (40, 20, 120.0);
+
+    // small first chunk: first request takes several chunks, reset() merges them
+    Arena arena {1024};
+    auto request = [&]
+    {
+        ResourceGuard guard {arena};
+        MatrixT x (a), y (b);
+        MatrixT res = product(x, y) * 2.0;
+        EXPECT_EQ(res.resource(), &arena);
+        EXPECT_EQ(res, expected);
+    };
+
+    request();
+    arena.reset();
+    EXPECT_EQ(count_allocations(request), 0);
+    arena.reset();
+
+    // matrix of other resource doesnt take memory of arena
+    MatrixT res;
+    {
+        ResourceGuard guard {arena};
+        MatrixT tmp = product(a, b) * 2.0;
+        res = std::move(tmp);
+    }
+    arena.reset();
+    EXPECT_NE(res.resource(), &arena);
+    EXPECT_EQ(res, expected);
+}
+
+TEST(Memory, size_class_pool)
+{
+    using MatrixT = MatrixArithmetic<double>;
+    MatrixT a (40, 30, 1.0), b (30, 20, 2.0);
+
+    SizeClassPool pool {16 * 1024};
+    auto request = [&]
+    {
+        ResourceGuard guard {pool};
+        MatrixT x = a + a;
+        MatrixT res = product(x, b);
+        EXPECT_EQ(res.resource(), &pool);
+        EXPECT_EQ(res, MatrixT(40, 20, 120.0));
+    };
+
+    request();
+    // freed blocks are taken again
+    EXPECT_EQ(count_allocations(request), 0);
+
+    // blocks bigger than max_block are taken from upstream
+    ResourceGuard guard {pool};
+    MatrixT big (100, 100, 1.0);
+    EXPECT_EQ(big.resource(), &pool);
+    EXPECT_EQ(big.to(99, 99), 1.0);
+    EXPECT_EQ(current_resource(), &pool);
+}
+
+TEST(Memory, small_matrices_inline)
+{
+    if (detail::MatrixStorage<double>::inline_bytes < 192)
+        GTEST_SKIP() << "4 x 4 matrix is not inline with MATRIX_INLINE_BYTES=" << MATRIX_INLINE_BYTES;
+
+    using MatrixT = MatrixArithmetic<double, true>;
+    MatrixT a (4, 4, 1.0), b = MatrixT::eye(4);
+
+    EXPECT_EQ(count_allocations([&]
+    {
+        MatrixT c = a + b * 2.0;
+        MatrixT d = product(c, a);
+        MatrixT e (std::move(d));
+        c = std::move(e);
+    }), 0);
+    if (!MatrixT(5, 5).is_inline())
+    {
+        EXPECT_NE(count_allocations([] {MatrixT big (5, 5);}), 0);
+    }
+
+    // moved inline matrix keeps permutation of rows
+    MatrixT perm {{1, 2}, {3, 4}, {5, 6}};
+    perm.swap_row(0, 2);
+    MatrixT moved (std::move(perm));
+    EXPECT_FALSE(moved.is_contiguous());
+    EXPECT_EQ(moved, MatrixT({{5, 6}, {3, 4}, {1, 2}}));
+    moved.make_contiguous();
+    EXPECT_EQ(moved, MatrixT({{5, 6}, {3, 4}, {1, 2}}));
+    EXPECT_EQ(perm.height(), 0);
+
+    std::vector<MatrixT> mats;
+    for (int i = 0; i < 100; i++)
+        mats.push_back(MatrixT::eye(3) * double(i));
+    EXPECT_EQ(mats[42].determinant(), 42.0 * 42.0 * 42.0);
+    EXPECT_EQ(mats[99][2][2], 99.0);
+}
+
+TEST(Memory, move_of_inline_matrix)
+{
+    if (detail::MatrixStorage<double>::inline_bytes < 96)
+        GTEST_SKIP() << "2 x 2 matrix is not inline with MATRIX_INLINE_BYTES=" << MATRIX_INLINE_BYTES;
+
+    using MatrixT = MatrixArithmetic<double>;
+    MatrixT small (2, 2, 1.0), big (10, 10, 1.0);
+    EXPECT_TRUE(small.is_inline());
+    EXPECT_FALSE(big.is_inline());
+
+    // allocated block goes to target with row table, so pointers and rows refer to target
+    const double* big_data = big.data();
+    auto& big_row = big[3];
+    MatrixT big_moved (std::move(big));
+    EXPECT_EQ(big_moved.data(), big_data);
+    EXPECT_EQ(&big_moved[3], &big_row);
+    big_row[0] = 5.0;
+    EXPECT_EQ(big_moved.to(3, 0), 5.0);
+
+    // inline elements are copied into target, pointers into source are not valid for it
+    const double* small_data = small.data();
+    small.swap_row(0, 1);
+    MatrixT small_moved (std::move(small));
+    EXPECT_TRUE(small_moved.is_inline());
+    EXPECT_NE(small_moved.data(), small_data);
+    small_moved.to(1, 1) = 7.0;
+    EXPECT_EQ(small_moved, (MatrixT{{1, 1}, {1, 7}}));
+    EXPECT_EQ(small_moved.view().to(1, 1), 7.0);
+    EXPECT_EQ(small.height(), 0);
+}
+
+// sizes of StaticMatrix are checked at compile time
+template<typename L, typename R>
+concept is_product_available = requires(const L& lhs, const R& rhs) {product(lhs, rhs);};
+
+template<typename X>
+concept is_determinant_available = requires(const X& x) {determinant(x);};
+
+static_assert(is_product_available<StaticMatrix<int, 2, 3>, StaticMatrix<int, 3, 4>>);
+static_assert(!is_product_available<StaticMatrix<int, 2, 3>, StaticMatrix<int, 2, 3>>);
+static_assert(!is_determinant_available<StaticMatrix<int, 2, 3>>);
+static_assert(determinant(StaticMatrix<int, 3, 3>{{2, 0, 1}, {1, 3, 2}, {1, 1, 2}}) == 6);
+static_assert(sizeof(StaticMatrix<double, 4, 4>) == 16 * sizeof(double));
+
+TEST(Static, arithmetic)
+{
+    using Mat23 = StaticMatrix<int, 2, 3>;
+    constexpr Mat23 a {{1, 2, 3}, {4, 5, 6}};
+    constexpr Mat23 b (1);
+
+    EXPECT_EQ(a + b, Mat23({{2, 3, 4}, {5, 6, 7}}));
+    EXPECT_EQ(a - b * 2, Mat23({{-1, 0, 1}, {2, 3, 4}}));
+    EXPECT_EQ(-a / 2, Mat23({{0, -1, -1}, {-2, -2, -3}}));
+    EXPECT_EQ(transpos(a), (StaticMatrix<int, 3, 2>{{1, 4}, {2, 5}, {3, 6}}));
+
+    constexpr auto c = product(a, transpos(a));
+    EXPECT_EQ(c, (StaticMatrix<int, 2, 2>{{14, 32}, {32, 77}}));
+    EXPECT_EQ(scalar_cast(product(StaticMatrix<int, 1, 3>{{1, 2, 3}}, StaticMatrix<int, 3, 1>{{1}, {1}, {1}})), 6);
+    EXPECT_EQ(a[1][2], 6);
+    EXPECT_THROW(a.at(2), std::out_of_range);
+    EXPECT_THROW((Mat23{{1, 2, 3, 4}}), std::invalid_argument);
+}
+
+TEST(Static, determinant_and_inverse)
+{
+    StaticMatrix<long long, 4, 4> a {{3, 2, 0, 1}, {4, 0, 1, 2}, {3, 0, 2, 1}, {9, 2, 3, 1}};
+    EXPECT_EQ(a.determinant(), 24);
+    EXPECT_EQ(determinant(StaticMatrix<long long, 6, 6>::eye() * 2), 64);
+
+    using DoubleMatrix = MatrixArithmetic<double, true>;
+    // closed forms for 1 ... 4, LU for bigger sizes
+    auto check = [&]<std::size_t N>(std::integral_constant<std::size_t, N>)
+    {
+        StaticMatrix<double, N, N, true> m;
+        for (std::size_t i = 0; i < N; i++)
+            for (std::size_t j = 0; j < N; j++)
+                m.to(i, j) = i == j ? N + 1.0 : 1.0 / (i + 2 * j + 1);
+
+        DoubleMatrix dyn (m);
+        EXPECT_NEAR(m.determinant(), dyn.determinant(), 1e-9);
+
+        auto inv = inverse(m);
+        auto eye = product(m, inv);
+        for (std::size_t i = 0; i < N; i++)
+            for (std::size_t j = 0; j < N; j++)
+                EXPECT_NEAR(eye.to(i, j), i == j ? 1.0 : 0.0, 1e-12);
+
+        auto dyn_inv = dyn.inverse();
+        for (std::size_t i = 0; i < N; i++)
+            for (std::size_t j = 0; j < N; j++)
+                EXPECT_NEAR(inv.to(i, j), dyn_inv.to(i, j), 1e-12);
+    };
+    check(std::integral_constant<std::size_t, 1>{});
+    check(std::integral_constant<std::size_t, 2>{});
+    check(std::integral_constant<std::size_t, 3>{});
+    check(std::integral_constant<std::size_t, 4>{});
+    check(std::integral_constant<std::size_t, 7>{});
+
+    EXPECT_THROW(inverse(StaticMatrix<double, 3, 3, true>(1.0)), std::invalid_argument);
+}
+
+TEST(Static, conversion)
+{
+    MatrixArithmetic<int> dyn {{1, 2}, {3, 4}, {5, 6}};
+    StaticMatrix<int, 3, 2> st (dyn);
+    EXPECT_EQ(st.to(2, 1), 6);
+
+    MatrixArithmetic<int> back = transpos(st);
+    EXPECT_EQ(back, transpos(dyn));
+    EXPECT_EQ(product(dyn, MatrixArithmetic<int>(StaticMatrix<int, 2, 2>::eye())), dyn);
+    EXPECT_THROW((StaticMatrix<int, 2, 2>(dyn)), std::invalid_argument);
+}
+
+TEST(Batch, determinant_inverse_solve)
+{
+    using MatrixT = MatrixArithmetic<double, true>;
+    ThreadPool pool {4};
+
+    // size is not multiple of lanes, last block has unit matrices after last matrix
+    const std::size_t count = 1003, n = 5;
+    std::vector<MatrixT> mats;
+    for (std::size_t b = 0; b < count; b++)
+    {
+        MatrixT mat (n, n);
+        for (std::size_t i = 0; i < n; i++)
+            for (std::size_t j = 0; j < n; j++)
+                mat.to(i, j) = double((b * 7 + i * 13 + j * 29 + i * j) % 17) - 8.0 + (i == j ? 0.5 : 0.0);
+        mats.push_back(std::move(mat));
+    }
+    MatrixBatch<double> batch (mats.begin(), mats.end());
+    ASSERT_EQ(batch.size(), count);
+
+    auto det = determinant(batch, pool);
+    auto inv = inverse(batch, pool);
+    MatrixBatch<double> rhs (count, n, 2);
+    for (std::size_t b = 0; b < count; b++)
+        for (std::size_t i = 0; i < n; i++)
+            rhs.to(b, i, 0) = rhs.to(b, i, 1) = double(i + b % 3);
+    auto x = solve(batch, rhs, pool);
+    auto eye = product(batch, inv, pool);
+
+    for (std::size_t b = 0; b < count; b++)
+    {
+        auto expected = mats[b].determinant();
+        EXPECT_NEAR(det[b], expected, 1e-9 * std::max(1.0, std::abs(expected)));
+        for (std::size_t i = 0; i < n; i++)
+            for (std::size_t j = 0; j < n; j++)
+                EXPECT_NEAR(eye.to(b, i, j), i == j ? 1.0 : 0.0, 1e-9);
+
+        auto residual = product(mats[b], x.matrix(b)) - rhs.matrix(b);
+        for (auto& row: MatrixT(residual))
+            for (auto elem: row)
+                EXPECT_NEAR(elem, 0.0, 1e-9);
+    }
+
+    batch.set(500, MatrixT(n, n, 1.0));
+    EXPECT_EQ(determinant(batch)[500], 0.0);
+    EXPECT_THROW(inverse(batch), std::invalid_argument);
+    EXPECT_THROW(solve(batch, MatrixBatch<double>(count, n + 1, 1)), std::invalid_argument);
+    EXPECT_THROW(batch.set(0, MatrixT(2, 2)), std::invalid_argument);
+    EXPECT_THROW(batch.at(count, 0, 0), std::out_of_range);
+}
+
+TEST(Batch, product_float)
+{
+    const std::size_t count = 37;
+    MatrixBatch<float> lhs (count, 2, 3), rhs (count, 3, 4);
+    for (std::size_t b = 0; b < count; b++)
+    {
+        lhs.set(b, MatrixContainer<float>{{1, 2, 3}, {4, 5, 6}});
+        rhs.set(b, MatrixContainer<float>(3, 4, float(b)));
+    }
+
+    auto res = product(lhs, rhs);
+    EXPECT_EQ(res.height(), 2);
+    EXPECT_EQ(res.width(), 4);
+    for (std::size_t b = 0; b < count; b++)
+        EXPECT_EQ(res.matrix(b), MatrixBatch<float>::matrix_type({{6.f * b, 6.f * b, 6.f * b, 6.f * b},
+                                                                    {15.f * b, 15.f * b, 15.f * b, 15.f * b}}));
+    EXPECT_THROW(product(lhs, lhs), std::invalid_argument);
+}
+
+TEST(Sparse, builder_and_conversions)
+{
+    SparseBuilder<int> builder (3, 4);
+    builder.add(2, 3, 7);
+    builder.add(0, 1, 2);
+    builder.add(1, 0, 5);
+    builder.add(0, 1, 3);
+    builder.add(2, 2, 4);
+    builder.add(2, 2, -4);
+    EXPECT_THROW(builder.add(3, 0, 1), std::out_of_range);
+
+    MatrixArithmetic<int> dense {{0, 5, 0, 0}, {5, 0, 0, 0}, {0, 0, 0, 7}};
+    CSRMatrix<int> csr (builder);
+    EXPECT_EQ(csr.nnz(), 3);    // duplicates are summed, zero is dropped
+    EXPECT_EQ(csr.to_dense(), dense);
+    EXPECT_EQ(csr.at(0, 1), 5);
+    EXPECT_EQ(csr.at(1, 1), 0);
+    EXPECT_THROW(csr.at(0, 4), std::out_of_range);
+
+    CSCMatrix<int> csc (builder);
+    EXPECT_EQ(csc.to_dense(), dense);
+    EXPECT_EQ(CSCMatrix<int>(csr), csc);
+    EXPECT_EQ(CSRMatrix<int>(csc), csr);
+    EXPECT_EQ(CSRMatrix<int>(dense), csr);
+    EXPECT_EQ(csr.transpos().to_dense(), transpos(dense));
+    EXPECT_EQ(transpos(csc).to_dense(), transpos(dense));
+
+    EXPECT_EQ((csr * 2).to_dense(), dense * 2);
+    EXPECT_THROW((CSRMatrix<int>(2, 2, {0, 1, 1}, {1, 0}, {1, 2})), std::invalid_argument);
+}
+
+TEST(Sparse, products)
+{
+    const std::size_t h = 700, w = 500, m = 300;
+    ThreadPool pool {4};
+    auto random = [](std::size_t h, std::size_t w)
+    {
+        SparseBuilder<long long> builder (h, w);
+        for (std::size_t k = 0; k < h * w / 20; k++)
+            builder.add(std::rand() % h, std::rand() % w, std::rand() % 19 - 9);
+        return builder;
+    };
+
+    auto lhs_builder = random(h, w), rhs_builder = random(w, m);
+    CSRMatrix<long long> lhs (lhs_builder), rhs (rhs_builder);
+    CSCMatrix<long long> lhs_csc (lhs_builder), rhs_csc (rhs_builder);
+    auto lhs_dense = lhs.to_dense(), rhs_dense = rhs.to_dense();
+    auto expected = product(lhs_dense, rhs_dense);
+
+    std::vector<long long> x (w);
+    for (auto& val: x)
+        val = std::rand() % 7 - 3;
+    auto x_dense = MatrixArithmetic<long long>(w, 1);
+    for (std::size_t i = 0; i < w; i++)
+        x_dense.to(i, 0) = x[i];
+    auto y_dense = product(lhs_dense, x_dense);
+    std::vector<long long> y (h);
+    for (std::size_t i = 0; i < h; i++)
+        y[i] = y_dense.to(i, 0);
+
+    EXPECT_EQ(product(lhs, x, pool), y);
+    EXPECT_EQ(product(lhs_csc, x, pool), y);
+    // workspace of partial sums is reused, sums of previous product dont go into next one
+    std::vector<long long> workspace, y_csc (h);
+    lhs_csc.multiply(x.data(), y_csc.data(), workspace, pool);
+    EXPECT_EQ(y_csc, y);
+    CSCMatrix<long long>(h, w).multiply(x.data(), y_csc.data(), workspace, pool);
+    EXPECT_EQ(y_csc, std::vector<long long>(h));
+    auto capacity = workspace.capacity();
+    lhs_csc.multiply(x.data(), y_csc.data(), workspace, pool);
+    EXPECT_EQ(y_csc, y);
+    EXPECT_EQ(workspace.capacity(), capacity);
+    EXPECT_EQ(product(lhs, rhs_dense, pool), expected);
+    EXPECT_EQ(product(lhs_csc, rhs_dense, pool), expected);
+    EXPECT_EQ(product(lhs, rhs, pool).to_dense(), expected);
+    EXPECT_EQ(product(lhs_csc, rhs_csc, pool).to_dense(), expected);
+    EXPECT_THROW(product(lhs, lhs, pool), std::invalid_argument);
+    EXPECT_THROW(product(lhs, std::vector<long long>(h), pool), std::invalid_argument);
+}
+
+TEST(Sparse, large_tridiagonal)
+{
+    const std::size_t n = 100'000;
+    SparseBuilder<double, true> builder (n, n);
+    builder.reserve(3 * n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        builder.add(i, i, 2);
+        if (i > 0)
+            builder.add(i, i - 1, -1);
+        if (i + 1 < n)
+            builder.add(i, i + 1, -1);
+    }
+
+    CSRMatrix<double, true> mat (builder);
+    EXPECT_EQ(mat.nnz(), 3 * n - 2);
+    auto y = product(mat, std::vector<double>(n, 1.0));
+    EXPECT_EQ(y.front(), 1.0);
+    EXPECT_EQ(y[n / 2], 0.0);
+    EXPECT_EQ(y.back(), 1.0);
+}
+
+// 5-point Laplacian on side x side grid, convection adds not symmetric part, rows are shuffled by perm
+static CSRMatrix<double, true> poisson(std::size_t side, double convection = 0, std::vector<std::size_t> perm = {})
+{
+    auto n = side * side;
+    if (perm.empty())
+        for (std::size_t i = 0; i < n; i++)
+            perm.push_back(i);
+
+    SparseBuilder<double, true> builder (n, n);
+    for (std::size_t x = 0; x < side; x++)
+        for (std::size_t y = 0; y < side; y++)
+        {
+            auto i = perm[x * side + y];
+            builder.add(i, i, 4);
+            if (x > 0)
+                builder.add(i, perm[(x - 1) * side + y], -1 - convection);
+            if (x + 1 < side)
+                builder.add(i, perm[(x + 1) * side + y], -1 + convection);
+            if (y > 0)
+                builder.add(i, perm[x * side + y - 1], -1);
+            if (y + 1 < side)
+                builder.add(i, perm[x * side + y + 1], -1);
+        }
+    return CSRMatrix<double, true>(builder);
+}
+
+static double residual(const CSRMatrix<double, true>& mat, const std::vector<double>& x, const std::vector<double>& b)
+{
+    auto ax = product(mat, x);
+    double res = 0, norm = 0;
+    for (std::size_t i = 0; i < b.size(); i++)
+    {
+        res += (b[i] - ax[i]) * (b[i] - ax[i]);
+        norm += b[i] * b[i];
+    }
+    return std::sqrt(res / norm);
+}
+
+TEST(SparseSolve, reverse_cuthill_mckee)
+{
+    const std::size_t side = 20;
+    std::vector<std::size_t> shuffle (side * side);
+    for (std::size_t i = 0; i < shuffle.size(); i++)
+        shuffle[i] = (i * 37) % shuffle.size();
+
+    auto mat = poisson(side, 0, shuffle);
+    auto perm = reverse_cuthill_mckee(mat);
+    auto ordered = permute(mat, perm);
+    EXPECT_GT(bandwidth(mat), 10 * side);
+    EXPECT_LE(bandwidth(ordered), 2 * side);
+    EXPECT_EQ(ordered.nnz(), mat.nnz());
+    EXPECT_EQ(ordered.at(0, 0), 4);
+    EXPECT_THROW(permute(mat, {0, 1}), std::invalid_argument);
+}
+
+TEST(SparseSolve, lu_and_cholesky)
+{
+    // zeros on diagonal need pivoting
+    MatrixArithmetic<double, true> dense {{0, 2, 0, 1, 0},
+                                          {3, 0, 0, 0, 1},
+                                          {0, 1, 0, 4, 0},
+                                          {0, 0, 5, 0, 2},
+                                          {1, 0, 0, 2, 3}};
+    CSRMatrix<double, true> mat (dense);
+    std::vector<double> b {1, 2, 3, 4, 5};
+    LUDecomposition lu_dense (dense);
+
+    for (auto ordering: {SparseOrdering::natural, SparseOrdering::rcm})
+    {
+        SparseLU lu (mat, ordering);
+        EXPECT_FALSE(lu.is_singular());
+        EXPECT_NEAR(lu.determinant(), lu_dense.determinant(), 1e-9);
+        auto x = lu.solve(b), expected = lu_dense.solve(b);
+        for (std::size_t i = 0; i < b.size(); i++)
+            EXPECT_NEAR(x[i], expected[i], 1e-12);
+    }
+
+    SparseLU singular (CSRMatrix<double, true>(MatrixArithmetic<double, true>{{1, 2}, {2, 4}}));
+    EXPECT_TRUE(singular.is_singular());
+    EXPECT_EQ(singular.determinant(), 0);
+    EXPECT_THROW(singular.solve({1, 1}), std::invalid_argument);
+
+    auto spd = poisson(30);
+    std::vector<double> rhs (spd.height(), 1.0);
+    SparseCholesky cholesky (spd);
+    SparseLU lu (spd);
+    EXPECT_LT(residual(spd, cholesky.solve(rhs), rhs), 1e-12);
+    EXPECT_LT(residual(spd, lu.solve(rhs), rhs), 1e-12);
+    EXPECT_LT(cholesky.nnz(), 40 * spd.height());  // fill stays in band of width 30
+    EXPECT_THROW(SparseCholesky(poisson(4) * -1.0), std::invalid_argument);
+
+    // arrow matrix by upper triangle only: ordering moves first row to the end, its elements go under diagonal
+    MatrixArithmetic<double, true> arrow (6, 6);
+    SparseBuilder<double, true> upper (6, 6);
+    for (std::size_t i = 0; i < 6; i++)
+    {
+        arrow.to(i, i) = 10.0 + i;
+        upper.add(i, i, 10.0 + i);
+        if (i > 0)
+        {
+            arrow.to(0, i) = arrow.to(i, 0) = 2.0 + i;
+            upper.add(0, i, 2.0 + i);
+        }
+    }
+    LUDecomposition arrow_lu (arrow);
+    std::vector<double> arrow_rhs {1, -2, 3, -4, 5, -6};
+    auto arrow_x = arrow_lu.solve(arrow_rhs);
+    for (auto upper_cholesky: {SparseCholesky(CSRMatrix<double, true>(upper)), SparseCholesky(CSCMatrix<double, true>(upper))})
+    {
+        EXPECT_NEAR(upper_cholesky.determinant(), arrow_lu.determinant(), 1e-6);
+        auto x = upper_cholesky.solve(arrow_rhs);
+        for (std::size_t i = 0; i < x.size(); i++)
+            EXPECT_NEAR(x[i], arrow_x[i], 1e-12);
+    }
+}
+
+TEST(SparseSolve, iterative)
+{
+    auto spd = poisson(40);
+    auto convection = poisson(40, 0.5);
+    std::vector<double> b (spd.height());
+    for (std::size_t i = 0; i < b.size(); i++)
+        b[i] = double(i % 7) - 3;
+
+    SolverOptions options {.tolerance = 1e-10, .max_iterations = 2000};
+    std::vector<double> x;
+    auto plain = conjugate_gradient(spd, b, x, IdentityPreconditioner{}, options);
+    EXPECT_TRUE(plain.converged);
+    EXPECT_LT(residual(spd, x, b), 1e-9);
+    EXPECT_GE(plain.seconds, plain.seconds_per_iteration());
+
+    x.clear();
+    auto ilu = conjugate_gradient(spd, b, x, ILU0Preconditioner(spd), options);
+    EXPECT_TRUE(ilu.converged);
+    EXPECT_LT(ilu.iterations, plain.iterations);
+    EXPECT_LT(residual(spd, x, b), 1e-9);
+
+    x.clear();
+    EXPECT_TRUE(conjugate_gradient(spd, b, x, JacobiPreconditioner(spd), options).converged);
+    EXPECT_LT(residual(spd, x, b), 1e-9);
+
+    x.clear();
+    auto report = bicgstab(convection, b, x, ILU0Preconditioner(convection), options);
+    EXPECT_TRUE(report.converged);
+    EXPECT_GT(report.iterations, 0);
+    EXPECT_LT(residual(convection, x, b), 1e-9);
+
+    for (auto restart: {10, 50})
+    {
+        x.clear();
+        options.restart = restart;
+        EXPECT_TRUE(gmres(convection, b, x, ILU0Preconditioner(convection), options).converged);
+        EXPECT_LT(residual(convection, x, b), 1e-9);
+    }
+
+    x.clear();
+    options.max_iterations = 3;
+    auto stopped = gmres(convection, b, x, JacobiPreconditioner(convection), options);
+    EXPECT_FALSE(stopped.converged);
+    EXPECT_EQ(stopped.iterations, 3);
+}
+
+TEST(IO, binary)
+{
+    using MatrixT = MatrixArithmetic<double, true>;
+    MatrixT mat {{1.5, -2, 3}, {4, 5e-300, 6}};
+    auto path = (std::filesystem::temp_directory_path() / "matrix_io_test.bin").string();
+
+    for (auto layout: {FileLayout::row_major, FileLayout::col_major})
+    {
+        write_binary(path, mat, layout);
+        EXPECT_TRUE(is_binary_matrix_file(path));
+        EXPECT_EQ(read_binary<MatrixT>(path), mat);
+        EXPECT_EQ(read_binary<MatrixArithmetic<float>>(path), (MatrixArithmetic<float>{{1.5f, -2, 3}, {4, 0, 6}}));
+
+        MappedMatrix<double> mapped {path};
+        EXPECT_EQ(mapped.height(), 2);
+        EXPECT_EQ(mapped.width(), 3);
+        EXPECT_EQ(MatrixT(mapped.view<MatrixT>()), mat);
+
+        // private mapping: changes stay in memory
+        mapped.view().to(0, 0) = 100;
+        EXPECT_EQ(mapped.view().to(0, 0), 100);
+        EXPECT_EQ(read_binary<MatrixT>(path).to(0, 0), 1.5);
+        EXPECT_THROW(MappedMatrix<float>{path}, std::runtime_error);
+    }
+
+    // views of matrices are written too, and file with other byte order is read by read_binary
+    MatrixArithmetic<std::int64_t> ints {{1, 2}, {3, 4}};
+    std::stringstream stream;
+    write_binary(stream, ints.transposed_view());
+    auto bytes = stream.str();
+    for (std::size_t k = 8; k < 48; k += k < 24 ? 4 : 8)
+        std::reverse(bytes.begin() + k, bytes.begin() + k + (k < 24 ? 4 : 8));
+    for (std::size_t k = 64; k < bytes.size(); k += 8)
+        std::reverse(bytes.begin() + k, bytes.begin() + k + 8);
+    std::stringstream swapped {bytes};
+    EXPECT_EQ(read_binary<MatrixArithmetic<std::int64_t>>(swapped), transpos(ints));
+
+    // sizes in header are checked against rest of stream and against overflow before matrix is allocated
+    auto with_size = [&](std::uint64_t h, std::uint64_t w)
+    {
+        auto corrupt = stream.str();
+        std::memcpy(corrupt.data() + 24, &h, sizeof(h));
+        std::memcpy(corrupt.data() + 32, &w, sizeof(w));
+        return std::stringstream {corrupt};
+    };
+    auto too_long = with_size(1 << 20, 1 << 20), overflow = with_size(std::uint64_t{1} << 40, std::uint64_t{1} << 40);
+    auto same = with_size(2, 2);
+    EXPECT_THROW(read_binary<MatrixArithmetic<std::int64_t>>(too_long), std::runtime_error);
+    EXPECT_THROW(read_binary<MatrixArithmetic<std::int64_t>>(overflow), std::runtime_error);
+    EXPECT_EQ(read_binary<MatrixArithmetic<std::int64_t>>(same), transpos(ints));
+
+    std::filesystem::remove(path);
+    EXPECT_THROW(MappedMatrix<double>{path}, std::runtime_error);
+    EXPECT_FALSE(is_binary_matrix_file(path));
+}
+
+TEST(IO, text)
+{
+    std::istringstream in {" 3\n1 -2.5 +3\n\t4 5e2 6\r\n7 8 9.125"};
+    auto mat = read_text<MatrixArithmetic<double>>(in, 4);   // numbers are cut by chunks
+    EXPECT_EQ(mat, (MatrixArithmetic<double>{{1, -2.5, 3}, {4, 500, 6}, {7, 8, 9.125}}));
+
+    std::ostringstream out;
+    MatrixArithmetic<double> exact {{0.1, 1.0 / 3}, {-1e-300, 12345678.9}};
+    write_text(out, exact);
+    std::istringstream back {out.str()};
+    EXPECT_EQ(read_text<MatrixArithmetic<double>>(back), exact);
+
+    std::istringstream short_text {"2 1 2 3"}, wrong_text {"2 1 2 x 4"};
+    EXPECT_THROW(read_text<MatrixArithmetic<int>>(short_text), std::invalid_argument);
+    EXPECT_THROW(read_text<MatrixArithmetic<int>>(wrong_text), std::invalid_argument);
+    EXPECT_THROW(write_text(out, MatrixArithmetic<int>(2, 3)), std::invalid_argument);
+}
+
+TEST(OutOfCore, determinant_and_solve)
+{
+    using MatrixT = MatrixArithmetic<double, true>;
+    const std::size_t n = 100;
+    MatrixT mat (n, n);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < n; j++)
+            mat.to(i, j) = double(std::rand() % 2001 - 1000) / 1000;
+    std::vector<double> b (n);
+    for (std::size_t i = 0; i < n; i++)
+        b[i] = double(i % 5) - 2;
+
+    LUDecomposition lu (mat);
+    auto expected = lu.solve(b);
+    auto dir = std::filesystem::temp_directory_path();
+    auto path = (dir / "matrix_ooc_test.tiles").string();
+    auto mat_path = (dir / "matrix_ooc_test.bin").string();
+
+    {
+        OutOfCoreLU<> ooc (path, mat, 32, false);
+        EXPECT_EQ(ooc.tiles(), 4);
+        EXPECT_EQ(ooc.working_set(), 3 * 128 * 32 * sizeof(double));
+        EXPECT_THROW(ooc.determinant(), std::invalid_argument);
+        EXPECT_TRUE(ooc.factorize());
+        EXPECT_NEAR(ooc.determinant() / lu.determinant(), 1, 1e-9);
+
+        auto x = ooc.solve(b);
+        for (std::size_t i = 0; i < n; i++)
+            EXPECT_NEAR(x[i], expected[i], 1e-9);
+        EXPECT_EQ(ooc.tile(3, 3).to(31, 31), 1);   // padding stays identity
+    }
+
+    // stopped factorization goes on from file, source is mapped binary file
+    write_binary(mat_path, mat);
+    {
+        MappedMatrix<double> mapped {mat_path};
+        OutOfCoreLU<> ooc (path, mapped.view<MatrixT>(), 32);
+        EXPECT_FALSE(ooc.factorize(3));
+        EXPECT_EQ(ooc.progress(), 3);
+    }
+    for (std::size_t step = 0;; step++)
+    {
+        OutOfCoreLU<> ooc (path);
+        if (ooc.factorize(2))
+        {
+            EXPECT_EQ(ooc.progress(), 10);
+            EXPECT_NEAR(ooc.determinant() / lu.determinant(), 1, 1e-9);
+            auto x = ooc.solve(b);
+            for (std::size_t i = 0; i < n; i++)
+                EXPECT_NEAR(x[i], expected[i], 1e-9);
+            break;
+        }
+        ASSERT_LT(step, 4);
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(mat_path);
+    EXPECT_THROW(OutOfCoreLU<>{path}, std::runtime_error);
+}
 
 int main(int argc, char **argv)
 {